@@ -16,6 +16,8 @@ class ButtonComponent {
     ftxui::Component GetCatAllButton();
     ftxui::Component GetCopyTreeButton();
     ftxui::Component GetCatTreeButton();
+    ftxui::Component GetCopyOutlineButton();
+    ftxui::Component GetCatOutlineButton();
     ftxui::Component GetExitButton();
 
    private:
@@ -23,6 +25,8 @@ class ButtonComponent {
     ftxui::Component cat_all_button;
     ftxui::Component copy_tree_button;
     ftxui::Component cat_tree_button;
+    ftxui::Component copy_outline_button;
+    ftxui::Component cat_outline_button;
     ftxui::Component exit_button;
     ftxui::ScreenInteractive& screen;
     std::set<fs::path>& selected_paths;
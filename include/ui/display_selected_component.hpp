@@ -2,33 +2,52 @@
 #define DISPLAY_SELECTED_COMPONENT_HPP
 
 #include <ftxui/component/component.hpp>
+#include <ftxui/component/screen_interactive.hpp>
 #include <set>
 #include <filesystem>
 #include <map>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/file_metrics.hpp"
+#include "utils/path_table.hpp"
 
 namespace fs = std::filesystem;
 
 class DisplaySelectedComponent {
 public:
-    DisplaySelectedComponent(std::set<fs::path>& selected_paths, const fs::path& root_path);
+    DisplaySelectedComponent(ftxui::ScreenInteractive& screen, std::set<fs::path>& selected_paths, const fs::path& root_path, Utils::NameOrder order = Utils::NameOrder::Bytewise);
+    ~DisplaySelectedComponent();
     ftxui::Component Render();
 
 private:
+    ftxui::ScreenInteractive& screen;
     std::set<fs::path>& selected_paths;
     const fs::path root_path;
+    const Utils::NameOrder order;  // Listed like the dumps, directories first
     ftxui::Component display_selected;
 
-    // Helper structures and functions for building the tree
-    struct TreeNode {
-        std::string name;
-        bool is_directory = false;
-        std::map<std::string, TreeNode> children;
-    };
+    // Size totals, recomputed on a worker thread when the selection changes and handed back to
+    // the render thread through screen.Post; only the worker touches the cache
+    Utils::MetricsCache metrics_cache;
+    std::thread measuring_thread;
+    bool measuring = false;
+    std::set<fs::path> measured_selection;
+    std::map<fs::path, Utils::FileMetrics> selection_metrics;
+    std::map<fs::path, bool> selection_directories;  // Whether each measured path is a directory, from the walk
+    Utils::FileMetrics total_metrics;
+
+    // The tree shown, rebuilt only when the selection changes or a measurement arrives
+    std::set<fs::path> shown_selection;
+    bool tree_stale = true;
+    Utils::PathTable tree_table;
+    std::vector<Utils::FileMetrics> tree_metrics;
 
-    void BuildTree(TreeNode& node);
-    void InsertPath(TreeNode& node, const fs::path& relative_path, const fs::path& full_path);
-    ftxui::Element RenderTree(const TreeNode& node, int depth = 0);
+    // Helper functions for building the tree
+    void UpdateMetrics();
+    void BuildTree();
+    ftxui::Element RenderTree(const Utils::PathTable& table, const std::vector<Utils::FileMetrics>& metrics, Utils::PathTable::Range children, int depth = 0);
 };
 
 #endif // DISPLAY_SELECTED_COMPONENT_HPP
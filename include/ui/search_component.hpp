@@ -0,0 +1,58 @@
+#ifndef SEARCH_COMPONENT_HPP
+#define SEARCH_COMPONENT_HPP
+
+#include <filesystem>
+#include <ftxui/component/component.hpp>
+#include <ftxui/component/screen_interactive.hpp>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "utils/dump_options.hpp"
+#include "utils/selection_profile.hpp"
+
+namespace fs = std::filesystem;
+
+class SearchComponent {
+   public:
+    SearchComponent(
+        ftxui::ScreenInteractive& screen,
+        fs::path& current_directory,
+        const fs::path& root_path,
+        std::set<fs::path>& selected_paths,
+        Utils::DumpOptions& dump_options,
+        const Utils::SelectionProfile& profile,
+        std::function<void()> on_select);
+    ~SearchComponent();
+
+    ftxui::Component GetComponent();
+    bool Focused() const;
+    void TakeFocus();
+    void SetQuery(const std::string& text);
+
+   private:
+    // Selects every file below the current directory whose content matches the query; the scan
+    // runs on a worker thread and its matches are handed back through screen.Post
+    void RunSearch();
+
+    ftxui::ScreenInteractive& screen;
+    fs::path& current_directory;
+    const fs::path root_path;
+    std::set<fs::path>& selected_paths;
+    Utils::DumpOptions& dump_options;
+    const Utils::SelectionProfile& profile;
+    std::function<void()> on_select;  // Refreshes the menu once the selection changed
+
+    std::string query;
+    bool regex = false;
+    bool ignore_case = false;
+    std::string status;
+    std::thread search_thread;
+    bool searching = false;
+
+    ftxui::Component input;
+    ftxui::Component container;
+};
+
+#endif  // SEARCH_COMPONENT_HPP
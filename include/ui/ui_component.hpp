@@ -1,6 +1,7 @@
 #ifndef UI_COMPONENT_HPP
 #define UI_COMPONENT_HPP
 
+#include <chrono>
 #include <filesystem>
 #include <ftxui/component/component.hpp>
 #include <ftxui/component/screen_interactive.hpp>
@@ -8,16 +9,24 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "ui/button_component.hpp"
 #include "ui/display_selected_component.hpp"
 #include "ui/instructions_component.hpp"
 #include "ui/menu_component.hpp"
+#include "ui/search_component.hpp"
+#include "utils/dump_options.hpp"
+#include "utils/selection_profile.hpp"
 
 class UIComponent {
    public:
-    UIComponent();
+    explicit UIComponent(const Utils::DumpOptions& dump_options = Utils::DumpOptions(),
+                         const std::string& profile_name = "",
+                         const Utils::SelectionProfile& profile = Utils::SelectionProfile(),
+                         const std::vector<std::filesystem::path>& include_dirs = {});
+    ~UIComponent();
     void Run();
 
    private:
@@ -25,6 +34,9 @@ class UIComponent {
     int focused_index = 0;         // Selector variable for focused item
     int button_focused_index = 0;  // Focused index for buttons
 
+    const std::chrono::steady_clock::time_point created;  // Start of the time to first frame
+    bool first_frame_drawn = false;
+
     ftxui::ScreenInteractive screen;          // FTXUI screen for displaying the UI
     std::filesystem::path current_directory;  // Current directory path
     const std::filesystem::path root_path;    // Fixed root path for relative calculations
@@ -34,10 +46,23 @@ class UIComponent {
     std::set<std::filesystem::path> selected_paths;      // Set of all selected paths
 
     MenuComponent menu_component;
+    SearchComponent search_component;
     InstructionsComponent instructions_component;
     DisplaySelectedComponent display_selected_component;
     ButtonComponent button_component;
 
+    Utils::DumpOptions dump_options;  // How the tree and the contents are written once the UI exits
+    std::string profile_name;         // Selection profile restored at startup and saved on exit, if any
+    Utils::SelectionProfile profile;
+    std::set<std::filesystem::path> profile_selection;  // Selection the profile resolved to at startup
+    std::vector<std::filesystem::path> include_dirs;  // Given with --include-dir, for selecting included headers
+
+    // Included headers are looked up on a worker thread and handed back through screen.Post
+    void AddDependencies();
+    std::thread dependency_thread;
+    bool adding_dependencies = false;
+    std::string dependency_status;  // Shown under the search while looking up, then the outcome
+
     std::string pressed_button = "Ex";  // This button tracks the last pressed button. Valid values - CoA, CoT, CaA, CaT, Ex(default)
 };
 
@@ -0,0 +1,62 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils/dump_options.hpp"
+
+namespace Utils {
+
+/**
+ * @brief One repository to dump in batch mode, with its own options.
+ */
+struct BatchJob {
+    std::filesystem::path root;
+    std::filesystem::path output;              // File the dump is written to
+    std::string action = "CaA";                // CaA, CaT or CaO
+    std::string profile_name;                  // Saved selection to restore from the root, if any
+    std::vector<std::string> include_rules;
+    std::vector<std::string> exclude_rules;
+    DumpOptions options;
+};
+
+/**
+ * @brief Reads a batch manifest. Every non-empty line that does not start with '#' names a root,
+ *        optionally followed by options that override the command-line defaults for that root:
+ *        --format, --minify, --no-redact, --keep-encoding, --natural-order, --annotate, --profile,
+ *        --include, --exclude, --action (cat-all, cat-tree or cat-outline), --since, --diff and
+ *        --output. Arguments may be double-quoted. Relative paths are taken relative to the
+ *        current directory; without --output a root is written to <root name>.<format extension>
+ *        there.
+ *        A cat-all dump is followed by its manifest, <output>.manifest.
+ *
+ * @param manifest Path of the manifest.
+ * @param defaults Options used for roots that do not override them.
+ * @param default_format Format the defaults were compiled for; picks the output extension.
+ * @param jobs Receives one job per root.
+ * @param error Receives a description of the first problem found.
+ * @return true If the manifest was read completely.
+ * @return false Otherwise.
+ */
+bool ParseBatchManifest(const std::filesystem::path& manifest, const DumpOptions& defaults, OutputFormat default_format, std::vector<BatchJob>& jobs, std::string& error);
+
+/**
+ * @brief Dumps every job on a shared pool of thread_count workers, with at most io_slots files
+ *        being read at any time across all of them. Each root is first resolved and weighed by
+ *        its file count, then the roots are dumped largest first so a big repository picked up
+ *        late does not stretch the run. Per-root results and the totals are written to report.
+ *
+ * @param jobs The roots to dump.
+ * @param thread_count Number of workers, or 0 for DefaultThreadCount().
+ * @param io_slots Maximum number of concurrent file reads, or 0 for twice the worker count.
+ * @param report The output stream to write the report to.
+ * @return The number of roots that failed.
+ */
+size_t RunBatch(const std::vector<BatchJob>& jobs, unsigned thread_count, unsigned io_slots, std::ostream& report);
+
+}  // namespace Utils
+
+#endif  // BATCH_HPP
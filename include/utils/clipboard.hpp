@@ -0,0 +1,54 @@
+#ifndef CLIPBOARD_HPP
+#define CLIPBOARD_HPP
+
+#include <string>
+#include <string_view>
+
+namespace Utils {
+
+/**
+ * @brief Ways of putting text on the clipboard.
+ */
+enum class ClipboardBackend {
+    Auto,   // Clipboard tool when a display is available, OSC 52 over SSH or without one
+    Osc52,  // Escape sequence asking the terminal to set its clipboard; works through SSH
+    Tool,   // The platform's clipboard: Win32, pbcopy, wl-copy, xclip or xsel
+};
+
+/**
+ * @brief Parses a clipboard backend name (auto, osc52, tool).
+ *
+ * @param name The name to parse.
+ * @param backend Receives the parsed backend.
+ * @return true If the name is a known backend.
+ */
+bool ParseClipboardBackend(std::string_view name, ClipboardBackend& backend);
+
+/**
+ * @brief Appends the base64 encoding of data, with padding and without line breaks. Bytes are
+ *        split into 6-bit values three at a time and translated to characters 16 at a time with
+ *        SSE2 compares instead of a table lookup per character.
+ *
+ * @param data The bytes to encode.
+ * @param out Buffer to append to.
+ */
+void AppendBase64(std::string_view data, std::string& out);
+
+/**
+ * @brief Copies the given text to the system clipboard.
+ *        OSC 52 streams the text to the controlling terminal in base64 chunks, wrapped for tmux
+ *        or screen when running inside them. Texts above the terminal limit (1 MiB by default,
+ *        REPOTOTXT_OSC52_LIMIT overrides it in bytes) are not sent, since terminals drop or cut
+ *        oversized sequences; Auto then falls back to a clipboard tool. Tools are started
+ *        directly, without a shell, and fed through a pipe.
+ *
+ * @param text The text to copy to the clipboard.
+ * @param backend The backend to use.
+ * @return true If the operation was successful.
+ * @return false Otherwise.
+ */
+bool CopyToClipboard(std::string_view text, ClipboardBackend backend = ClipboardBackend::Auto);
+
+}  // namespace Utils
+
+#endif  // CLIPBOARD_HPP
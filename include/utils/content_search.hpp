@@ -0,0 +1,107 @@
+#ifndef CONTENT_SEARCH_HPP
+#define CONTENT_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/parallel_for.hpp"
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+/**
+ * @brief Finds the lines of a text that contain a literal or match a regular expression.
+ *        Candidates are located with memchr on the rarest byte of a literal the pattern
+ *        requires, so most of a file is skipped without being looked at; for regular
+ *        expressions only the lines holding that literal are handed to std::regex. Matching is
+ *        line by line, like grep. Copies share the compiled expression and are thread-safe.
+ */
+class ContentMatcher {
+   public:
+    /**
+     * @brief Compiles a pattern.
+     *
+     * @param pattern The text to find, or an ECMAScript regular expression when regex is set.
+     * @param regex Whether the pattern is a regular expression.
+     * @param ignore_case Whether to ignore ASCII case.
+     * @param matcher Receives the compiled matcher.
+     * @param error Receives a description of the problem if the pattern is invalid.
+     * @return true If the pattern compiled.
+     * @return false Otherwise.
+     */
+    static bool Compile(const std::string& pattern, bool regex, bool ignore_case, ContentMatcher& matcher, std::string& error);
+
+    /**
+     * @brief Calls visit with the 1-based number and the text of every matching line, in
+     *        order, until visit returns false.
+     */
+    void ForEachMatchingLine(std::string_view text, const std::function<bool(uint32_t line, std::string_view text)>& visit) const;
+
+    /**
+     * @brief Tells whether any line of the text matches.
+     */
+    bool Matches(std::string_view text) const;
+
+    const std::string& Pattern() const {
+        return pattern;
+    }
+
+   private:
+    size_t FindLiteral(std::string_view text, size_t from) const;
+    bool LineMatches(std::string_view line) const;
+
+    std::string pattern;
+    bool ignore_case = false;
+    std::string literal;  // Required by every match, lower-cased when ignoring case; may be empty
+    size_t anchor = 0;    // Position in literal of the byte memchr looks for
+    std::shared_ptr<const std::regex> expression;  // Null for plain literal searches
+};
+
+/**
+ * @brief Formats the matching lines of a text with some context as "L<n>: line" for matches
+ *        and "L<n>- line" for context, with "--" between groups that are not adjacent.
+ *
+ * @param text The text to search.
+ * @param matcher The matcher to apply.
+ * @param context Lines of context before and after each match.
+ * @param out Buffer to append to.
+ * @param shown Text the lines are printed from, with the same lines as text, such as text with
+ *              its secrets redacted; empty to print text itself.
+ */
+void FormatMatchSnippets(std::string_view text, const ContentMatcher& matcher, unsigned context, std::string& out, std::string_view shown = {});
+
+/**
+ * @brief Searches the given files of a scan index in parallel and returns the ones with a
+ *        matching line. Binary files never match.
+ *
+ * @param table Scan index holding the files.
+ * @param files Table indices of the candidate files.
+ * @param matcher The matcher to apply.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ * @param io_slots Optional limit on concurrent file reads.
+ * @return Table indices of the matching files, in the order given.
+ */
+std::vector<uint32_t> SearchFiles(const PathTable& table, const std::vector<uint32_t>& files, const ContentMatcher& matcher, unsigned thread_count = 0, Semaphore* io_slots = nullptr);
+
+/**
+ * @brief Narrows a selection down to the regular files below it whose content matches.
+ *        Exclude rules have already been applied to the selection, so they carry over.
+ *
+ * @param selected_paths The selected files and directories.
+ * @param matcher The matcher to apply.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ * @return The matching files.
+ */
+std::set<std::filesystem::path> FilterSelectionByContent(const std::set<std::filesystem::path>& selected_paths, const ContentMatcher& matcher, unsigned thread_count = 0);
+
+}  // namespace Utils
+
+#endif  // CONTENT_SEARCH_HPP
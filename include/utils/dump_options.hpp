@@ -0,0 +1,76 @@
+#ifndef DUMP_OPTIONS_HPP
+#define DUMP_OPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/clipboard.hpp"
+#include "utils/output_template.hpp"
+#include "utils/parallel_for.hpp"
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+class ContentMatcher;
+class DumpManifest;
+
+/**
+ * @brief Options controlling how the tree and the file contents are written out.
+ */
+struct DumpOptions {
+    OutputTemplates templates = OutputTemplates::ForFormat(OutputFormat::Plain);  // Compiled once, applied per file
+    bool minify = false;                                                          // Strip comments and redundant whitespace
+    bool normalize = true;                                                        // Transcode contents to UTF-8 with LF line endings
+    bool redact = true;                                                           // Replace credentials found in file contents
+    bool annotate = false;                                                        // Show size, lines and tokens in the tree
+    NameOrder order = NameOrder::Bytewise;                                        // How names are ordered in the tree and the contents
+    uint64_t split_bytes = 0;                                                     // Maximum size of one output part; 0 disables splitting
+    std::string split_prefix;                                                     // Parts are written to <prefix>.001, <prefix>.002, ...
+    unsigned threads = 0;                                                         // Threads for walking and per-file work; 0 picks a default
+    Semaphore* io_slots = nullptr;                                                // Caps concurrent file reads when shared between dumps
+    std::shared_ptr<const ContentMatcher> search;                                 // Content search the selection was narrowed with, if any
+    int snippet_context = -1;                                                     // With a search, cut bodies down to matches and this many
+                                                                                  // lines around them; -1 keeps whole files
+    std::shared_ptr<const DumpManifest> since;                                    // Earlier dump; files it holds unchanged are left out
+    bool diff = false;                                                            // With since, write changed files as unified diffs
+    std::string manifest_for;                                                     // Dump file to write a <dump>.manifest next to, if any
+    DumpManifest* manifest = nullptr;                                             // Receives an entry per file, written or left out
+    ClipboardBackend clipboard = ClipboardBackend::Auto;                          // How copy actions reach the clipboard
+};
+
+/**
+ * @brief A secret that was replaced in the output.
+ */
+struct Redaction {
+    std::string path;
+    uint32_t line;     // 1-based line the secret starts on
+    const char* kind;  // e.g. "aws-access-key"; points to static storage
+};
+
+/**
+ * @brief A file that differs from the earlier dump a delta was taken against.
+ */
+struct FileChange {
+    std::string path;
+    char kind;  // 'A' added, 'M' modified or 'D' deleted
+};
+
+/**
+ * @brief Counters collected while dumping file contents.
+ */
+struct DumpStats {
+    size_t files = 0;                   // Files written out
+    uint64_t bytes_read = 0;            // Bytes read from disk
+    uint64_t minified_bytes_in = 0;     // Bytes that entered the minifier
+    uint64_t minified_bytes_out = 0;    // Bytes that left the minifier
+    std::vector<Redaction> redactions;  // Secrets replaced, in output order
+    size_t unchanged = 0;               // Files left out because the earlier dump holds them
+    std::vector<FileChange> changes;    // With since: added and modified in output order, then deleted
+};
+
+}  // namespace Utils
+
+#endif  // DUMP_OPTIONS_HPP
@@ -0,0 +1,95 @@
+#ifndef FILE_METRICS_HPP
+#define FILE_METRICS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/parallel_for.hpp"
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+/**
+ * @brief Size counters for a file, or the rolled-up totals of a directory.
+ */
+struct FileMetrics {
+    uint64_t files = 0;  // Regular files counted
+    uint64_t bytes = 0;  // Total size in bytes
+    uint64_t lines = 0;  // Total line count; a final line without '\n' still counts
+
+    void Add(const FileMetrics& other) {
+        files += other.files;
+        bytes += other.bytes;
+        lines += other.lines;
+    }
+};
+
+/**
+ * @brief Remembers measured files by path, size and modification time, so that repeated
+ *        measurements of an unchanged selection only cost a stat per file. Thread-safe.
+ */
+class MetricsCache {
+   public:
+    bool Lookup(const std::string& path, uint64_t size, std::filesystem::file_time_type time, FileMetrics& metrics) const;
+    void Store(const std::string& path, uint64_t size, std::filesystem::file_time_type time, const FileMetrics& metrics);
+
+   private:
+    struct Entry {
+        uint64_t size;
+        std::filesystem::file_time_type time;
+        FileMetrics metrics;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+/**
+ * @brief Counts the '\n' bytes in a buffer, 16 bytes per step where SSE2 is available.
+ *
+ * @param data Start of the buffer.
+ * @param size Size of the buffer in bytes.
+ * @return The number of newline characters.
+ */
+uint64_t CountNewlines(const char* data, size_t size);
+
+/**
+ * @brief Reads a file in fixed-size chunks and counts its bytes and lines.
+ *
+ * @param path The file to measure.
+ * @param metrics Receives the counters of the file.
+ * @return true If the file could be read.
+ * @return false Otherwise.
+ */
+bool MeasureFile(const std::filesystem::path& path, FileMetrics& metrics);
+
+/**
+ * @brief Measures every regular file in the scan index in parallel, then rolls the counters
+ *        up so that each directory holds the totals of its subtree.
+ *
+ * @param table Scan index produced by the parallel walker.
+ * @param cache Optional cache consulted before reading a file and updated afterwards.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ * @param io_slots Optional limit on concurrent file reads.
+ * @return One entry per table index.
+ */
+std::vector<FileMetrics> ComputeTreeMetrics(const PathTable& table, MetricsCache* cache = nullptr, unsigned thread_count = 0, Semaphore* io_slots = nullptr);
+
+/**
+ * @brief Formats counters for display, e.g. "12.4 KiB, 420 lines, ~3.2k tokens".
+ *        The file count is included when with_files is set.
+ *
+ * @param metrics The counters to format.
+ * @param with_files Whether to prefix the number of files.
+ * @return The formatted text.
+ */
+std::string FormatMetrics(const FileMetrics& metrics, bool with_files);
+
+}  // namespace Utils
+
+#endif  // FILE_METRICS_HPP
@@ -0,0 +1,67 @@
+#ifndef INCLUDE_CLOSURE_HPP
+#define INCLUDE_CLOSURE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <set>
+#include <vector>
+
+namespace Utils {
+
+/**
+ * @brief Tells whether a path names a C, C++ or Objective-C source or header by its extension.
+ */
+bool IsCFamilySource(const std::filesystem::path& path);
+
+/**
+ * @brief Collects the include directories of a compilation database: every -I, -iquote and
+ *        -isystem directory (and /I for MSVC) of every entry, made absolute against the
+ *        entry's directory, without duplicates and in order of first appearance.
+ *
+ * @param compile_commands Path of a compile_commands.json file.
+ * @return The include directories, or an empty vector if the file cannot be read.
+ */
+std::vector<std::filesystem::path> ReadCompileCommandsIncludeDirs(const std::filesystem::path& compile_commands);
+
+/**
+ * @brief Returns the directories in which quoted includes are looked up: the given ones first,
+ *        then those of a compile_commands.json at the root or in a directory directly below it
+ *        (build, out, cmake-build-debug, ...).
+ *
+ * @param root Root of the project.
+ * @param extra Directories given explicitly, such as with --include-dir.
+ * @return The include directories, absolute and without duplicates.
+ */
+std::vector<std::filesystem::path> FindIncludeDirs(const std::filesystem::path& root, const std::vector<std::filesystem::path>& extra);
+
+/**
+ * @brief Follows #include "..." directives transitively from the given sources. A quoted include
+ *        is looked up next to the including file first, then in the include directories, like a
+ *        compiler does; angle-bracket includes name system headers and are not followed.
+ *        The header graph is explored breadth-first: every level is scanned in parallel, each
+ *        file is read once and each lookup is resolved once, however many files share it.
+ *        Files outside the root are neither followed nor returned.
+ *
+ * @param sources Files to start from; must be absolute.
+ * @param root Root of the project.
+ * @param include_dirs Directories in which quoted includes are looked up, in order.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ * @return The sources and every file they include, directly or not.
+ */
+std::set<std::filesystem::path> IncludeClosure(const std::vector<std::filesystem::path>& sources, const std::filesystem::path& root, const std::vector<std::filesystem::path>& include_dirs, unsigned thread_count = 0);
+
+/**
+ * @brief Adds to a selection every project file that its C and C++ files include, directly or
+ *        not. Files already covered by a selected directory are not added again.
+ *
+ * @param selected_paths The selected files and directories; absolute.
+ * @param root Root of the project.
+ * @param include_dirs Directories in which quoted includes are looked up, in order.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ * @return Number of paths added to the selection.
+ */
+size_t AddIncludeClosure(std::set<std::filesystem::path>& selected_paths, const std::filesystem::path& root, const std::vector<std::filesystem::path>& include_dirs, unsigned thread_count = 0);
+
+}  // namespace Utils
+
+#endif  // INCLUDE_CLOSURE_HPP
@@ -0,0 +1,126 @@
+#ifndef MINIFIER_HPP
+#define MINIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Utils {
+
+/**
+ * @brief Lexer families understood by the minifier.
+ */
+enum class SourceLanguage {
+    Text,    // Unknown type: only whitespace is touched
+    CLike,   // C, C++, Java, C# and friends: // and /* */ comments
+    Script,  // JavaScript and TypeScript: C-like, plus /regular expression/ literals
+    Python,  // # comments, single and triple quoted strings
+    Shell,   // # comments at word start, quoting rules and here-documents
+};
+
+/**
+ * @brief Picks the lexer for a file from its extension.
+ *
+ * @param path Path of the file.
+ * @return The language family, or SourceLanguage::Text if the type is unknown.
+ */
+SourceLanguage DetectSourceLanguage(std::string_view path);
+
+/**
+ * @brief Streaming transform that removes comments, trailing whitespace and runs of blank lines.
+ *        The input can be fed in arbitrary chunks; all lexer state lives in fixed-size members,
+ *        so the only memory touched is the caller's output buffer. String literals, including
+ *        raw strings, triple-quoted strings and here-documents, are always copied verbatim.
+ */
+class Minifier {
+   public:
+    explicit Minifier(SourceLanguage language);
+
+    /**
+     * @brief Processes the next chunk of input, appending the minified text to out.
+     */
+    void Feed(std::string_view chunk, std::string& out);
+
+    /**
+     * @brief Flushes any state held back at the end of the input.
+     */
+    void Finish(std::string& out);
+
+    uint64_t BytesIn() const {
+        return bytes_in;
+    }
+    uint64_t BytesOut() const {
+        return bytes_out;
+    }
+
+   private:
+    enum class State : uint8_t {
+        Code,
+        LineComment,
+        BlockComment,
+        KeepLine,      // Shebang line, copied as is
+        String,        // "..." '...' `...`
+        Regex,         // Script: /.../ literal, including [...] classes
+        QuoteRun,      // Python: counting opening quotes to tell "", "x" and """ apart
+        TripleString,  // Python """...""" and '''...'''
+        RawDelimiter,  // C++ R"delim( : collecting the delimiter
+        RawString,     // C++ raw string body
+        HeredocMarker, // Shell: reading the word after <<
+        HeredocBody,   // Shell: here-document lines until the terminator
+    };
+
+    static constexpr size_t kMaxPendingWhitespace = 128;
+    static constexpr size_t kMaxDelimiter = 32;
+
+    SourceLanguage language;
+    State state = State::Code;
+
+    // Whitespace held back until we know whether it is trailing
+    char pending_whitespace[kMaxPendingWhitespace];
+    size_t pending_length = 0;
+
+    // Line bookkeeping
+    bool line_has_content = false;
+    bool line_had_comment = false;
+    bool previous_line_blank = true;  // Suppresses blank lines at the start of the file
+    bool at_file_start = true;
+
+    // Lexer state
+    char previous = '\n';         // Last character consumed in code
+    char quote = 0;               // Quote character of the open string
+    bool escaped = false;         // Previous character was a backslash
+    bool pending_slash = false;   // C-like: saw '/', waiting for the next character
+    bool pending_star = false;    // C-like: saw '*' inside a block comment
+    bool pending_hash = false;    // Saw '#' at the start of the file; may be a shebang
+    bool in_number = false;       // C-like: inside a numeric literal (for 1'000 separators)
+    bool regex_allowed = true;    // Script: a '/' here starts a regular expression, not a division
+    bool in_class = false;        // Script: inside a [...] class of a regular expression
+    int quote_run = 0;            // Consecutive quote characters seen
+    char identifier[10] = {};     // First characters of the current identifier
+    size_t identifier_length = 0;
+
+    // C++ raw strings and shell here-documents share the delimiter buffer
+    char delimiter[kMaxDelimiter];
+    size_t delimiter_length = 0;
+    size_t match_length = 0;      // Characters of the terminator matched so far
+    bool heredoc_strip_tabs = false;
+    bool heredoc_pending = false;  // Body starts at the next newline
+    bool heredoc_line_matches = true;
+
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+
+    void Consume(char c, std::string& out);
+    void ConsumeCode(char c, std::string& out);
+    void EmitContent(char c, std::string& out);
+    void EmitVerbatim(char c, std::string& out);
+    void EndLine(std::string& out);
+    void TrackIdentifier(char c);
+    bool RawStringPrefix() const;
+    bool RegexMayFollow(char c) const;
+};
+
+}  // namespace Utils
+
+#endif  // MINIFIER_HPP
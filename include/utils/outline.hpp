@@ -0,0 +1,95 @@
+#ifndef OUTLINE_HPP
+#define OUTLINE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/dump_options.hpp"
+#include "utils/path_table.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+/**
+ * @brief One declaration found by the outline extractor.
+ */
+struct OutlineEntry {
+    uint32_t line;          // 1-based line where the declaration starts
+    uint32_t depth;         // Nesting level (namespaces, classes, indentation)
+    std::string signature;  // The declaration with whitespace collapsed and the body left out
+};
+
+/**
+ * @brief Extracts class, struct, namespace and function declarations from a source file.
+ *        This is a tolerant single-pass scan, not a parser: C-like files are tracked by brace
+ *        nesting with comments, strings and preprocessor lines skipped; Python and shell use
+ *        their definition keywords; other files fall back to common declaration keywords, and
+ *        Markdown files to their headings.
+ *
+ * @param path Path of the file, used to pick the language.
+ * @param content Content of the file.
+ * @param entries Receives the declarations, in file order.
+ */
+void ExtractOutline(std::string_view path, std::string_view content, std::vector<OutlineEntry>& entries);
+
+/**
+ * @brief Formats outline entries as "L<line>: <signature>" lines, indented by depth.
+ *
+ * @param entries The entries to format.
+ * @param out Buffer to append to.
+ */
+void FormatOutline(const std::vector<OutlineEntry>& entries, std::string& out);
+
+/**
+ * @brief Reads and outlines every regular file below the selected paths, in parallel batches,
+ *        and hands each formatted outline to the visitor in output order.
+ *
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param options Output options; the thread count, I/O slots, normalization and redaction are used.
+ * @param visit Called once per file, with the outline as the body.
+ * @return Counters describing what was read.
+ */
+DumpStats VisitFileOutlines(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options, const FileVisitor& visit);
+
+/**
+ * @brief Outlines the given files of a scan index, as VisitFileOutlines does for a selection.
+ *
+ * @param table Scan index holding the files.
+ * @param files Table indices of the files, in output order.
+ * @param options Output options; the thread count, normalization and redaction are used.
+ * @param read Supplies the contents of a file; called from several threads at once.
+ * @param visit Called once per file, with the outline as the body.
+ * @return Counters describing what was read.
+ */
+DumpStats VisitFileOutlines(const PathTable& table, const std::vector<uint32_t>& files, const DumpOptions& options, const FileReader& read, const FileVisitor& visit);
+
+/**
+ * @brief Prints the outline of every selected file instead of its full contents.
+ *        Files are read and scanned in parallel; the output keeps the order of PrintFileContents
+ *        and goes through the same output templates.
+ *
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param out_stream The output stream to write the outlines to.
+ * @param options Output options.
+ * @return Counters describing what was written.
+ */
+DumpStats PrintFileOutlines(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Prints the outline of every selected file from an existing scan index.
+ *
+ * @param table Scan index holding the selected paths and everything beneath them.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param out_stream The output stream to write the outlines to.
+ * @param options Output options.
+ * @return Counters describing what was written.
+ */
+DumpStats PrintFileOutlines(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+}  // namespace Utils
+
+#endif  // OUTLINE_HPP
@@ -0,0 +1,135 @@
+#ifndef OUTPUT_TEMPLATE_HPP
+#define OUTPUT_TEMPLATE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Utils {
+
+/**
+ * @brief Output formats for the dumped file contents.
+ */
+enum class OutputFormat {
+    Plain,     // "Contents of <path>:" headers, the historical format
+    Markdown,  // Headings plus fenced code blocks with a language tag
+    Xml,       // <file path="..."> wrappers
+    Json,      // One JSON object per line
+};
+
+/**
+ * @brief Escaping applied to the substituted path and content of a template.
+ */
+enum class TemplateEscape {
+    None,
+    Xml,
+    Json,
+};
+
+/**
+ * @brief A format spec compiled into a flat list of emit operations.
+ *        The spec is plain text with the placeholders {path}, {lang}, {fence} and {content};
+ *        "{{" and "}}" stand for literal braces. Compiling happens once, so emitting a file is a
+ *        walk over a handful of operations with no parsing or formatting work.
+ */
+class OutputTemplate {
+   public:
+    /**
+     * @brief Compiles a format spec.
+     *
+     * @param spec The spec to compile.
+     * @param escape Escaping applied to {path} and {content}.
+     * @param result Receives the compiled template.
+     * @param error Receives a description of the problem if compilation fails.
+     * @return true If the spec compiled.
+     * @return false If the spec contains an unknown or unterminated placeholder.
+     */
+    static bool Compile(std::string_view spec, TemplateEscape escape, OutputTemplate& result, std::string& error);
+
+    /**
+     * @brief Appends the template, filled in for one file, to the given buffer.
+     *
+     * @param path Path of the file.
+     * @param content Content of the file.
+     * @param out Buffer to append to.
+     * @param content_offset If not null, receives where in out the content starts, or
+     *                       std::string::npos if it is escaped or not part of the template.
+     */
+    void Emit(std::string_view path, std::string_view content, std::string& out, size_t* content_offset = nullptr) const;
+
+    bool Empty() const {
+        return ops.empty();
+    }
+
+   private:
+    enum class OpCode : unsigned char {
+        Literal,
+        Path,
+        Language,
+        Fence,
+        Content,
+    };
+
+    struct Op {
+        OpCode code;
+        size_t offset = 0;  // Literal text location in `literals`
+        size_t length = 0;
+    };
+
+    std::string literals;
+    std::vector<Op> ops;
+    TemplateEscape escape = TemplateEscape::None;
+    bool uses_fence = false;
+};
+
+/**
+ * @brief The compiled templates for one output format: one per file, one for files that could
+ *        not be read and one wrapping the directory tree.
+ */
+struct OutputTemplates {
+    OutputTemplate file;
+    OutputTemplate error;
+    OutputTemplate tree;
+
+    /**
+     * @brief Returns the built-in templates for a format.
+     */
+    static const OutputTemplates& ForFormat(OutputFormat format);
+};
+
+/**
+ * @brief Parses an output format name (plain, markdown, xml, json).
+ *
+ * @param name The name to parse.
+ * @param format Receives the parsed format.
+ * @return true If the name is a known format.
+ * @return false Otherwise.
+ */
+bool ParseOutputFormat(std::string_view name, OutputFormat& format);
+
+/**
+ * @brief Returns the escaping a format applies to paths and contents.
+ */
+TemplateEscape EscapeForFormat(OutputFormat format);
+
+/**
+ * @brief Returns the Markdown language tag for a file, based on its extension or name.
+ *
+ * @param path Path of the file.
+ * @return The language tag, or an empty string if the type is unknown.
+ */
+std::string_view LanguageTag(std::string_view path);
+
+/**
+ * @brief Appends text to a buffer as the body of a JSON string.
+ */
+void AppendJsonEscaped(std::string_view text, std::string& out);
+
+/**
+ * @brief Appends text to a buffer with XML special characters replaced by entities.
+ */
+void AppendXmlEscaped(std::string_view text, std::string& out);
+
+}  // namespace Utils
+
+#endif  // OUTPUT_TEMPLATE_HPP
@@ -0,0 +1,64 @@
+#ifndef PARALLEL_FOR_HPP
+#define PARALLEL_FOR_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace Utils {
+
+/**
+ * @brief Returns the number of worker threads to use for CPU-bound work over files.
+ */
+unsigned DefaultThreadCount();
+
+/**
+ * @brief Calls body(i) for every i in [0, count) on a set of worker threads.
+ *        Indices are handed out dynamically, so uneven per-item costs balance out.
+ *        Returns once every call has finished.
+ *
+ * @param count Number of items.
+ * @param body Function invoked once per item; must be safe to call concurrently.
+ * @param thread_count Number of threads, or 0 for DefaultThreadCount().
+ */
+void ParallelFor(size_t count, const std::function<void(size_t)>& body, unsigned thread_count = 0);
+
+/**
+ * @brief Counting semaphore used to cap how many threads touch a shared resource at once,
+ *        such as the disk when several dumps run side by side.
+ */
+class Semaphore {
+   public:
+    explicit Semaphore(unsigned count);
+
+    void Acquire();
+    void Release();
+
+   private:
+    std::mutex mutex;
+    std::condition_variable available;
+    unsigned count;
+};
+
+/**
+ * @brief Holds one slot of a semaphore for its lifetime. A null semaphore means no limit.
+ */
+class SemaphoreGuard {
+   public:
+    explicit SemaphoreGuard(Semaphore* semaphore) : semaphore(semaphore) {
+        if (semaphore != nullptr) semaphore->Acquire();
+    }
+    ~SemaphoreGuard() {
+        if (semaphore != nullptr) semaphore->Release();
+    }
+    SemaphoreGuard(const SemaphoreGuard&) = delete;
+    SemaphoreGuard& operator=(const SemaphoreGuard&) = delete;
+
+   private:
+    Semaphore* semaphore;
+};
+
+}  // namespace Utils
+
+#endif  // PARALLEL_FOR_HPP
@@ -0,0 +1,29 @@
+#ifndef PARALLEL_WALKER_HPP
+#define PARALLEL_WALKER_HPP
+
+#include <filesystem>
+#include <vector>
+
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+/**
+ * @brief Walks the given roots on several threads and records every entry found beneath them.
+ *        Each worker owns a deque of pending directories and steals from the others once its
+ *        own deque runs dry. On POSIX systems entry types come from readdir's d_type, so only
+ *        symlinks and filesystems that report DT_UNKNOWN cost an extra stat.
+ *        Directories that cannot be opened are skipped. Symlinked directories are reported but
+ *        not followed, matching std::filesystem::recursive_directory_iterator.
+ *
+ * @param roots Files and directories to walk. They are made absolute and flagged as selected.
+ * @param thread_count Number of worker threads, or 0 to pick one from the hardware concurrency.
+ * @param order How names are ordered in the table's listings.
+ * @return A finalized table holding the roots, their ancestors and everything beneath them,
+ *         with each path present exactly once.
+ */
+PathTable ParallelWalk(const std::vector<std::filesystem::path>& roots, unsigned thread_count = 0, NameOrder order = NameOrder::Bytewise);
+
+}  // namespace Utils
+
+#endif  // PARALLEL_WALKER_HPP
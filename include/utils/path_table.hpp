@@ -0,0 +1,181 @@
+#ifndef PATH_TABLE_HPP
+#define PATH_TABLE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Utils {
+
+/**
+ * @brief How names are ordered in listings. Both compare bytes as unsigned values, never through
+ *        the locale, so a listing is the same on every machine.
+ */
+enum class NameOrder : uint8_t {
+    Bytewise,  // Plain byte order
+    Natural,   // Runs of digits compare by their numeric value, so file2 comes before file10
+};
+
+/**
+ * @brief Compact storage for a set of paths discovered during a scan.
+ *        All names live in one string arena; every entry only records its parent index and the
+ *        location of its own name, so a path costs a few dozen bytes instead of a heap-allocated
+ *        std::filesystem::path. Once Finalize() has run, children are grouped per parent, both
+ *        by name for lookups and in the canonical listing order (directories first, then names
+ *        in the table's NameOrder) that the tree, the contents and the UI all print in.
+ */
+class PathTable {
+   public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // Entry flags
+    static constexpr uint8_t kDirectory = 1 << 0;    // Directory, or symlink to one
+    static constexpr uint8_t kRegularFile = 1 << 1;  // Regular file, or symlink to one
+    static constexpr uint8_t kSymlink = 1 << 2;      // The entry itself is a symlink
+    static constexpr uint8_t kSelected = 1 << 3;     // Passed in as a root of the scan
+    static constexpr uint8_t kInterned = 1 << 4;     // Added through Intern(); may be discovered again
+
+    struct Entry {
+        uint32_t parent;       // Index of the parent entry, or kNone for a top-level component
+        uint32_t name_offset;  // Offset of the name in the arena
+        uint32_t name_length;  // Length of the name in bytes
+        uint32_t rank;         // Position in Ordered(), valid after Finalize()
+        uint8_t flags;
+    };
+
+    /**
+     * @brief A contiguous range of entry indices.
+     */
+    struct Range {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const {
+            return first;
+        }
+        const uint32_t* end() const {
+            return last;
+        }
+        size_t size() const {
+            return static_cast<size_t>(last - first);
+        }
+        bool empty() const {
+            return first == last;
+        }
+    };
+
+    /**
+     * @brief Adds a path component by component, reusing entries that already exist.
+     *
+     * @param path The path to add. Absolute paths start with their root component.
+     * @param flags Flags for the final component; ancestors are marked as directories.
+     * @return Index of the final component.
+     */
+    uint32_t Intern(const std::filesystem::path& path, uint8_t flags);
+
+    /**
+     * @brief Appends a child entry without checking for duplicates, unless the parent was
+     *        interned, in which case an existing child of the same name is reused.
+     *
+     * @param parent Index of the parent entry.
+     * @param name Name of the child.
+     * @param flags Entry flags.
+     * @return Index of the child.
+     */
+    uint32_t AddChild(uint32_t parent, std::string_view name, uint8_t flags);
+
+    /**
+     * @brief Groups children per parent, sorts them by name and into the canonical listing order,
+     *        and computes the rank of every entry. Sort keys are computed once per entry, so
+     *        sibling comparisons are mostly a single integer compare. Must be called after the
+     *        last insertion and before any of the ordered accessors.
+     *
+     * @param order How names are ordered in listings.
+     */
+    void Finalize(NameOrder order = NameOrder::Bytewise);
+
+    size_t size() const {
+        return entries.size();
+    }
+    const Entry& operator[](uint32_t index) const {
+        return entries[index];
+    }
+    std::string_view Name(uint32_t index) const {
+        return std::string_view(arena.data() + entries[index].name_offset, entries[index].name_length);
+    }
+    bool Is(uint32_t index, uint8_t flag) const {
+        return (entries[index].flags & flag) != 0;
+    }
+
+    /**
+     * @brief Appends the full path of an entry to the given string.
+     */
+    void AppendPath(uint32_t index, std::string& out) const;
+
+    /**
+     * @brief Returns the full path of an entry as a string.
+     */
+    std::string PathString(uint32_t index) const;
+
+    /**
+     * @brief Returns the full path of an entry as a std::filesystem::path.
+     */
+    std::filesystem::path Path(uint32_t index) const;
+
+    /**
+     * @brief Looks up a path in the finalized table.
+     *
+     * @return The index of the entry, or kNone if the path is not in the table.
+     */
+    uint32_t Find(const std::filesystem::path& path) const;
+
+    /**
+     * @brief Returns the children of an entry sorted by name. Requires Finalize().
+     */
+    Range Children(uint32_t index) const;
+
+    /**
+     * @brief Returns the top-level entries sorted by name. Requires Finalize().
+     */
+    Range Roots() const;
+
+    /**
+     * @brief Returns the children of an entry in listing order: directories first, then by name
+     *        in the table's NameOrder. Requires Finalize().
+     */
+    Range Listing(uint32_t index) const;
+
+    /**
+     * @brief Returns the top-level entries in listing order. Requires Finalize().
+     */
+    Range RootListing() const;
+
+    /**
+     * @brief Returns every entry index in listing order, each directory followed by everything
+     *        beneath it. Requires Finalize().
+     */
+    const std::vector<uint32_t>& Ordered() const {
+        return ordered;
+    }
+
+   private:
+    std::string arena;
+    std::vector<Entry> entries;
+    std::map<std::pair<uint32_t, std::string>, uint32_t> interned;  // Only holds Intern()'ed entries
+
+    // Filled by Finalize()
+    std::vector<uint32_t> child_offsets;  // children of entry i are child_indices[child_offsets[i] .. child_offsets[i + 1])
+    std::vector<uint32_t> child_indices;  // the last slot group holds the top-level entries
+    std::vector<uint32_t> listing_indices;  // the same groups, in listing order
+    std::vector<uint32_t> ordered;
+
+    uint32_t Append(uint32_t parent, std::string_view name, uint8_t flags);
+    Range Group(const std::vector<uint32_t>& indices, size_t group) const;
+};
+
+}  // namespace Utils
+
+#endif  // PATH_TABLE_HPP
@@ -0,0 +1,70 @@
+#ifndef REDACTOR_HPP
+#define REDACTOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/dump_options.hpp"
+
+namespace Utils {
+
+/**
+ * @brief A secret found in a text: the bytes in [begin, end) are replaced on output.
+ */
+struct SecretMatch {
+    size_t begin;
+    size_t end;
+    const char* kind;
+};
+
+/**
+ * @brief Finds credentials in text with one pass of an Aho-Corasick automaton over all
+ *        trigger strings at once: well-known key prefixes (AKIA, ghp_, xoxb-, sk-, ...),
+ *        PEM private key headers, credentials in URLs and assignments to names such as
+ *        password, secret or token (or ending in them, as DB_PASSWORD). Each trigger is then
+ *        confirmed by a cheap check of what follows it; assigned values must be literals or
+ *        long bare words that look random (Shannon entropy), so code that merely mentions a
+ *        token is left alone. The automaton is built once and shared.
+ */
+class Redactor {
+   public:
+    static const Redactor& Default();
+
+    /**
+     * @brief Appends the secrets in text to matches, in order and without overlaps.
+     */
+    void Find(std::string_view text, std::vector<SecretMatch>& matches) const;
+
+   private:
+    Redactor();
+
+    struct Rule;
+    bool Confirm(const Rule& rule, std::string_view text, size_t begin, size_t end, SecretMatch& match) const;
+
+    std::vector<Rule> rules;
+    uint8_t byte_class[256];  // Bytes that appear in no trigger share class 0; case is folded
+    size_t class_count = 1;
+    std::vector<uint16_t> transitions;      // state * class_count + class -> state, failure links folded in
+    std::vector<uint16_t> first_output;     // Index into outputs of the state's triggers, or kNoOutput
+    std::vector<uint16_t> outputs;          // Rule indices, each state's list ended by kNoOutput
+    std::vector<uint64_t> start_triples;    // One bit per class triple that begins a trigger
+};
+
+/**
+ * @brief Replaces the secrets in a text. Each match becomes "[REDACTED:<kind>]" followed by the
+ *        line breaks it covered, so line numbers after it do not shift.
+ *
+ * @param path Path of the file, for the report.
+ * @param text Content of the file.
+ * @param buffer Receives the redacted text when there is anything to redact.
+ * @param report Receives one entry per secret.
+ * @return The text to use: text itself when it is clean (or binary), buffer otherwise.
+ */
+std::string_view RedactSecrets(std::string_view path, std::string_view text, std::string& buffer, std::vector<Redaction>& report);
+
+}  // namespace Utils
+
+#endif  // REDACTOR_HPP
@@ -0,0 +1,113 @@
+#ifndef SELECTION_PROFILE_HPP
+#define SELECTION_PROFILE_HPP
+
+#include <filesystem>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+/**
+ * @brief A named, reusable selection for one repository.
+ *        Paths are stored relative to the repository root with '/' separators, so a profile
+ *        keeps working when the checkout moves or is shared between machines.
+ */
+struct SelectionProfile {
+    std::vector<std::string> paths;          // Selected files and directories
+    std::vector<std::string> include_rules;  // Glob patterns; when present, only matching files are kept
+    std::vector<std::string> exclude_rules;  // Glob patterns; matching entries and their subtrees are dropped
+};
+
+/**
+ * @brief Returns where a profile is stored: <root>/.repototxt/profiles/<name>.rtp
+ *
+ * @param root The repository root.
+ * @param name The profile name.
+ * @return The profile file path.
+ */
+std::filesystem::path SelectionProfilePath(const std::filesystem::path& root, const std::string& name);
+
+/**
+ * @brief Writes a profile in the compact binary profile format.
+ *
+ * @param root The repository root.
+ * @param name The profile name.
+ * @param profile The profile to save.
+ * @return true If the profile was written.
+ * @return false Otherwise.
+ */
+bool SaveSelectionProfile(const std::filesystem::path& root, const std::string& name, const SelectionProfile& profile);
+
+/**
+ * @brief Reads a profile written by SaveSelectionProfile.
+ *
+ * @param root The repository root.
+ * @param name The profile name.
+ * @param profile Receives the loaded profile.
+ * @return true If the profile exists and is well formed.
+ * @return false Otherwise.
+ */
+bool LoadSelectionProfile(const std::filesystem::path& root, const std::string& name, SelectionProfile& profile);
+
+/**
+ * @brief Records the given selection in a profile, relative to the repository root.
+ *        Without rules the selection replaces the stored paths. With rules the selection holds
+ *        the files that survived them, so the stored paths and rules are kept and only the
+ *        entries toggled since the profile was applied are recorded: selected entries are added
+ *        to the paths, and deselected ones are removed from them, or excluded with an anchored
+ *        rule when a stored directory brings them in. Files that appear later under a stored
+ *        directory are still picked up by the rules.
+ *
+ * @param selected_paths The selected absolute paths.
+ * @param root The repository root.
+ * @param profile The profile to update.
+ * @param applied What ApplySelectionProfile returned for the profile, if it was applied.
+ */
+void StoreSelection(const std::set<std::filesystem::path>& selected_paths, const std::filesystem::path& root, SelectionProfile& profile,
+                    const std::set<std::filesystem::path>* applied = nullptr);
+
+/**
+ * @brief Resolves a profile against a fresh scan of the repository in a single pass over the
+ *        scan index: selection and exclusion are inherited from parent to child, so no
+ *        path-to-path comparisons are needed.
+ *        Without rules the result is the topmost selected entries. With rules it is the
+ *        individual files that survive them.
+ *
+ * @param profile The profile to apply.
+ * @param root The repository root.
+ * @param thread_count Threads used to scan the repository, or 0 to pick a default.
+ * @return The selected absolute paths.
+ */
+std::set<std::filesystem::path> ApplySelectionProfile(const SelectionProfile& profile, const std::filesystem::path& root, unsigned thread_count = 0);
+
+/**
+ * @brief Resolves a profile against an existing scan index of the repository. A walk of
+ *        directories below the root works too, since it records their ancestors; only files
+ *        and directories in the index can then be selected.
+ *
+ * @param profile The profile to apply.
+ * @param root The repository root.
+ * @param table Scan index holding the root, or directories below it, and everything beneath them.
+ * @return The selected absolute paths.
+ */
+std::set<std::filesystem::path> ApplySelectionProfile(const SelectionProfile& profile, const std::filesystem::path& root, const PathTable& table);
+
+/**
+ * @brief Matches a '/'-separated relative path against a glob pattern.
+ *        '*' and '?' stay within one path component, '**' spans components, and a pattern
+ *        without '/' is matched against the last component only.
+ *
+ * @param pattern The glob pattern.
+ * @param path The relative path.
+ * @return true If the path matches.
+ * @return false Otherwise.
+ */
+bool GlobMatch(std::string_view pattern, std::string_view path);
+
+}  // namespace Utils
+
+#endif  // SELECTION_PROFILE_HPP
@@ -0,0 +1,55 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils/path_table.hpp"
+
+namespace Utils {
+
+/**
+ * Wire format, all integers little-endian:
+ *   request:  u32 length | payload, where the payload is one argument per '\n'-terminated line:
+ *             the action (cat-all, cat-tree or cat-outline) followed by any of --format <name>,
+ *             --minify, --no-redact, --keep-encoding, --include <glob>, --exclude <glob> and
+ *             --path <path> (repeatable; relative paths are taken from the served root, which is
+ *             also the default).
+ *   response: a sequence of frames u32 length | u8 type | payload, where the type is
+ *             'D' (a chunk of the dump), 'E' (an error message) or 'S' (a summary line),
+ *             ended by a 'Z' frame with an empty payload.
+ * A connection may carry any number of requests, one after the other.
+ */
+
+/**
+ * @brief Serves dumps of root over a Unix socket until interrupted.
+ *        The scan index of the root is kept in memory and rebuilt only when inotify reports a
+ *        structural change; file contents are kept in an LRU cache of at most cache_bytes and
+ *        dropped as soon as the file changes. Each client is served on its own thread.
+ *        Where inotify is unavailable the index is rebuilt per request and cached contents are
+ *        checked against the file's size and modification time before use.
+ *
+ * @param root The directory to serve.
+ * @param socket_path Where to create the socket.
+ * @param cache_bytes Capacity of the content cache.
+ * @param order Listing order of every dump served.
+ * @return The process exit status.
+ */
+int RunServer(const std::filesystem::path& root, const std::string& socket_path, size_t cache_bytes, NameOrder order = NameOrder::Bytewise);
+
+/**
+ * @brief Sends one request to a running server and streams the dump to out.
+ *
+ * @param socket_path The server's socket.
+ * @param request The request arguments, starting with the action.
+ * @param out The output stream to write the dump to; errors and the summary go to stderr.
+ * @return The process exit status.
+ */
+int RunClient(const std::string& socket_path, const std::vector<std::string>& request, std::ostream& out);
+
+}  // namespace Utils
+
+#endif  // SERVER_HPP
@@ -0,0 +1,68 @@
+#ifndef SPLIT_WRITER_HPP
+#define SPLIT_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "utils/output_template.hpp"
+
+namespace Utils {
+
+/**
+ * @brief Cuts a dump into parts of bounded size as it is produced.
+ *        Every part starts with the same header (the rendered tree) and holds whole files; a
+ *        file too large for one part is spread over several parts at line boundaries, each
+ *        piece wrapped in the file template again so every part stays well formed. Only the
+ *        part being filled is kept in memory; full parts are handed to the sink immediately.
+ */
+class SplitWriter {
+   public:
+    /**
+     * @brief Receives a finished part and its 1-based number. Returns false to stop writing.
+     */
+    using PartSink = std::function<bool(std::string_view part, size_t number)>;
+
+    /**
+     * @param header Text repeated at the top of every part.
+     * @param max_bytes Maximum size of a part, header included.
+     * @param templates Templates used to wrap files and their pieces.
+     * @param sink Receives the parts in order.
+     */
+    SplitWriter(std::string header, uint64_t max_bytes, const OutputTemplates& templates, PartSink sink);
+
+    /**
+     * @brief Adds one file of the dump, as passed to a FileVisitor.
+     */
+    void AddFile(std::string_view path, std::string_view body, bool readable);
+
+    /**
+     * @brief Adds the trailer after the last file, in a new part when it does not fit in the
+     *        current one, and hands the last, partially filled part to the sink.
+     *
+     * @param trailer Text closing the dump, such as the change list of a delta; may be empty.
+     * @return The number of parts written.
+     */
+    size_t Finish(std::string_view trailer = {});
+
+   private:
+    std::string header;
+    uint64_t budget;  // Bytes available for files in each part
+    const OutputTemplates& templates;
+    PartSink sink;
+
+    std::string part;  // Header followed by the files added so far
+    std::string block; // The file currently being added
+    size_t parts = 0;
+    bool stopped = false;
+
+    void AddBlock(std::string_view text);
+    void AddPieces(std::string_view path, std::string_view body);
+    void Flush();
+};
+
+}  // namespace Utils
+
+#endif  // SPLIT_WRITER_HPP
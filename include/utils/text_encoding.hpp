@@ -0,0 +1,49 @@
+#ifndef TEXT_ENCODING_HPP
+#define TEXT_ENCODING_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Utils {
+
+/**
+ * @brief Encodings a file's text can be read in.
+ */
+enum class TextEncoding {
+    Utf8,     // Also plain ASCII
+    Utf16LE,  // With a BOM, or recognised by its NUL bytes
+    Utf16BE,
+    Latin1,   // Bytes above 0x7F that never form UTF-8 sequences
+    Binary,   // NUL bytes that do not look like UTF-16; left alone
+};
+
+/**
+ * @brief Guesses the encoding of a text. Byte order marks decide when present; otherwise text
+ *        whose NUL bytes sit almost only at odd (or even) offsets is taken as UTF-16, other text
+ *        with NULs as binary, and the rest as UTF-8; NormalizeText tells Latin-1 apart while it
+ *        scans, as that takes a full pass.
+ *
+ * @param text The raw contents of a file.
+ * @param bom_length Receives the length of the byte order mark, or 0.
+ * @return The encoding.
+ */
+TextEncoding DetectTextEncoding(std::string_view text, size_t& bom_length);
+
+/**
+ * @brief Normalizes a text to UTF-8 with LF line endings: the byte order mark is dropped,
+ *        UTF-16 and Latin-1 are transcoded, CRLF and lone CR become LF, and byte sequences that
+ *        are not valid in the source encoding (such as unpaired surrogates) are removed.
+ *        ASCII is handled 16 bytes at a time, so text that needs no change is only scanned and
+ *        returned as it is. Binary content is returned unchanged.
+ *
+ * @param text The raw contents of a file.
+ * @param buffer Receives the normalized text when anything had to change.
+ * @param encoding Receives the detected encoding, if not null.
+ * @return The text to use: text itself when it was already normalized, buffer otherwise.
+ */
+std::string_view NormalizeText(std::string_view text, std::string& buffer, TextEncoding* encoding = nullptr);
+
+}  // namespace Utils
+
+#endif  // TEXT_ENCODING_HPP
@@ -0,0 +1,112 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+/**
+ * Instrumentation for builds configured with -DREPOTOTXT_TRACE=ON.
+ *
+ * A traced build counts every allocation made through operator new, counts filesystem calls
+ * per phase, keeps a histogram of whole-file read latencies and records a span for every
+ * instrumented function together with the allocations it made on its thread. When the program
+ * exits everything is written as a Chrome trace (open it in chrome://tracing or Perfetto) to
+ * the file named by REPOTOTXT_TRACE_FILE, repototxt-trace.json by default, and summarised on
+ * stderr.
+ *
+ * In other builds every macro below expands to nothing, so release binaries carry no cost.
+ */
+
+#ifdef REPOTOTXT_TRACE
+
+#include <chrono>
+#include <cstdint>
+
+namespace Utils {
+namespace Trace {
+
+/**
+ * @brief Kinds of filesystem calls that are counted.
+ */
+enum class FsCall : uint8_t {
+    kOpen,           // Opening a file for reading
+    kRead,           // One read from an open file
+    kStat,           // stat, lstat or a std::filesystem status query
+    kListDirectory,  // Opening a directory listing
+    kCount
+};
+
+/**
+ * @brief Records a span from construction to destruction. A phase span also becomes the
+ *        calling thread's phase, to which filesystem calls are attributed until it ends.
+ */
+class Scope {
+   public:
+    Scope(const char* name, bool phase);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char* name;
+    uint32_t previous_phase;
+    bool phase;
+    uint64_t start;
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+};
+
+/**
+ * @brief Measures one whole-file read and adds it to the latency histogram.
+ */
+class ReadTimer {
+   public:
+    ReadTimer() : start(std::chrono::steady_clock::now()) {}
+    ~ReadTimer();
+    ReadTimer(const ReadTimer&) = delete;
+    ReadTimer& operator=(const ReadTimer&) = delete;
+
+   private:
+    std::chrono::steady_clock::time_point start;
+};
+
+void CountFsCall(FsCall call);
+
+/**
+ * @brief Records a span that started at the given time and ends now, for intervals that do
+ *        not follow a scope, such as the time from startup to the first frame.
+ */
+void RecordSpan(const char* name, std::chrono::steady_clock::time_point start);
+
+/**
+ * @brief Returns the calling thread's phase, so work handed to other threads can adopt it.
+ */
+uint32_t CurrentPhase();
+void AdoptPhase(uint32_t phase);
+
+}  // namespace Trace
+}  // namespace Utils
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SCOPE(name) ::Utils::Trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name, false)
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+#define TRACE_PHASE(name) ::Utils::Trace::Scope TRACE_CONCAT(trace_phase_, __LINE__)(name, true)
+#define TRACE_FILE_READ() ::Utils::Trace::ReadTimer TRACE_CONCAT(trace_read_, __LINE__)
+#define TRACE_FS_CALL(call) ::Utils::Trace::CountFsCall(::Utils::Trace::FsCall::call)
+#define TRACE_SPAN_SINCE(name, start) ::Utils::Trace::RecordSpan(name, start)
+#define TRACE_CAPTURE_PHASE(variable) const uint32_t variable = ::Utils::Trace::CurrentPhase()
+#define TRACE_ADOPT_PHASE(variable) ::Utils::Trace::AdoptPhase(variable)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_FUNCTION() ((void)0)
+#define TRACE_PHASE(name) ((void)0)
+#define TRACE_FILE_READ() ((void)0)
+#define TRACE_FS_CALL(call) ((void)0)
+#define TRACE_SPAN_SINCE(name, start) ((void)0)
+#define TRACE_CAPTURE_PHASE(variable) ((void)0)
+#define TRACE_ADOPT_PHASE(variable) ((void)0)
+
+#endif  // REPOTOTXT_TRACE
+
+#endif  // TRACE_HPP
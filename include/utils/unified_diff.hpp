@@ -0,0 +1,29 @@
+#ifndef UNIFIED_DIFF_HPP
+#define UNIFIED_DIFF_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Utils {
+
+/**
+ * @brief Appends a unified diff (as written by diff -u) between two versions of a file.
+ *        Lines are compared by hash first; the shortest edit script is found with Myers'
+ *        algorithm after the common head and tail have been set aside, so the cost grows with
+ *        the size of the change rather than the size of the file.
+ *
+ * @param old_text The previous version.
+ * @param new_text The current version.
+ * @param path Path of the file, used in the --- and +++ headers.
+ * @param context Number of unchanged lines kept around every change.
+ * @param out Buffer to append the diff to.
+ * @return true If the diff was written.
+ * @return false If the versions differ in so many lines that the diff would not be smaller than
+ *         the file; nothing is appended then.
+ */
+bool AppendUnifiedDiff(std::string_view old_text, std::string_view new_text, std::string_view path, size_t context, std::string& out);
+
+}  // namespace Utils
+
+#endif  // UNIFIED_DIFF_HPP
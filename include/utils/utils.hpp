@@ -1,11 +1,19 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <ostream>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "utils/clipboard.hpp"
+#include "utils/dump_options.hpp"
+#include "utils/path_table.hpp"
+
 namespace Utils {
 /**
  * @brief Recursively prints the directory tree of the selected paths starting from the root.
@@ -13,8 +21,83 @@ namespace Utils {
  * @param selected_paths Vector of selected file and directory paths.
  * @param root The root path from which to start printing the tree.
  * @param out_stream The output stream to write the tree to.
+ * @param options Output options; the tree is wrapped in the format's tree template and, when
+ *                annotate is set, every entry is followed by its size, line and token counts.
+ */
+void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Generates the directory tree of the selected paths from an existing scan index.
+ *
+ * @param table Scan index holding the selected paths and everything beneath them.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param root The root path from which to start generating the tree.
+ * @param out_stream The output stream to write the tree to.
+ * @param options Output options, as for the overload that walks the selection itself.
+ */
+void PrintDirectoryTree(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Reads a whole file into the given buffer, reusing its capacity.
+ *
+ * @param path The file to read.
+ * @param buffer Receives the file contents.
+ * @return true If the file could be opened.
+ * @return false Otherwise.
+ */
+bool ReadFileContents(const std::filesystem::path& path, std::string& buffer);
+
+/**
+ * @brief Receives one file of a dump: its path, its contents after the enabled content stages,
+ *        and whether it could be read at all.
+ */
+using FileVisitor = std::function<void(std::string_view path, std::string_view body, bool readable)>;
+
+/**
+ * @brief Supplies the contents of one file of a dump; returns false if it cannot be read.
+ */
+using FileReader = std::function<bool(const std::filesystem::path& path, std::string& buffer)>;
+
+/**
+ * @brief The reader dumps use: ReadFileContents, holding one of options.io_slots while it reads.
+ *
+ * @param options Output options; must outlive the reader.
+ * @return The reader.
+ */
+FileReader DumpFileReader(const DumpOptions& options);
+
+/**
+ * @brief Lists the regular files at or below the selected paths, in output order.
+ *
+ * @param table Scan index holding the selected paths.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @return Table indices of the files.
+ */
+std::vector<uint32_t> SelectedFiles(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths);
+
+/**
+ * @brief Reads every regular file below the selected paths, in output order, and hands its
+ *        contents to the visitor after the enabled content stages have run.
+ *
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param options Output options; decides which content stages run.
+ * @param visit Called once per file.
+ * @return Counters describing what was read.
+ */
+DumpStats VisitFileContents(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options, const FileVisitor& visit);
+
+/**
+ * @brief Runs the content stages over the given files of a scan index and hands each result to
+ *        the visitor, in the order given.
+ *
+ * @param table Scan index holding the files.
+ * @param files Table indices of the files to visit.
+ * @param options Output options; decides which content stages run.
+ * @param read Supplies the contents of a file.
+ * @param visit Called once per file.
+ * @return Counters describing what was read.
  */
-void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream);
+DumpStats VisitFileContents(const PathTable& table, const std::vector<uint32_t>& files, const DumpOptions& options, const FileReader& read, const FileVisitor& visit);
 
 /**
  * @brief Recursively prints the contents of the selected files to the given output stream.
@@ -22,16 +105,93 @@ void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths
  *
  * @param selected_paths Vector of selected file and directory paths.
  * @param out_stream The output stream to write the file contents to.
+ * @param options Output options; each file is written through the format's file template.
+ * @return Counters describing what was written.
  */
-void PrintFileContents(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream);
+DumpStats PrintFileContents(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Prints the contents of the selected files from an existing scan index.
+ *
+ * @param table Scan index holding the selected paths and everything beneath them.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param out_stream The output stream to write the file contents to.
+ * @param options Output options, as for the overload that walks the selection itself.
+ * @return Counters describing what was written.
+ */
+DumpStats PrintFileContents(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Writes the files a delta dump found added, modified or deleted, one per line prefixed
+ *        with A, M or D, through the format's tree template. It stands in for the tree, which
+ *        the earlier dump already showed.
+ *
+ * @param stats Counters returned by PrintFileContents run with options.since.
+ * @param out_stream The output stream to write the list to.
+ * @param options The options the dump ran with.
+ */
+void PrintChangeList(const DumpStats& stats, std::ostream& out_stream, const DumpOptions& options);
+
+/**
+ * @brief Writes a short summary of the content stages that were enabled, such as the bytes and
+ *        tokens saved by minification.
+ *
+ * @param stats Counters returned by PrintFileContents.
+ * @param options The options the dump ran with.
+ * @param out_stream The output stream to write the summary to.
+ */
+void PrintDumpReport(const DumpStats& stats, const DumpOptions& options, std::ostream& out_stream);
+
+/**
+ * @brief Estimates how many LLM tokens a piece of text costs, using the usual four bytes per token.
+ *
+ * @param bytes Size of the text in bytes.
+ * @return The estimated token count.
+ */
+inline uint64_t EstimateTokens(uint64_t bytes) {
+    return (bytes + 3) / 4;
+}
+
+/**
+ * @brief Tells whether file content is binary, i.e. contains a NUL byte. Content stages that
+ *        work on text (outlines, search) leave such files alone.
+ *
+ * @param content Content of the file.
+ * @return true If the content is binary.
+ */
+inline bool IsBinaryContent(std::string_view content) {
+    return content.find('\0') != std::string_view::npos;
+}
 
 /**
  * @brief Gets the contents of the selected files and directories as a single string.
  *
  * @param selected_paths Vector of selected file and directory paths.
+ * @param options Output options, as for PrintFileContents.
  * @return A string containing all the file contents concatenated.
  */
-std::string GetFileContents(const std::vector<std::filesystem::path>& selected_paths);
+std::string GetFileContents(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options = DumpOptions());
+
+/**
+ * @brief Finds the longest common ancestor of the given absolute paths.
+ *
+ * @param absolute_paths The paths; must not be empty.
+ * @return The common ancestor, or the current directory if the paths share none.
+ */
+std::filesystem::path CommonRoot(const std::vector<std::filesystem::path>& absolute_paths);
+
+/**
+ * @brief Writes the tree and/or contents of a selection, as requested by one of the UI buttons.
+ *        The tree is rooted at the longest common ancestor of the selected paths. Copy actions
+ *        put the result on the clipboard, cat actions print it to standard output. When
+ *        options.split_bytes is set, content dumps are written in parts instead.
+ *
+ * @param selected_paths The selected files and directories.
+ * @param action CaA (cat all), CaT (cat tree), CaO (cat outline), CoA (copy all), CoT (copy tree)
+ *               or CoO (copy outline).
+ * @param options Output options.
+ */
+void DumpSelection(const std::set<std::filesystem::path>& selected_paths, const std::string& action, const DumpOptions& options);
 
 /**
  * @brief Determines if potential_parent is a parent of potential_child.
@@ -54,13 +214,27 @@ bool IsParentPath(const std::filesystem::path& potential_parent, const std::file
 bool IsChildPath(const std::filesystem::path& potential_parent, const std::filesystem::path& potential_child);
 
 /**
- * @brief Copies the given text to the system clipboard.
+ * @brief Adds a path to a selection, dropping the selected directories that contain it, as
+ *        checking an entry in the menu does. Containment is decided on path components, so only
+ *        the path's own ancestors are looked up.
  *
- * @param text The text to copy to the clipboard.
- * @return true If the operation was successful.
- * @return false Otherwise.
+ * @param selection The selected paths.
+ * @param path The path to add.
+ * @param removed Receives the paths dropped from the selection, if not nullptr.
  */
-bool CopyToClipboard(const std::string& text);
+void SelectPath(std::set<std::filesystem::path>& selection, const std::filesystem::path& path, std::vector<std::filesystem::path>* removed = nullptr);
+
+/**
+ * @brief Removes a path from a selection together with everything selected beneath it, as
+ *        unchecking an entry in the menu does. The set orders paths component by component, so
+ *        the paths beneath it follow it directly and are found without scanning the selection.
+ *
+ * @param selection The selected paths.
+ * @param path The path to remove.
+ * @param removed Receives the paths beneath it that were dropped, if not nullptr.
+ */
+void DeselectPath(std::set<std::filesystem::path>& selection, const std::filesystem::path& path, std::vector<std::filesystem::path>* removed = nullptr);
+
 }  // namespace Utils
 
 #endif  // UTILS_H
@@ -4,25 +4,375 @@
 #include "utils/version.hpp"  // For actual builds
 #endif
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <ftxui/component/component.hpp>
 #include <ftxui/dom/elements.hpp>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "ui/ui_component.hpp"
+#include "utils/batch.hpp"
+#include "utils/content_search.hpp"
+#include "utils/dump_manifest.hpp"
+#include "utils/dump_options.hpp"
+#include "utils/include_closure.hpp"
+#include "utils/selection_profile.hpp"
+#include "utils/server.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+void PrintUsage() {
+    std::cout << "Usage: repototxt [options]\n"
+              << "  -v, --version          Print the version and exit\n"
+              << "  -h, --help             Print this help and exit\n"
+              << "  --format <name>        Output format: plain (default), markdown, xml, json\n"
+              << "  --template <spec>      Custom per-file template using {path}, {lang}, {fence}, {content},\n"
+              << "                         escaped as required by --format\n"
+              << "  --minify               Strip comments, trailing whitespace and blank-line runs\n"
+              << "  --split-bytes <n>      Cut content dumps into parts of at most n bytes, each repeating the tree\n"
+              << "  --split-tokens <n>     Same, with the limit given as an estimated token count\n"
+              << "  --split-output <path>  Write the parts to <path>.001, <path>.002, ... (default for cat actions:\n"
+              << "                         repototxt.NNN; copy actions otherwise copy the parts one after another)\n"
+              << "  --no-redact            Keep credentials (keys, tokens, passwords, private keys) in the output;\n"
+              << "                         by default they are replaced with [REDACTED:<kind>] and listed on stderr\n"
+              << "  --keep-encoding        Dump file contents byte for byte; by default UTF-16 and Latin-1 are\n"
+              << "                         transcoded to UTF-8 and CRLF line endings become LF\n"
+              << "  --manifest <dump>      Write per-file content hashes of a content dump saved as <dump> (for\n"
+              << "                         example through a redirect) to <dump>.manifest\n"
+              << "  --since <dump>         Only dump files added or changed since an earlier dump, given as the dump\n"
+              << "                         or its manifest, and end with the list of changes instead of the tree\n"
+              << "  --diff                 With --since, write changed files as unified diffs against the earlier dump\n"
+              << "  --natural-order        List names with numbers in numeric order (file2 before file10); by default\n"
+              << "                         names are listed byte by byte, directories first, in the tree and contents\n"
+              << "                         alike (a server keeps the order it was started with)\n"
+              << "  --clipboard <name>     How copy actions reach the clipboard: auto (default; a clipboard tool, or\n"
+              << "                         OSC 52 over SSH and without one), osc52 (through the terminal, also over\n"
+              << "                         SSH; REPOTOTXT_OSC52_LIMIT caps the bytes sent) or tool\n"
+              << "  --annotate             Show size, line count and token estimate for every tree entry\n"
+              << "  --profile <name>       Restore a saved selection and save it again on exit\n"
+              << "  --include <glob>       Only keep files matching the glob (repeatable, stored in the profile)\n"
+              << "  --exclude <glob>       Drop entries matching the glob (repeatable, stored in the profile)\n"
+              << "  --grep <text>          Only keep files containing the text (headless), or prefill the UI search\n"
+              << "  --grep-regex <expr>    Same, with an ECMAScript regular expression matched line by line\n"
+              << "  --ignore-case          Ignore ASCII case when searching\n"
+              << "  --snippets <n>         With a search, dump matching lines and n lines around them instead of\n"
+              << "                         whole files\n"
+              << "  --with-deps            Also select the project headers that the selected C/C++ files include,\n"
+              << "                         transitively (headless; press d in the UI)\n"
+              << "  --include-dir <dir>    Look up quoted includes in the directory too (repeatable); the -I flags of a\n"
+              << "                         compile_commands.json at the root or one level below are always used\n"
+              << "  --headless             Dump without starting the UI (profile selection, or the whole directory)\n"
+              << "  --batch <manifest>     Dump every root listed in the manifest (one root and its options per line)\n"
+              << "  --jobs <n>             Batch mode: number of roots dumped at once (default: one per CPU)\n"
+              << "  --io-slots <n>         Batch mode: maximum number of files read at once (default: 2 x jobs)\n"
+              << "  --serve <socket>       Serve dumps of the current directory over a Unix socket, keeping the\n"
+              << "                         scan and file contents warm between requests\n"
+              << "  --cache-mb <n>         Server mode: memory for cached file contents in MiB (default: 256)\n"
+              << "  --connect <socket>     Ask a running server for the --action dump of the current directory,\n"
+              << "                         with --format, --minify, --no-redact, --keep-encoding, --include and\n"
+              << "                         --exclude; other dump options are refused\n"
+              << "  --action <name>        Headless action: cat-all (default), cat-tree, cat-outline,\n"
+              << "                         copy-all, copy-tree, copy-outline\n";
+}
+
+/**
+ * @brief Parses a positive decimal size given on the command line.
+ */
+bool ParseSize(const char* text, uint64_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed == 0 || text[0] == '-') {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+/**
+ * @brief Options a server cannot apply to its warm index. A client given one of them would print
+ *        a dump that differs from the local one, so --connect refuses them instead.
+ */
+const std::set<std::string> kLocalOnlyOptions = {
+    "--template", "--split-bytes", "--split-tokens", "--split-output", "--manifest", "--since",
+    "--diff", "--natural-order", "--annotate", "--profile", "--grep", "--grep-regex", "--ignore-case",
+    "--snippets", "--with-deps", "--include-dir",
+};
+
+/**
+ * @brief Maps a headless action name to the code of the matching UI button.
+ */
+bool ParseAction(const std::string& name, std::string& action) {
+    if (name == "cat-all") {
+        action = "CaA";
+    } else if (name == "cat-tree") {
+        action = "CaT";
+    } else if (name == "copy-all") {
+        action = "CoA";
+    } else if (name == "copy-tree") {
+        action = "CoT";
+    } else if (name == "cat-outline") {
+        action = "CaO";
+    } else if (name == "copy-outline") {
+        action = "CoO";
+    } else {
+        return false;
+    }
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    // Check if --version or -v is passed
+    TRACE_FUNCTION();
+    Utils::DumpOptions dump_options;
+    Utils::OutputFormat format = Utils::OutputFormat::Plain;
+    std::string custom_template;
+    bool has_custom_template = false;
+    std::string profile_name;
+    std::vector<std::string> include_rules;
+    std::vector<std::string> exclude_rules;
+    bool headless = false;
+    std::string batch_manifest;
+    uint64_t batch_jobs = 0;
+    uint64_t batch_io_slots = 0;
+    std::string action = "CaA";
+    std::string action_name = "cat-all";
+    std::string format_name;
+    std::string serve_socket;
+    std::string connect_socket;
+    uint64_t cache_mb = 256;
+    std::string search_pattern;
+    bool search_regex = false;
+    bool search_ignore_case = false;
+    bool with_dependencies = false;
+    std::vector<std::filesystem::path> include_dirs;
+    std::vector<std::string> local_only;  // Given options that --connect cannot forward
+
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
+        if (kLocalOnlyOptions.count(arg)) {
+            local_only.push_back(arg);
+        }
+        // Check if --version or -v is passed
         if (arg == "--version" || arg == "-v") {
             std::cout << "RepoToTxt version " << PROJECT_VERSION << std::endl;
             return 0;
+        } else if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        } else if (arg == "--format" && i + 1 < argc) {
+            if (!Utils::ParseOutputFormat(argv[++i], format)) {
+                std::cerr << "Unknown output format: " << argv[i] << "\n";
+                return 1;
+            }
+            format_name = argv[i];
+        } else if (arg == "--template" && i + 1 < argc) {
+            custom_template = argv[++i];
+            has_custom_template = true;
+        } else if (arg == "--minify") {
+            dump_options.minify = true;
+        } else if ((arg == "--split-bytes" || arg == "--split-tokens") && i + 1 < argc) {
+            uint64_t limit = 0;
+            if (!ParseSize(argv[++i], limit)) {
+                std::cerr << "Invalid size for " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+            // Tokens are estimated at four bytes each, as everywhere else
+            if (arg == "--split-tokens") limit *= 4;
+            dump_options.split_bytes = dump_options.split_bytes == 0 ? limit : std::min(dump_options.split_bytes, limit);
+        } else if (arg == "--split-output" && i + 1 < argc) {
+            dump_options.split_prefix = argv[++i];
+        } else if (arg == "--no-redact") {
+            dump_options.redact = false;
+        } else if (arg == "--keep-encoding") {
+            dump_options.normalize = false;
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            dump_options.manifest_for = argv[++i];
+        } else if (arg == "--since" && i + 1 < argc) {
+            auto since = std::make_shared<Utils::DumpManifest>();
+            std::string error;
+            if (!Utils::LoadDumpManifest(argv[++i], *since, error)) {
+                std::cerr << "Invalid --since: " << error << "\n";
+                return 1;
+            }
+            dump_options.since = std::move(since);
+        } else if (arg == "--diff") {
+            dump_options.diff = true;
+        } else if (arg == "--natural-order") {
+            dump_options.order = Utils::NameOrder::Natural;
+        } else if (arg == "--clipboard" && i + 1 < argc) {
+            if (!Utils::ParseClipboardBackend(argv[++i], dump_options.clipboard)) {
+                std::cerr << "Unknown clipboard backend: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--annotate") {
+            dump_options.annotate = true;
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_name = argv[++i];
+            if (profile_name.empty() || profile_name.find_first_of("/\\") != std::string::npos || profile_name == "..") {
+                std::cerr << "Invalid profile name: " << profile_name << "\n";
+                return 1;
+            }
+        } else if (arg == "--include" && i + 1 < argc) {
+            include_rules.emplace_back(argv[++i]);
+        } else if (arg == "--exclude" && i + 1 < argc) {
+            exclude_rules.emplace_back(argv[++i]);
+        } else if ((arg == "--grep" || arg == "--grep-regex") && i + 1 < argc) {
+            search_pattern = argv[++i];
+            search_regex = arg == "--grep-regex";
+        } else if (arg == "--ignore-case") {
+            search_ignore_case = true;
+        } else if (arg == "--snippets" && i + 1 < argc) {
+            uint64_t context = 0;
+            if (std::string(argv[++i]) != "0" && (!ParseSize(argv[i], context) || context > 1000)) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+            dump_options.snippet_context = static_cast<int>(context);
+        } else if (arg == "--with-deps") {
+            with_dependencies = true;
+        } else if (arg == "--include-dir" && i + 1 < argc) {
+            include_dirs.emplace_back(argv[++i]);
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_manifest = argv[++i];
+        } else if ((arg == "--jobs" || arg == "--io-slots") && i + 1 < argc) {
+            uint64_t& value = arg == "--jobs" ? batch_jobs : batch_io_slots;
+            if (!ParseSize(argv[++i], value) || value > 1024) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (arg == "--action" && i + 1 < argc) {
+            if (!ParseAction(argv[++i], action)) {
+                std::cerr << "Unknown action: " << argv[i] << "\n";
+                return 1;
+            }
+            action_name = argv[i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_socket = argv[++i];
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connect_socket = argv[++i];
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            if (!ParseSize(argv[++i], cache_mb) || cache_mb > (uint64_t{1} << 20)) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Compile the output templates once, before any file is read
+    dump_options.templates = Utils::OutputTemplates::ForFormat(format);
+    if (has_custom_template) {
+        std::string error;
+        if (!Utils::OutputTemplate::Compile(custom_template, Utils::EscapeForFormat(format), dump_options.templates.file, error)) {
+            std::cerr << "Invalid template: " << error << "\n";
+            return 1;
+        }
+    }
+
+    if (!search_pattern.empty()) {
+        Utils::ContentMatcher matcher;
+        std::string error;
+        if (!Utils::ContentMatcher::Compile(search_pattern, search_regex, search_ignore_case, matcher, error)) {
+            std::cerr << "Invalid search pattern: " << error << "\n";
+            return 1;
+        }
+        dump_options.search = std::make_shared<const Utils::ContentMatcher>(std::move(matcher));
+    }
+
+    // Batch mode runs without a terminal; every root carries its own selection and options
+    if (!batch_manifest.empty()) {
+        std::vector<Utils::BatchJob> jobs;
+        std::string error;
+        if (!Utils::ParseBatchManifest(batch_manifest, dump_options, format, jobs, error)) {
+            std::cerr << "Invalid batch manifest: " << error << "\n";
+            return 1;
+        }
+        size_t failed = Utils::RunBatch(jobs, static_cast<unsigned>(batch_jobs), static_cast<unsigned>(batch_io_slots), std::cout);
+        return failed == 0 ? 0 : 1;
+    }
+
+    // A server keeps one directory warm for many requests; a client only forwards its options
+    if (!serve_socket.empty()) {
+        return Utils::RunServer(std::filesystem::current_path(), serve_socket, static_cast<size_t>(cache_mb << 20), dump_options.order);
+    }
+    if (!connect_socket.empty()) {
+        if (!local_only.empty()) {
+            std::cerr << local_only.front() << " cannot be used with --connect\n";
+            return 1;
+        }
+        // The server always streams; copy actions collect the stream for the clipboard
+        bool copy = action_name.compare(0, 5, "copy-") == 0;
+        std::vector<std::string> request = {copy ? "cat-" + action_name.substr(5) : action_name};
+        if (!format_name.empty()) request.insert(request.end(), {"--format", format_name});
+        if (dump_options.minify) request.emplace_back("--minify");
+        if (!dump_options.redact) request.emplace_back("--no-redact");
+        if (!dump_options.normalize) request.emplace_back("--keep-encoding");
+        for (const auto& rule : include_rules) request.insert(request.end(), {"--include", rule});
+        for (const auto& rule : exclude_rules) request.insert(request.end(), {"--exclude", rule});
+        request.insert(request.end(), {"--path", std::filesystem::current_path().string()});
+        if (!copy) {
+            return Utils::RunClient(connect_socket, request, std::cout);
+        }
+        std::ostringstream dump;
+        int status = Utils::RunClient(connect_socket, request, dump);
+        if (status == 0) Utils::CopyToClipboard(dump.str(), dump_options.clipboard);
+        return status;
+    }
+
+    // Profiles are shared between the UI and headless runs
+    const std::filesystem::path root = std::filesystem::current_path();
+    Utils::SelectionProfile profile;
+    if (!profile_name.empty()) {
+        Utils::LoadSelectionProfile(root, profile_name, profile);
+    }
+    for (const auto& rule : include_rules) {
+        if (std::find(profile.include_rules.begin(), profile.include_rules.end(), rule) == profile.include_rules.end()) {
+            profile.include_rules.push_back(rule);
+        }
+    }
+    for (const auto& rule : exclude_rules) {
+        if (std::find(profile.exclude_rules.begin(), profile.exclude_rules.end(), rule) == profile.exclude_rules.end()) {
+            profile.exclude_rules.push_back(rule);
+        }
+    }
+
+    if (headless) {
+        if (profile.paths.empty()) {
+            profile.paths.emplace_back(".");
+        }
+        if (!profile_name.empty() && !Utils::SaveSelectionProfile(root, profile_name, profile)) {
+            std::cerr << "Failed to save profile " << profile_name << "\n";
+        }
+        std::set<std::filesystem::path> selection = Utils::ApplySelectionProfile(profile, root);
+        if (dump_options.search) {
+            selection = Utils::FilterSelectionByContent(selection, *dump_options.search);
+            if (selection.empty()) {
+                std::cerr << "No file matches " << search_pattern << "\n";
+                return 1;
+            }
+        }
+        if (with_dependencies) {
+            Utils::AddIncludeClosure(selection, root, Utils::FindIncludeDirs(root, include_dirs));
         }
+        Utils::DumpSelection(selection, action, dump_options);
+        return 0;
     }
 
     // Proceed with the UI if no version flag is detected
-    UIComponent ui;
+    UIComponent ui(dump_options, profile_name, profile, include_dirs);
     ui.Run();
     return 0;
 }
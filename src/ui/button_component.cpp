@@ -22,6 +22,14 @@ ButtonComponent::ButtonComponent(ftxui::ScreenInteractive& screen, std::set<fs::
         pressed_button = "CaT";
         screen.ExitLoopClosure()();
     });
+    copy_outline_button = Button("Copy (Outline)", [&] {
+        pressed_button = "CoO";
+        screen.ExitLoopClosure()();
+    });
+    cat_outline_button = Button("Cat (Outline)", [&] {
+        pressed_button = "CaO";
+        screen.ExitLoopClosure()();
+    });
 
     exit_button = Button("Exit", [&] {
         pressed_button = "Ex";
@@ -42,6 +50,12 @@ ftxui::Component ButtonComponent::GetCopyTreeButton() {
 ftxui::Component ButtonComponent::GetCatTreeButton() {
     return cat_tree_button;
 }
+ftxui::Component ButtonComponent::GetCopyOutlineButton() {
+    return copy_outline_button;
+}
+ftxui::Component ButtonComponent::GetCatOutlineButton() {
+    return cat_outline_button;
+}
 
 ftxui::Component ButtonComponent::GetExitButton() {
     return exit_button;
@@ -1,73 +1,152 @@
 #include "ui/display_selected_component.hpp"
 
 #include <algorithm>
+#include <ftxui/component/event.hpp>
 #include <ftxui/dom/elements.hpp>
 
+#include "utils/parallel_walker.hpp"
+
 using namespace ftxui;
 
-DisplaySelectedComponent::DisplaySelectedComponent(std::set<fs::path>& selected_paths, const fs::path& root_path)
-    : selected_paths(selected_paths), root_path(root_path) {
+DisplaySelectedComponent::DisplaySelectedComponent(ftxui::ScreenInteractive& screen, std::set<fs::path>& selected_paths, const fs::path& root_path, Utils::NameOrder order)
+    : screen(screen), selected_paths(selected_paths), root_path(root_path), order(order) {
     display_selected = Renderer([&] {
+        UpdateMetrics();
+
         // Build the tree structure from selected_paths
-        TreeNode root;
-        BuildTree(root);
+        if (tree_stale || selected_paths != shown_selection) {
+            BuildTree();
+        }
 
-        // Render the tree structure
-        auto tree_element = RenderTree(root);
+        // Render the tree structure; until the totals of this selection arrive, none are shown
+        bool measured = selected_paths == measured_selection;
+        auto tree_element = RenderTree(tree_table, measured ? tree_metrics : std::vector<Utils::FileMetrics>(), tree_table.RootListing());
 
+        if (selected_paths.empty()) {
+            return vbox({text("None")});
+        }
         return vbox({
-            selected_paths.empty() ? text("None") : tree_element | flex,
+            tree_element | flex,
+            separator(),
+            text(measured ? "Total: " + Utils::FormatMetrics(total_metrics, true) : std::string("Total: measuring...")) | bold,
         });
     });
 }
 
+DisplaySelectedComponent::~DisplaySelectedComponent() {
+    // The loop has ended, so a result posted now is never applied
+    if (measuring_thread.joinable()) {
+        measuring_thread.join();
+    }
+}
+
 ftxui::Component DisplaySelectedComponent::Render() {
     return display_selected;
 }
 
-void DisplaySelectedComponent::BuildTree(TreeNode& node) {
-    for (const auto& path : selected_paths) {
-        fs::path relative_path = fs::relative(path, root_path);
-        InsertPath(node, relative_path, path);
+void DisplaySelectedComponent::UpdateMetrics() {
+    // One measurement at a time; a selection changed meanwhile is measured once it is done
+    if (measuring || selected_paths == measured_selection) {
+        return;
+    }
+    if (measuring_thread.joinable()) {
+        measuring_thread.join();
     }
+    measuring = true;
+    measuring_thread = std::thread([this, selection = selected_paths]() mutable {
+        std::vector<fs::path> absolute_paths;
+        for (const auto& path : selection) {
+            absolute_paths.push_back(fs::absolute(path));
+        }
+
+        // One walk and one parallel measuring pass for the whole selection; unchanged files are
+        // answered by the cache, so toggling a checkbox does not re-read the rest of the selection
+        Utils::PathTable table = Utils::ParallelWalk(absolute_paths);
+        std::vector<Utils::FileMetrics> metrics = Utils::ComputeTreeMetrics(table, &metrics_cache);
+
+        std::map<fs::path, Utils::FileMetrics> measured;
+        std::map<fs::path, bool> directories;
+        for (const auto& path : selection) {
+            uint32_t index = table.Find(fs::absolute(path));
+            if (index != Utils::PathTable::kNone) {
+                measured[path] = metrics[index];
+                directories[path] = table.Is(index, Utils::PathTable::kDirectory);
+            }
+        }
+        // Every file sits under exactly one root, so overlapping selections are counted once
+        Utils::FileMetrics total;
+        for (uint32_t root : table.Roots()) {
+            total.Add(metrics[root]);
+        }
+
+        screen.Post([this, selection = std::move(selection), measured = std::move(measured), directories = std::move(directories), total]() mutable {
+            measured_selection = std::move(selection);
+            selection_metrics = std::move(measured);
+            selection_directories = std::move(directories);
+            total_metrics = total;
+            measuring = false;
+            tree_stale = true;
+        });
+        // Redraw with the totals, or start on a selection that changed while measuring
+        screen.PostEvent(ftxui::Event::Custom);
+    });
 }
 
-void DisplaySelectedComponent::InsertPath(TreeNode& node, const fs::path& relative_path, const fs::path& full_path) {
-    auto it = relative_path.begin();
-    TreeNode* current_node = &node;
+void DisplaySelectedComponent::BuildTree() {
+    shown_selection = selected_paths;
+    tree_stale = false;
+    tree_table = Utils::PathTable();
 
-    while (it != relative_path.end()) {
-        std::string part = it->string();
-        auto& child_node = current_node->children[part];
-        child_node.name = part;
+    // Lexically relative, without touching the filesystem: resolving would throw on links
+    // that loop. Whether a path is a directory comes from the measuring walk; a path selected
+    // since then shows as a file until its measurement arrives.
+    for (const auto& path : selected_paths) {
+        auto known = selection_directories.find(path);
+        bool directory = known != selection_directories.end() && known->second;
+        tree_table.Intern(path.lexically_relative(root_path), Utils::PathTable::kSelected | (directory ? Utils::PathTable::kDirectory : 0));
+    }
+    tree_table.Finalize(order);
 
-        // If this is the last component, set is_directory based on the actual path
-        if (std::next(it) == relative_path.end()) {
-            child_node.is_directory = fs::is_directory(full_path);
+    tree_metrics.assign(tree_table.size(), Utils::FileMetrics());
+    for (const auto& [path, totals] : selection_metrics) {
+        uint32_t index = tree_table.Find(path.lexically_relative(root_path));
+        if (index != Utils::PathTable::kNone) {
+            tree_metrics[index] = totals;
         }
+    }
 
-        current_node = &child_node;
-        ++it;
+    // Roll the totals up to the folders that are only shown as ancestors; a selected folder
+    // already includes everything selected below it
+    const std::vector<uint32_t>& ordered = tree_table.Ordered();
+    for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
+        uint32_t parent = tree_table[*it].parent;
+        if (parent != Utils::PathTable::kNone && !tree_table.Is(parent, Utils::PathTable::kSelected)) {
+            tree_metrics[parent].Add(tree_metrics[*it]);
+        }
     }
 }
 
-ftxui::Element DisplaySelectedComponent::RenderTree(const TreeNode& node, int depth) {
+ftxui::Element DisplaySelectedComponent::RenderTree(const Utils::PathTable& table, const std::vector<Utils::FileMetrics>& metrics, Utils::PathTable::Range children, int depth) {
     std::vector<Element> elements;
 
-    for (const auto& [name, child] : node.children) {
+    for (uint32_t child : children) {
         // Indent based on depth
         auto indent = text(std::string(depth * 2, ' '));
-        auto node_name = text(child.name);
+        auto node_name = text(std::string(table.Name(child)));
+        auto grandchildren = table.Listing(child);
+        auto node_metrics = text(metrics.empty() ? std::string() : " " + Utils::FormatMetrics(metrics[child], false)) | dim;
 
-        if (child.is_directory || !child.children.empty()) {
+        if (table.Is(child, Utils::PathTable::kDirectory) || !grandchildren.empty()) {
             elements.push_back(hbox({indent,
                                      text("📁 ") | color(Color::Yellow),
-                                     node_name | bold}));
-            elements.push_back(RenderTree(child, depth + 1));
+                                     node_name | bold,
+                                     node_metrics}));
+            elements.push_back(RenderTree(table, metrics, grandchildren, depth + 1));
         } else {
             elements.push_back(hbox({indent,
                                      text("📄 ") | color(Color::Green),
-                                     node_name}));
+                                     node_name,
+                                     node_metrics}));
         }
     }
 
@@ -11,6 +11,8 @@ InstructionsComponent::InstructionsComponent() {
                      text("↑/↓/→/← Arrow Keys: Navigate"),
                      text("Enter: Select/Deselect"),
                      text("O/o/Spacebar: Enter/Exit Directory"),
+                     text("/: Search File Contents (Enter selects matches)"),
+                     text("D/d: Also Select Included Headers"),
                      text("Esc: Jump to 'Copy All' Button")}) |
                border;
     });
@@ -9,6 +9,7 @@
 #include <ftxui/component/screen_interactive.hpp>
 #include <ftxui/dom/elements.hpp>
 
+#include "utils/trace.hpp"
 #include "utils/utils.hpp"
 
 using namespace ftxui;
@@ -25,10 +26,12 @@ MenuComponent::MenuComponent(
       checkbox_states(checkbox_states),
       selected_paths(selected_paths),
       menu_container(Container::Vertical({}, &focused_index)) {
-    BuildMenu();
+    // The menu is built by the owner once the selection is known, so the directory is listed
+    // only once before the first frame
 }
 
 void MenuComponent::BuildMenu() {
+    TRACE_PHASE("menu");
     // Reset focused_index if needed
     focused_index = 0;
 
@@ -39,10 +42,15 @@ void MenuComponent::BuildMenu() {
     // Clear existing children from menu_container
     menu_container->DetachAllChildren();
 
-    // Get directory entries
+    // Get directory entries; the type comes with the listing on most platforms, so telling
+    // directories apart does not cost a stat per entry
     options.push_back("..");  // Option to move up one directory
+    std::vector<bool> directories(1, false);
+    TRACE_FS_CALL(kListDirectory);
     for (const auto& entry : fs::directory_iterator(current_directory)) {
+        std::error_code ec;
         options.push_back(entry.path().filename().string());
+        directories.push_back(entry.is_directory(ec));
     }
 
     // Reserve space for checkbox states
@@ -56,8 +64,7 @@ void MenuComponent::BuildMenu() {
         fs::path item_path = current_directory / options[i];
         *checkbox_states[i] = selected_paths.find(item_path) != selected_paths.end();
 
-        // Determine if the current item is a directory and not ".."
-        bool is_directory = fs::is_directory(item_path) && options[i] != "..";
+        bool is_directory = directories[i];
 
         // Create a CheckboxOption and set the on_change callback
         auto checkbox_option = CheckboxOption::Simple();
@@ -68,63 +75,25 @@ void MenuComponent::BuildMenu() {
                 return;
             }
 
+            std::vector<fs::path> removed;
             if (*(checkbox_states[i])) {
-                // **Selection Logic: Adding an Item**
-
-                // **1. Identify and Remove Any Parent Directories from selected_paths**
-                std::vector<fs::path> parents_to_remove;
-                for (const auto& selected_path : selected_paths) {
-                    if (Utils::IsParentPath(selected_path, item_path)) {
-                        parents_to_remove.emplace_back(selected_path);
-                    }
-                }
-                for (const auto& parent_path : parents_to_remove) {
-                    selected_paths.erase(parent_path);
-
-                    // Find the index of the parent in options
-                    auto it = std::find_if(options.begin(), options.end(),
-                                           [&](const std::string& option) {
-                                               return (current_directory / option) == parent_path;
-                                           });
-                    if (it != options.end()) {
-                        size_t parent_index = std::distance(options.begin(), it);
-                        if (parent_index < checkbox_states.size()) {
-                            // Uncheck the parent checkbox
-                            *checkbox_states[parent_index] = false;
-                        }
-                    }
-                }
-
-                // **2. Add the Child Directory to selected_paths**
-                selected_paths.insert(item_path);
-
+                // Adding an item replaces any selected directory that holds it
+                Utils::SelectPath(selected_paths, item_path, &removed);
             } else {
-                // **Deselection Logic: Removing an Item**
-
-                // Remove the item_path from selected_paths
-                selected_paths.erase(item_path);
+                // Removing an item also removes everything selected beneath it
+                Utils::DeselectPath(selected_paths, item_path, &removed);
+            }
 
-                // Optionally, remove any children of the deselected directory
-                std::vector<fs::path> paths_to_remove;
-                for (const auto& selected_path : selected_paths) {
-                    if (Utils::IsParentPath(item_path, selected_path)) {
-                        paths_to_remove.emplace_back(selected_path);
-                    }
-                }
-                for (const auto& path : paths_to_remove) {
-                    selected_paths.erase(path);
-
-                    // Find the index of the child in options
-                    auto it = std::find_if(options.begin(), options.end(),
-                                           [&](const std::string& option) {
-                                               return (current_directory / option) == path;
-                                           });
-                    if (it != options.end()) {
-                        size_t child_index = std::distance(options.begin(), it);
-                        if (child_index < checkbox_states.size()) {
-                            // Uncheck the child checkbox
-                            *checkbox_states[child_index] = false;
-                        }
+            // Uncheck the dropped paths that are listed in the current directory
+            for (const auto& path : removed) {
+                auto it = std::find_if(options.begin(), options.end(),
+                                       [&](const std::string& option) {
+                                           return (current_directory / option) == path;
+                                       });
+                if (it != options.end()) {
+                    size_t index = std::distance(options.begin(), it);
+                    if (index < checkbox_states.size()) {
+                        *checkbox_states[index] = false;
                     }
                 }
             }
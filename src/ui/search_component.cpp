@@ -0,0 +1,124 @@
+#include "ui/search_component.hpp"
+
+#include <ftxui/component/event.hpp>
+#include <ftxui/dom/elements.hpp>
+#include <memory>
+#include <vector>
+
+#include "utils/content_search.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/utils.hpp"
+
+using namespace ftxui;
+
+SearchComponent::SearchComponent(
+    ftxui::ScreenInteractive& screen,
+    fs::path& current_directory,
+    const fs::path& root_path,
+    std::set<fs::path>& selected_paths,
+    Utils::DumpOptions& dump_options,
+    const Utils::SelectionProfile& profile,
+    std::function<void()> on_select)
+    : screen(screen),
+      current_directory(current_directory),
+      root_path(root_path),
+      selected_paths(selected_paths),
+      dump_options(dump_options),
+      profile(profile),
+      on_select(std::move(on_select)) {
+    InputOption input_option;
+    input_option.multiline = false;
+    input_option.on_enter = [this] { RunSearch(); };
+    input = Input(&query, "search file contents, Enter to select matches", input_option);
+
+    auto options = Container::Horizontal({
+        input,
+        Checkbox("regex", &regex),
+        Checkbox("Aa=aa", &ignore_case),
+    });
+    container = Renderer(options, [this, options] {
+        Elements rows = {hbox({text("Search: "), options->Render()})};
+        if (!status.empty()) {
+            rows.push_back(text(status) | dim);
+        }
+        return vbox(rows);
+    });
+}
+
+SearchComponent::~SearchComponent() {
+    // The loop has ended, so matches posted now are never applied
+    if (search_thread.joinable()) {
+        search_thread.join();
+    }
+}
+
+void SearchComponent::RunSearch() {
+    if (searching) {
+        return;
+    }
+    auto matcher = std::make_shared<Utils::ContentMatcher>();
+    std::string error;
+    if (!Utils::ContentMatcher::Compile(query, regex, ignore_case, *matcher, error)) {
+        status = "Invalid pattern: " + error;
+        return;
+    }
+
+    // Search the current directory with the profile's rules, as a selection of it would be;
+    // above the root, where the rules do not apply, the whole directory is searched
+    Utils::SelectionProfile rules;
+    std::string relative = current_directory.lexically_relative(root_path).generic_string();
+    bool inside = relative != ".." && relative.compare(0, 3, "../") != 0;
+    if (inside) {
+        rules.paths.push_back(relative);
+        rules.include_rules = profile.include_rules;
+        rules.exclude_rules = profile.exclude_rules;
+    }
+
+    if (search_thread.joinable()) {
+        search_thread.join();
+    }
+    searching = true;
+    status = "Searching...";
+    search_thread = std::thread([this, matcher, rules = std::move(rules), inside, directory = fs::absolute(current_directory),
+                                 root = root_path, threads = dump_options.threads]() {
+        // Only the directory searched is walked; the rules are resolved over that walk
+        Utils::PathTable table = Utils::ParallelWalk({directory}, threads);
+        std::vector<fs::path> scope = {directory};
+        if (inside) {
+            std::set<fs::path> selection = Utils::ApplySelectionProfile(rules, root, table);
+            scope.assign(selection.begin(), selection.end());
+        }
+        std::vector<fs::path> matches;
+        for (uint32_t index : Utils::SearchFiles(table, Utils::SelectedFiles(table, scope), *matcher, threads)) {
+            matches.push_back(table.Path(index));
+        }
+
+        screen.Post([this, matcher, matches = std::move(matches)] {
+            // Matching files replace any selected directory that holds them, as in the menu
+            for (const auto& match : matches) {
+                Utils::SelectPath(selected_paths, match);
+            }
+            dump_options.search = matcher;
+            status = std::to_string(matches.size()) + (matches.size() == 1 ? " file matches" : " files match");
+            searching = false;
+            on_select();
+        });
+        screen.PostEvent(ftxui::Event::Custom);
+    });
+}
+
+ftxui::Component SearchComponent::GetComponent() {
+    return container;
+}
+
+bool SearchComponent::Focused() const {
+    return container->Focused();
+}
+
+void SearchComponent::TakeFocus() {
+    input->TakeFocus();
+}
+
+void SearchComponent::SetQuery(const std::string& text) {
+    query = text;
+}
@@ -5,11 +5,16 @@
 #include <fstream>
 #include <ftxui/component/event.hpp>
 #include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/terminal.hpp>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <vector>
 #include <sstream>
 
+#include "utils/content_search.hpp"
+#include "utils/include_closure.hpp"
+#include "utils/trace.hpp"
 #include "utils/utils.hpp"
 
 using namespace ftxui;
@@ -68,28 +73,79 @@ void PrintFileContents(const std::vector<std::filesystem::path> &selected_paths)
     }
 }
 
-UIComponent::UIComponent()
-    : screen(ScreenInteractive::Fullscreen()),
+UIComponent::UIComponent(const Utils::DumpOptions& dump_options, const std::string& profile_name, const Utils::SelectionProfile& profile, const std::vector<std::filesystem::path>& include_dirs)
+    : created(std::chrono::steady_clock::now()),
+      screen(ScreenInteractive::Fullscreen()),
       current_directory(std::filesystem::current_path()),
       root_path(current_directory),  // Initialize root_path to initial current_directory
       menu_component(focused_index, current_directory, options, checkbox_states, selected_paths),
+      search_component(screen, current_directory, root_path, selected_paths, this->dump_options, this->profile, [this] { menu_component.BuildMenu(); }),
       instructions_component(),
-      display_selected_component(selected_paths, root_path),  // Pass root_path
-      button_component(screen, selected_paths, pressed_button, button_focused_index) {
+      display_selected_component(screen, selected_paths, root_path, dump_options.order),  // Pass root_path
+      button_component(screen, selected_paths, pressed_button, button_focused_index),
+      dump_options(dump_options),
+      profile_name(profile_name),
+      profile(profile),
+      include_dirs(include_dirs) {
+    // Restore the saved selection before the menu is first built
+    if (!profile_name.empty()) {
+        selected_paths = Utils::ApplySelectionProfile(profile, root_path);
+        profile_selection = selected_paths;
+    }
+    // A search given on the command line is offered again, ready to run
+    if (this->dump_options.search) {
+        search_component.SetQuery(this->dump_options.search->Pattern());
+    }
+}
+
+UIComponent::~UIComponent() {
+    // The loop has ended, so headers posted now are never added
+    if (dependency_thread.joinable()) {
+        dependency_thread.join();
+    }
+}
+
+void UIComponent::AddDependencies() {
+    if (adding_dependencies) {
+        return;
+    }
+    if (dependency_thread.joinable()) {
+        dependency_thread.join();
+    }
+    adding_dependencies = true;
+    dependency_status = "Adding included headers...";
+    dependency_thread = std::thread([this, selection = selected_paths, root = root_path, dirs = include_dirs, threads = dump_options.threads]() mutable {
+        // Add the project headers that the selected sources include, transitively
+        std::set<std::filesystem::path> closure = selection;
+        Utils::AddIncludeClosure(closure, root, Utils::FindIncludeDirs(root, dirs), threads);
+        std::vector<std::filesystem::path> added;
+        std::set_difference(closure.begin(), closure.end(), selection.begin(), selection.end(), std::back_inserter(added));
+
+        screen.Post([this, added = std::move(added)] {
+            selected_paths.insert(added.begin(), added.end());
+            dependency_status = "Added " + std::to_string(added.size()) + (added.size() == 1 ? " included file" : " included files");
+            adding_dependencies = false;
+            menu_component.BuildMenu();
+        });
+        screen.PostEvent(Event::Custom);
+    });
 }
 
 void UIComponent::Run() {
-    // Initialize components
+    // The only directory listing before the first frame
     menu_component.BuildMenu();
 
     // Get the components
     auto menu_container = menu_component.GetMenuContainer();
+    auto search = search_component.GetComponent();
     auto instructions = instructions_component.Render();
     auto display_selected = display_selected_component.Render();
     auto copy_all_button = button_component.GetCopyAllButton();
     auto cat_all_button = button_component.GetCatAllButton();
     auto copy_tree_button = button_component.GetCopyTreeButton();
     auto cat_tree_button = button_component.GetCatTreeButton();
+    auto copy_outline_button = button_component.GetCopyOutlineButton();
+    auto cat_outline_button = button_component.GetCatOutlineButton();
     auto exit_button = button_component.GetExitButton();
 
     // Create a vertical container for the main button rows
@@ -104,7 +160,12 @@ void UIComponent::Run() {
             button_component.GetCopyTreeButton(),
             button_component.GetCatTreeButton(),
         }),
-        // Third Row: Exit Button spanning both columns
+        // Third Row: Copy Outline and Cat Outline
+        Container::Horizontal({
+            button_component.GetCopyOutlineButton(),
+            button_component.GetCatOutlineButton(),
+        }),
+        // Fourth Row: Exit Button spanning both columns
         button_component.GetExitButton(),
     });
 
@@ -113,10 +174,13 @@ void UIComponent::Run() {
                                                    cat_all_button,
                                                    copy_tree_button,
                                                    cat_tree_button,
+                                                   copy_outline_button,
+                                                   cat_outline_button,
                                                    exit_button},
                                                   &button_focused_index);
 
-    auto left_component = Container::Vertical({menu_container,
+    auto left_component = Container::Vertical({search,
+                                               menu_container,
                                                button_container,
                                                instructions});
 
@@ -124,6 +188,9 @@ void UIComponent::Run() {
                                   [&] { return vbox({
                                             text("Current Directory: " + current_directory.string()) | bold | hcenter,
                                             separator(),
+                                            search->Render(),
+                                            dependency_status.empty() ? emptyElement() : text(dependency_status) | dim,
+                                            separator(),
                                             menu_container->Render() | vscroll_indicator | frame | flex,
                                             separator(),
                                             flexbox({
@@ -141,7 +208,14 @@ void UIComponent::Run() {
                                                                 },
                                                                 FlexboxConfig().Set(FlexboxConfig::Direction::Row)),
 
-                                                        // Third Row: exit_button spanning both columns
+                                                        // Third Row: copy_outline_button and cat_outline_button
+                                                        flexbox({
+                                                                    copy_outline_button->Render() | size(HEIGHT, EQUAL, 3) | flex,
+                                                                    cat_outline_button->Render() | size(HEIGHT, EQUAL, 3) | flex,
+                                                                },
+                                                                FlexboxConfig().Set(FlexboxConfig::Direction::Row)),
+
+                                                        // Fourth Row: exit_button spanning both columns
                                                         exit_button->Render() | size(HEIGHT, EQUAL, 3) | flex | flex_grow,
                                                     },
                                                     FlexboxConfig().Set(FlexboxConfig::Direction::Column)  // Stack rows vertically
@@ -160,23 +234,45 @@ void UIComponent::Run() {
                                                  }) |
                                                  border; });
 
-    int left_size = Screen::Create(Dimension::Full()).dimx() / 3;
+    // The terminal is asked for its size once, to place the split. A fullscreen screen already
+    // lays every frame out at the current terminal size and follows resizes itself, so frames
+    // neither query the size nor allocate a screen to learn it.
+    int left_size = Terminal::Size().dimx / 3;
 
     // Create a container with resizable left and right components
     auto main_container = ResizableSplitLeft(left_renderer, right_component, &left_size);
 
-    auto main_container_renderer = Renderer(main_container,
-                                            [&] { return main_container->Render() |
-                                                         size(WIDTH, EQUAL, Screen::Create(Dimension::Full()).dimx()) |
-                                                         size(HEIGHT, EQUAL, Screen::Create(Dimension::Full()).dimy()); });
+    auto main_container_renderer = Renderer(main_container, [&] {
+        Element document = main_container->Render();
+        if (!first_frame_drawn) {
+            first_frame_drawn = true;
+            TRACE_SPAN_SINCE("first-frame", created);
+        }
+        return document;
+    });
 
     // Event handling with circular navigation for the checkboxes
-    auto main_container_with_events = CatchEvent(main_container_renderer, [this, menu_container, copy_all_button, cat_all_button, copy_tree_button, cat_tree_button, exit_button, button_container](Event e) -> bool {
+    auto main_container_with_events = CatchEvent(main_container_renderer, [this, menu_container, copy_all_button, cat_all_button, copy_tree_button, cat_tree_button, copy_outline_button, cat_outline_button, exit_button, button_container](Event e) -> bool {
+        // While the search box has focus, keys edit the query
+        if (search_component.Focused()) {
+            if (e == Event::Escape || e == Event::ArrowDown) {
+                menu_container->TakeFocus();
+                return true;
+            }
+            return false;
+        }
+
         if (e.is_character()) {
             char ch = e.character()[0];
             if (ch == 'q' || ch == 'Q') {
                 screen.ExitLoopClosure()();
                 return true;
+            } else if (ch == '/') {
+                search_component.TakeFocus();
+                return true;
+            } else if (ch == 'd' || ch == 'D') {
+                AddDependencies();
+                return true;
             } else if (ch == 'o' || ch == 'O' || ch == ' ') {
                 if (focused_index >= 0 && focused_index < options.size()) {
                     std::filesystem::path selected_path = current_directory / options[focused_index];
@@ -198,7 +294,9 @@ void UIComponent::Run() {
                 if(copy_all_button->Focused()) button_focused_index = 2;
                 else if(cat_all_button->Focused()) button_focused_index = 3;
                 else if(copy_tree_button->Focused()) button_focused_index = 4;
-                else if(cat_tree_button->Focused()) button_focused_index = 4;
+                else if(cat_tree_button->Focused()) button_focused_index = 5;
+                else if(copy_outline_button->Focused()) button_focused_index = 6;
+                else if(cat_outline_button->Focused()) button_focused_index = 6;
                 else if(exit_button->Focused()) button_focused_index = 0;
                 return true;
             } 
@@ -206,11 +304,13 @@ void UIComponent::Run() {
             return true;
         } else if (e == Event::ArrowUp) {
             if(!menu_container->Focused()) {
-                if(copy_all_button->Focused()) button_focused_index = 4;
-                else if(cat_all_button->Focused()) button_focused_index = 4;
+                if(copy_all_button->Focused()) button_focused_index = 6;
+                else if(cat_all_button->Focused()) button_focused_index = 6;
                 else if(copy_tree_button->Focused()) button_focused_index = 0;
                 else if(cat_tree_button->Focused()) button_focused_index = 1;
-                else if(exit_button->Focused()) button_focused_index = 3;
+                else if(copy_outline_button->Focused()) button_focused_index = 2;
+                else if(cat_outline_button->Focused()) button_focused_index = 3;
+                else if(exit_button->Focused()) button_focused_index = 5;
                 return true;
             } 
             focused_index = (focused_index == 0) ? options.size() - 1 : focused_index - 1;
@@ -231,69 +331,14 @@ void UIComponent::Run() {
     // Loop the screen for interaction
     screen.Loop(main_container_with_events);
 
-    // After exiting the loop, display the directory tree and file contents
-    if (!selected_paths.empty()) {
-        // Ensure all selected paths are absolute
-        std::vector<std::filesystem::path> absolute_paths;
-        for (const auto &path : selected_paths) {
-            absolute_paths.push_back(std::filesystem::absolute(path));
-        }
-
-        // Determine the common root path
-        std::filesystem::path common_root = absolute_paths[0];
-        for (const auto &path : absolute_paths) {
-            auto it1 = common_root.begin();
-            auto it2 = path.begin();
-            std::filesystem::path temp_root;
-            while (it1 != common_root.end() && it2 != path.end() && *it1 == *it2) {
-                temp_root /= *it1;
-                ++it1;
-                ++it2;
-            }
-            common_root = temp_root;
-            if (common_root.empty()) {
-                break;  // No common root
-            }
-        }
-
-        if (common_root.empty()) {
-            // If there's no common root, use the current directory as the base
-            common_root = std::filesystem::current_path();
+    // Remember the selection for the next session unless the user bailed out
+    if (!profile_name.empty() && pressed_button != "Ex") {
+        Utils::StoreSelection(selected_paths, root_path, profile, &profile_selection);
+        if (!Utils::SaveSelectionProfile(root_path, profile_name, profile)) {
+            std::cerr << "Failed to save profile " << profile_name << "\n";
         }
-
-        // When particular button is pressed
-        if (pressed_button == "CaA") {
-            // Print the directory tree
-            Utils::PrintDirectoryTree(absolute_paths, common_root, std::cout);
-
-            // Print the contents of each selected file
-            Utils::PrintFileContents(absolute_paths, std::cout);
-        } else if (pressed_button == "CaT") {
-            // Print the directory tree
-            Utils::PrintDirectoryTree(absolute_paths, common_root, std::cout);
-        } else if (pressed_button == "CoA") {
-            // create a local string_stream
-            std::ostringstream string_stream;
-
-            // Print the directory tree to string_stream
-            Utils::PrintDirectoryTree(absolute_paths, common_root, string_stream);
-
-            // Print the contents of each selected file to string_stream
-            Utils::PrintFileContents(absolute_paths, string_stream);
-
-            // copy string_stream to clipboard
-            Utils::CopyToClipboard(string_stream.str());
-        } else if (pressed_button == "CoT") {
-            // create a local string_stream
-            std::ostringstream string_stream;
-
-            // Print the directory tree to string_stream
-            Utils::PrintDirectoryTree(absolute_paths, common_root, string_stream);
-
-            // copy string_stream to clipboard
-            Utils::CopyToClipboard(string_stream.str());
-        }
-    } else {
-        std::cout << "No items were selected.\n";
     }
+
+    // After exiting the loop, display the directory tree and file contents
+    Utils::DumpSelection(selected_paths, pressed_button, dump_options);
 }
@@ -0,0 +1,352 @@
+#include "utils/batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <set>
+
+#include "utils/dump_manifest.hpp"
+#include "utils/outline.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/selection_profile.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+/**
+ * @brief Outcome of one root, filled in by the worker that dumped it.
+ */
+struct BatchResult {
+    bool ok = false;
+    std::string error;
+    size_t weight = 0;  // Files in the resolved selection
+    std::vector<std::filesystem::path> selection;
+    PathTable table;  // Walk of the selection: weighed in the first pass, dumped from in the second
+    DumpStats stats;
+    uint64_t bytes_written = 0;
+    double seconds = 0;
+};
+
+/**
+ * @brief Splits a manifest line into arguments; double quotes group words.
+ */
+bool SplitArguments(const std::string& line, std::vector<std::string>& arguments) {
+    arguments.clear();
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) ++i;
+        if (i == line.size()) break;
+
+        std::string argument;
+        bool quoted = false;
+        for (; i < line.size(); ++i) {
+            char c = line[i];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+                break;
+            } else {
+                argument += c;
+            }
+        }
+        if (quoted) return false;
+        arguments.push_back(std::move(argument));
+    }
+    return true;
+}
+
+const char* FormatExtension(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::Markdown:
+            return ".md";
+        case OutputFormat::Xml:
+            return ".xml";
+        case OutputFormat::Json:
+            return ".jsonl";
+        default:
+            return ".txt";
+    }
+}
+
+/**
+ * @brief Resolves a job's selection the way headless mode does: the saved profile, if any,
+ *        with the job's rules added, or the whole root.
+ */
+std::set<std::filesystem::path> ResolveSelection(const BatchJob& job) {
+    SelectionProfile profile;
+    if (!job.profile_name.empty()) {
+        LoadSelectionProfile(job.root, job.profile_name, profile);
+    }
+    for (const auto& rule : job.include_rules) {
+        if (std::find(profile.include_rules.begin(), profile.include_rules.end(), rule) == profile.include_rules.end()) {
+            profile.include_rules.push_back(rule);
+        }
+    }
+    for (const auto& rule : job.exclude_rules) {
+        if (std::find(profile.exclude_rules.begin(), profile.exclude_rules.end(), rule) == profile.exclude_rules.end()) {
+            profile.exclude_rules.push_back(rule);
+        }
+    }
+    if (profile.paths.empty()) {
+        profile.paths.emplace_back(".");
+    }
+    return ApplySelectionProfile(profile, job.root, 1);
+}
+
+void DumpJob(const BatchJob& job, BatchResult& result, Semaphore& io_slots) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Parallelism comes from running roots side by side, so each dump stays on its worker
+    DumpOptions options = job.options;
+    options.threads = 1;
+    options.io_slots = &io_slots;
+
+    // Every content dump gets its manifest next to it, so the next run can be a delta against it
+    DumpManifest manifest;
+    if (job.action == "CaA") {
+        manifest.dumps[0] = job.output.string();
+        options.manifest = &manifest;
+    }
+
+    std::error_code ec;
+    if (job.output.has_parent_path()) {
+        std::filesystem::create_directories(job.output.parent_path(), ec);
+    }
+    std::ofstream out(job.output, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        result.error = "cannot write " + job.output.string();
+        return;
+    }
+
+    if (!result.selection.empty()) {
+        std::filesystem::path common_root = CommonRoot(result.selection);
+        if (!(options.since && job.action == "CaA")) {
+            PrintDirectoryTree(result.table, result.selection, common_root, out, options);
+        }
+        if (job.action == "CaA") {
+            result.stats = PrintFileContents(result.table, result.selection, out, options);
+            if (options.since) PrintChangeList(result.stats, out, options);
+        } else if (job.action == "CaO") {
+            result.stats = PrintFileOutlines(result.table, result.selection, out, options);
+        }
+    }
+    // Tables of roots still waiting may be large; this one is no longer needed
+    result.table = PathTable();
+
+    out.flush();
+    if (!out) {
+        result.error = "write to " + job.output.string() + " failed";
+        return;
+    }
+    result.bytes_written = static_cast<uint64_t>(out.tellp());
+    if (options.manifest && !WriteDumpManifest(ManifestPathFor(job.output), manifest)) {
+        result.error = "cannot write " + ManifestPathFor(job.output).string();
+        return;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.ok = true;
+}
+
+}  // namespace
+
+bool ParseBatchManifest(const std::filesystem::path& manifest, const DumpOptions& defaults, OutputFormat default_format, std::vector<BatchJob>& jobs, std::string& error) {
+    std::ifstream file(manifest);
+    if (!file) {
+        error = "cannot open " + manifest.string();
+        return false;
+    }
+
+    std::set<std::filesystem::path> outputs;
+    std::vector<std::string> arguments;
+    std::string line;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        std::string where = manifest.string() + ":" + std::to_string(line_number) + ": ";
+        if (!SplitArguments(line, arguments)) {
+            error = where + "unterminated quote";
+            return false;
+        }
+        if (arguments.empty() || arguments[0][0] == '#') continue;
+
+        BatchJob job;
+        job.root = std::filesystem::absolute(arguments[0]).lexically_normal();
+        if (!job.root.has_filename()) {
+            job.root = job.root.parent_path();  // "repo/" or "repo/."
+        }
+        job.options = defaults;
+        OutputFormat format = default_format;
+
+        for (size_t i = 1; i < arguments.size(); ++i) {
+            const std::string& arg = arguments[i];
+            bool has_value = i + 1 < arguments.size();
+            if (arg == "--minify") {
+                job.options.minify = true;
+            } else if (arg == "--no-redact") {
+                job.options.redact = false;
+            } else if (arg == "--keep-encoding") {
+                job.options.normalize = false;
+            } else if (arg == "--annotate") {
+                job.options.annotate = true;
+            } else if (arg == "--natural-order") {
+                job.options.order = NameOrder::Natural;
+            } else if (arg == "--format" && has_value) {
+                if (!ParseOutputFormat(arguments[++i], format)) {
+                    error = where + "unknown output format " + arguments[i];
+                    return false;
+                }
+                job.options.templates = OutputTemplates::ForFormat(format);
+            } else if (arg == "--profile" && has_value) {
+                job.profile_name = arguments[++i];
+                if (job.profile_name.find_first_of("/\\") != std::string::npos || job.profile_name == "..") {
+                    error = where + "invalid profile name " + job.profile_name;
+                    return false;
+                }
+            } else if (arg == "--include" && has_value) {
+                job.include_rules.push_back(arguments[++i]);
+            } else if (arg == "--exclude" && has_value) {
+                job.exclude_rules.push_back(arguments[++i]);
+            } else if (arg == "--since" && has_value) {
+                auto since = std::make_shared<DumpManifest>();
+                std::string load_error;
+                if (!LoadDumpManifest(arguments[++i], *since, load_error)) {
+                    error = where + load_error;
+                    return false;
+                }
+                job.options.since = std::move(since);
+            } else if (arg == "--diff") {
+                job.options.diff = true;
+            } else if (arg == "--output" && has_value) {
+                job.output = std::filesystem::absolute(arguments[++i]);
+            } else if (arg == "--action" && has_value) {
+                const std::string& name = arguments[++i];
+                if (name == "cat-all") {
+                    job.action = "CaA";
+                } else if (name == "cat-tree") {
+                    job.action = "CaT";
+                } else if (name == "cat-outline") {
+                    job.action = "CaO";
+                } else {
+                    error = where + "unsupported batch action " + name;
+                    return false;
+                }
+            } else {
+                error = where + "unknown option " + arg;
+                return false;
+            }
+        }
+
+        if (job.output.empty()) {
+            // Name the output after the root, numbering repeated names
+            std::string name = job.root.filename().string();
+            if (name.empty()) name = "root";
+            job.output = std::filesystem::absolute(name + FormatExtension(format));
+            for (int n = 2; outputs.count(job.output); ++n) {
+                job.output = std::filesystem::absolute(name + "-" + std::to_string(n) + FormatExtension(format));
+            }
+        }
+        if (!outputs.insert(job.output).second) {
+            error = where + "output " + job.output.string() + " is used by another root";
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+size_t RunBatch(const std::vector<BatchJob>& jobs, unsigned thread_count, unsigned io_slots, std::ostream& report) {
+    TRACE_FUNCTION();
+    if (thread_count == 0) {
+        thread_count = DefaultThreadCount();
+    }
+    if (io_slots == 0) {
+        io_slots = 2 * thread_count;
+    }
+    Semaphore io(io_slots);
+    auto start = std::chrono::steady_clock::now();
+
+    // First pass: resolve every selection and weigh it by its number of files
+    std::vector<BatchResult> results(jobs.size());
+    ParallelFor(jobs.size(), [&](size_t i) {
+        BatchResult& result = results[i];
+        try {
+            if (!std::filesystem::is_directory(jobs[i].root)) {
+                result.error = "not a directory";
+                return;
+            }
+            std::set<std::filesystem::path> selection = ResolveSelection(jobs[i]);
+            result.selection.assign(selection.begin(), selection.end());
+            // Kept for the dump, which then walks nothing again
+            result.table = ParallelWalk(result.selection, 1, jobs[i].options.order);
+            for (uint32_t index = 0; index < result.table.size(); ++index) {
+                result.weight += result.table.Is(index, PathTable::kRegularFile);
+            }
+        } catch (const std::exception& e) {
+            result.error = e.what();
+        }
+    }, thread_count);
+
+    // Second pass: dump the heaviest roots first. ParallelFor hands out indices in order, so
+    // this is longest-processing-time-first scheduling over the shared workers
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return results[a].weight > results[b].weight;
+    });
+    ParallelFor(order.size(), [&](size_t k) {
+        size_t i = order[k];
+        if (!results[i].error.empty()) return;
+        try {
+            DumpJob(jobs[i], results[i], io);
+        } catch (const std::exception& e) {
+            results[i].error = e.what();
+        }
+    }, thread_count);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Report in manifest order
+    size_t failed = 0;
+    DumpStats total;
+    uint64_t written = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const BatchResult& result = results[i];
+        if (!result.ok) {
+            ++failed;
+            report << "FAIL " << jobs[i].root.string() << ": " << result.error << "\n";
+            continue;
+        }
+        total.files += result.stats.files;
+        total.bytes_read += result.stats.bytes_read;
+        total.minified_bytes_in += result.stats.minified_bytes_in;
+        total.minified_bytes_out += result.stats.minified_bytes_out;
+        total.redactions.insert(total.redactions.end(), result.stats.redactions.begin(), result.stats.redactions.end());
+        written += result.bytes_written;
+
+        char timing[32];
+        std::snprintf(timing, sizeof(timing), "%.2f s", result.seconds);
+        report << "OK   " << jobs[i].root.string() << " -> " << jobs[i].output.string() << ": " << result.stats.files
+               << " files, " << result.stats.bytes_read << " bytes read, " << result.bytes_written << " bytes written, "
+               << timing << "\n";
+    }
+
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "%.2f s (%.1f MiB/s read) on %u workers, %u I/O slots", seconds,
+                  seconds > 0 ? static_cast<double>(total.bytes_read) / (1024.0 * 1024.0) / seconds : 0.0, thread_count, io_slots);
+    report << "Batch: " << jobs.size() << " roots, " << failed << " failed, " << total.files << " files, "
+           << total.bytes_read << " bytes read, " << written << " bytes written in " << summary << "\n";
+    if (total.minified_bytes_in > 0) {
+        report << "Minified " << total.minified_bytes_in << " -> " << total.minified_bytes_out << " bytes\n";
+    }
+    if (!total.redactions.empty()) {
+        PrintDumpReport(total, DumpOptions(), report);
+    }
+    return failed;
+}
+
+}  // namespace Utils
@@ -0,0 +1,331 @@
+#include "utils/clipboard.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+extern char** environ;
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CLIPBOARD_SSE2 1
+#endif
+
+#include "utils/trace.hpp"
+
+namespace Utils {
+
+namespace {
+
+constexpr char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Text bytes encoded per write to the terminal; a multiple of 3 so only the last chunk is padded
+constexpr size_t kOsc52Chunk = 48 * 1024;
+
+// Many terminals cap OSC 52 payloads, and tmux and screen buffer the whole sequence
+constexpr size_t kDefaultOsc52Limit = 1 << 20;
+
+// screen forwards at most 768 bytes per DCS string; 76 is what other tools use
+constexpr size_t kScreenPiece = 76;
+
+enum class ToolResult {
+    Copied,
+    Unavailable,  // No display or no clipboard tool installed
+    Failed,       // A tool ran and failed, or the clipboard could not be opened
+};
+
+/**
+ * @brief Packs three bytes into their four 6-bit values, one per byte with the first lowest,
+ *        ready to be stored as four characters once translated.
+ */
+uint32_t Sextets(const unsigned char* p) {
+    uint32_t x = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    return ((x >> 18) & 0x3F) | ((x >> 4) & 0x3F00) | ((x << 10) & 0x3F0000) | ((x << 24) & 0x3F000000);
+}
+
+#ifdef CLIPBOARD_SSE2
+/**
+ * @brief Translates 16 6-bit values to base64 characters. The alphabet is five runs, each a
+ *        constant offset from its values, so every threshold crossed adds the step to the next run.
+ */
+__m128i TranslateBase64(__m128i sextets) {
+    __m128i chars = _mm_add_epi8(sextets, _mm_set1_epi8('A'));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(25)), _mm_set1_epi8('a' - 'A' - 26)));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(51)), _mm_set1_epi8('0' - 'a' - 26)));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(61)), _mm_set1_epi8('+' - '0' - 10)));
+    chars = _mm_add_epi8(chars, _mm_and_si128(_mm_cmpgt_epi8(sextets, _mm_set1_epi8(62)), _mm_set1_epi8('/' - '+' - 1)));
+    return chars;
+}
+#endif
+
+/**
+ * @brief Reads the OSC 52 size limit, in bytes of text, from REPOTOTXT_OSC52_LIMIT.
+ */
+size_t Osc52Limit() {
+    const char* value = std::getenv("REPOTOTXT_OSC52_LIMIT");
+    if (value == nullptr || *value == '\0') {
+        return kDefaultOsc52Limit;
+    }
+    char* end = nullptr;
+    unsigned long long limit = std::strtoull(value, &end, 10);
+    return *end == '\0' ? static_cast<size_t>(limit) : kDefaultOsc52Limit;
+}
+
+bool InRemoteSession() {
+    return std::getenv("SSH_TTY") != nullptr || std::getenv("SSH_CONNECTION") != nullptr;
+}
+
+/**
+ * @brief Writes bytes to the terminal, cutting them into DCS strings of kScreenPiece bytes when
+ *        screen has to pass them through.
+ */
+bool PutTerminal(FILE* tty, std::string_view bytes, bool screen) {
+    if (!screen) {
+        return std::fwrite(bytes.data(), 1, bytes.size(), tty) == bytes.size();
+    }
+    for (size_t start = 0; start < bytes.size(); start += kScreenPiece) {
+        std::string_view piece = bytes.substr(start, kScreenPiece);
+        if (std::fputs("\033P", tty) < 0 || std::fwrite(piece.data(), 1, piece.size(), tty) != piece.size() ||
+            std::fputs("\033\\", tty) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Sends text to the terminal as an OSC 52 clipboard request. The terminal is opened
+ *        directly so this works with the standard streams redirected; base64 is produced and
+ *        written a chunk at a time, so large texts are never encoded in one piece.
+ */
+bool CopyWithOsc52(std::string_view text) {
+    size_t limit = Osc52Limit();
+    if (text.size() > limit) {
+        std::fprintf(stderr, "%zu bytes is over the OSC 52 limit of %zu; use --split-bytes or raise REPOTOTXT_OSC52_LIMIT.\n",
+                     text.size(), limit);
+        return false;
+    }
+#ifdef _WIN32
+    FILE* tty = std::fopen("CONOUT$", "wb");
+#else
+    FILE* tty = std::fopen("/dev/tty", "wb");
+#endif
+    if (tty == nullptr) {
+        std::fprintf(stderr, "No terminal to send the OSC 52 sequence to.\n");
+        return false;
+    }
+
+    // tmux passes a DCS string through when every ESC inside it is doubled; screen wants short ones
+    bool tmux = std::getenv("TMUX") != nullptr;
+    bool screen = !tmux && std::getenv("STY") != nullptr;
+    bool ok = !tmux || std::fputs("\033Ptmux;\033", tty) >= 0;
+    ok = ok && PutTerminal(tty, "\033]52;c;", screen);
+
+    std::string encoded;
+    encoded.reserve((kOsc52Chunk / 3) * 4);
+    for (size_t start = 0; ok && start < text.size(); start += kOsc52Chunk) {
+        encoded.clear();
+        AppendBase64(text.substr(start, kOsc52Chunk), encoded);
+        ok = PutTerminal(tty, encoded, screen);
+    }
+
+    ok = ok && PutTerminal(tty, "\a", screen);
+    ok = ok && (!tmux || std::fputs("\033\\", tty) >= 0);
+    ok = std::fclose(tty) == 0 && ok;
+    if (!ok) {
+        std::fprintf(stderr, "Failed to write the OSC 52 sequence to the terminal.\n");
+    }
+    return ok;
+}
+
+#ifndef _WIN32
+/**
+ * @brief Runs a clipboard tool without a shell and feeds it the text on its standard input.
+ */
+ToolResult RunTool(const char* const* argv, std::string_view text) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return ToolResult::Failed;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, nullptr, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[0]);
+    if (error != 0) {
+        close(fds[1]);
+        return error == ENOENT ? ToolResult::Unavailable : ToolResult::Failed;
+    }
+
+    // A tool that exits early must fail the copy, not kill this process
+    struct sigaction ignore = {};
+    struct sigaction previous;
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &previous);
+    bool written = true;
+    for (size_t offset = 0; offset < text.size();) {
+        ssize_t count = write(fds[1], text.data() + offset, text.size() - offset);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            written = false;
+            break;
+        }
+        offset += static_cast<size_t>(count);
+    }
+    close(fds[1]);
+    sigaction(SIGPIPE, &previous, nullptr);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        // Where exec failures are not reported by posix_spawnp, the child exits with 127
+        return ToolResult::Unavailable;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "Clipboard command %s failed with status %d.\n", argv[0], status);
+        return ToolResult::Failed;
+    }
+    if (!written) {
+        std::fprintf(stderr, "Clipboard command %s stopped reading before the end of the text.\n", argv[0]);
+        return ToolResult::Failed;
+    }
+    return ToolResult::Copied;
+}
+#endif
+
+/**
+ * @brief Copies text with the platform's clipboard: the Win32 API, pbcopy, or on Linux wl-copy
+ *        under Wayland and xclip or xsel under X11.
+ */
+ToolResult CopyWithTool(std::string_view text) {
+#ifdef _WIN32
+    if (!OpenClipboard(nullptr)) {
+        return ToolResult::Failed;
+    }
+    EmptyClipboard();
+
+    HGLOBAL hGlob = GlobalAlloc(GMEM_FIXED, text.size() + 1);
+    if (!hGlob) {
+        CloseClipboard();
+        return ToolResult::Failed;
+    }
+    memcpy(hGlob, text.data(), text.size());
+    static_cast<char*>(hGlob)[text.size()] = '\0';
+    SetClipboardData(CF_TEXT, hGlob);
+    CloseClipboard();
+    GlobalFree(hGlob);
+    return ToolResult::Copied;
+
+#elif __APPLE__
+    static const char* const kPbcopy[] = {"pbcopy", nullptr};
+    return RunTool(kPbcopy, text);
+
+#elif __linux__
+    static const char* const kWlCopy[] = {"wl-copy", nullptr};
+    static const char* const kXclip[] = {"xclip", "-selection", "clipboard", nullptr};
+    static const char* const kXsel[] = {"xsel", "--clipboard", "--input", nullptr};
+    if (std::getenv("WAYLAND_DISPLAY") != nullptr) {
+        ToolResult result = RunTool(kWlCopy, text);
+        if (result != ToolResult::Unavailable) return result;
+    }
+    if (std::getenv("DISPLAY") != nullptr) {
+        ToolResult result = RunTool(kXclip, text);
+        if (result != ToolResult::Unavailable) return result;
+        return RunTool(kXsel, text);
+    }
+    return ToolResult::Unavailable;
+
+#else
+    (void)text;
+    return ToolResult::Unavailable;
+#endif
+}
+
+}  // namespace
+
+bool ParseClipboardBackend(std::string_view name, ClipboardBackend& backend) {
+    if (name == "auto") {
+        backend = ClipboardBackend::Auto;
+    } else if (name == "osc52") {
+        backend = ClipboardBackend::Osc52;
+    } else if (name == "tool") {
+        backend = ClipboardBackend::Tool;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void AppendBase64(std::string_view data, std::string& out) {
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data.data());
+    size_t size = data.size();
+    size_t mark = out.size();
+    out.resize(mark + (size + 2) / 3 * 4);
+    char* p = &out[mark];
+
+    size_t i = 0;
+#ifdef CLIPBOARD_SSE2
+    for (; i + 12 <= size; i += 12, p += 16) {
+        __m128i sextets = _mm_set_epi32(static_cast<int>(Sextets(in + i + 9)), static_cast<int>(Sextets(in + i + 6)),
+                                        static_cast<int>(Sextets(in + i + 3)), static_cast<int>(Sextets(in + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), TranslateBase64(sextets));
+    }
+#endif
+    for (; i + 3 <= size; i += 3, p += 4) {
+        uint32_t sextets = Sextets(in + i);
+        p[0] = kBase64Alphabet[sextets & 0x3F];
+        p[1] = kBase64Alphabet[(sextets >> 8) & 0x3F];
+        p[2] = kBase64Alphabet[(sextets >> 16) & 0x3F];
+        p[3] = kBase64Alphabet[sextets >> 24];
+    }
+    if (i < size) {
+        unsigned char rest[3] = {in[i], 0, 0};
+        if (i + 1 < size) rest[1] = in[i + 1];
+        uint32_t sextets = Sextets(rest);
+        p[0] = kBase64Alphabet[sextets & 0x3F];
+        p[1] = kBase64Alphabet[(sextets >> 8) & 0x3F];
+        p[2] = i + 1 < size ? kBase64Alphabet[(sextets >> 16) & 0x3F] : '=';
+        p[3] = '=';
+    }
+}
+
+bool CopyToClipboard(std::string_view text, ClipboardBackend backend) {
+    TRACE_PHASE("clipboard");
+    if (backend == ClipboardBackend::Osc52) {
+        return CopyWithOsc52(text);
+    }
+
+    // Over SSH the local clipboard tools would copy on the remote machine
+    bool remote = backend == ClipboardBackend::Auto && InRemoteSession();
+    if (remote && text.size() <= Osc52Limit()) {
+        return CopyWithOsc52(text);
+    }
+    ToolResult result = CopyWithTool(text);
+    if (result == ToolResult::Unavailable && backend == ClipboardBackend::Auto) {
+        return CopyWithOsc52(text);
+    }
+    if (result == ToolResult::Unavailable) {
+        std::fprintf(stderr, "No clipboard tool found; install wl-copy, xclip or xsel, or use --clipboard osc52.\n");
+    }
+    return result == ToolResult::Copied;
+}
+
+}  // namespace Utils
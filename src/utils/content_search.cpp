@@ -0,0 +1,311 @@
+#include "utils/content_search.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "utils/file_metrics.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/text_encoding.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+// std::regex backtracks recursively, so very long lines (minified bundles, data files) could
+// exhaust the stack. Such lines only go through the literal prefilter.
+constexpr size_t kMaxRegexLine = 64 * 1024;
+
+char LowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+char UpperAscii(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+/**
+ * @brief Rough frequency of a byte in source code; lower is rarer.
+ */
+int ByteFrequency(char c) {
+    if (c == ' ' || c == '\n' || c == '\t') return 6;
+    if (c >= 'a' && c <= 'z') return std::strchr("etaoinsrl", c) ? 5 : 4;
+    if (c >= 'A' && c <= 'Z') return 2;
+    if ((c >= '0' && c <= '9') || c == '_' || c == '(' || c == ')' || c == ';' || c == '.' || c == ',') return 3;
+    return 1;
+}
+
+/**
+ * @brief Returns the longest run of plain characters that every match of an ECMAScript
+ *        expression must contain, or an empty string if there is none (top-level alternation,
+ *        or nothing but classes and groups). Runs inside groups are ignored, as groups may be
+ *        optional or alternated.
+ */
+std::string RequiredLiteral(const std::string& pattern) {
+    std::string best;
+    std::string run;
+    auto end_run = [&] {
+        if (run.size() > best.size()) best = run;
+        run.clear();
+    };
+
+    int depth = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        char literal;
+        if (c == '\\') {
+            if (++i == pattern.size()) break;
+            literal = pattern[i];
+            if (std::isalnum(static_cast<unsigned char>(literal))) {
+                end_run();  // \d, \w, \b, \x41, ... are classes or escapes, not the letter itself
+                continue;
+            }
+        } else if (c == '[') {
+            // Skip the class, whose first ']' (after an optional '^') is literal
+            end_run();
+            size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '^') ++j;
+            if (j < pattern.size() && pattern[j] == ']') ++j;
+            for (; j < pattern.size() && pattern[j] != ']'; ++j) {
+                if (pattern[j] == '\\') ++j;
+            }
+            i = j;
+            continue;
+        } else if (c == '(') {
+            ++depth;
+            end_run();
+            continue;
+        } else if (c == ')') {
+            --depth;
+            end_run();
+            continue;
+        } else if (c == '|') {
+            if (depth == 0) return std::string();
+            continue;
+        } else if (c == '*' || c == '?' || c == '{') {
+            // The quantified character may not appear at all
+            if (!run.empty()) run.pop_back();
+            end_run();
+            if (c == '{') {
+                while (i < pattern.size() && pattern[i] != '}') ++i;
+            }
+            continue;
+        } else if (c == '.' || c == '^' || c == '$' || c == '+') {
+            end_run();
+            continue;
+        } else {
+            literal = c;
+        }
+        if (depth == 0) run += literal;
+    }
+    end_run();
+    return best;
+}
+
+}  // namespace
+
+bool ContentMatcher::Compile(const std::string& pattern, bool regex, bool ignore_case, ContentMatcher& matcher, std::string& error) {
+    if (pattern.empty()) {
+        error = "empty pattern";
+        return false;
+    }
+    ContentMatcher compiled;
+    compiled.pattern = pattern;
+    compiled.ignore_case = ignore_case;
+    if (regex) {
+        try {
+            auto flags = std::regex::ECMAScript | std::regex::optimize;
+            if (ignore_case) flags |= std::regex::icase;
+            compiled.expression = std::make_shared<const std::regex>(pattern, flags);
+        } catch (const std::regex_error& e) {
+            error = e.what();
+            return false;
+        }
+        compiled.literal = RequiredLiteral(pattern);
+    } else {
+        compiled.literal = pattern;
+    }
+    if (ignore_case) {
+        std::transform(compiled.literal.begin(), compiled.literal.end(), compiled.literal.begin(), LowerAscii);
+    }
+
+    // Anchor on the rarest byte so memchr stops as seldom as possible
+    for (size_t i = 1; i < compiled.literal.size(); ++i) {
+        if (ByteFrequency(compiled.literal[i]) < ByteFrequency(compiled.literal[compiled.anchor])) {
+            compiled.anchor = i;
+        }
+    }
+    matcher = std::move(compiled);
+    return true;
+}
+
+size_t ContentMatcher::FindLiteral(std::string_view text, size_t from) const {
+    const size_t length = literal.size();
+    if (text.size() < length || from > text.size() - length) {
+        return std::string_view::npos;
+    }
+    const char* base = text.data();
+    const size_t last = text.size() - length + anchor;  // Last position the anchor byte can be at
+
+    auto equal = [&](size_t start) {
+        if (!ignore_case) {
+            return std::memcmp(base + start, literal.data(), length) == 0;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (LowerAscii(base[start + i]) != literal[i]) return false;
+        }
+        return true;
+    };
+    auto find = [&](char c, size_t position) -> size_t {
+        if (position > last) return std::string_view::npos;
+        const void* found = std::memchr(base + position, c, last - position + 1);
+        return found ? static_cast<size_t>(static_cast<const char*>(found) - base) : std::string_view::npos;
+    };
+
+    const char lower = literal[anchor];
+    const char upper = UpperAscii(lower);
+    size_t next_lower = find(lower, from + anchor);
+    size_t next_upper = ignore_case && upper != lower ? find(upper, from + anchor) : std::string_view::npos;
+    for (;;) {
+        size_t position = std::min(next_lower, next_upper);
+        if (position == std::string_view::npos) {
+            return position;
+        }
+        if (equal(position - anchor)) {
+            return position - anchor;
+        }
+        if (position == next_lower) {
+            next_lower = find(lower, position + 1);
+        } else {
+            next_upper = find(upper, position + 1);
+        }
+    }
+}
+
+bool ContentMatcher::LineMatches(std::string_view line) const {
+    if (!expression) {
+        return true;  // The prefilter found the literal, which is the whole pattern
+    }
+    if (line.size() > kMaxRegexLine) {
+        return !literal.empty();
+    }
+    return std::regex_search(line.begin(), line.end(), *expression);
+}
+
+void ContentMatcher::ForEachMatchingLine(std::string_view text, const std::function<bool(uint32_t, std::string_view)>& visit) const {
+    uint64_t line_number = 1;
+    size_t counted = 0;  // Newlines before this offset are included in line_number
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t hit = position;
+        if (!literal.empty()) {
+            hit = FindLiteral(text, position);
+            if (hit == std::string_view::npos) break;
+        }
+
+        // position always starts a line, so the hit's line begins at or after it
+        size_t line_start = hit;
+        while (line_start > position && text[line_start - 1] != '\n') --line_start;
+        size_t line_end = text.find('\n', hit);
+        if (line_end == std::string_view::npos) line_end = text.size();
+
+        line_number += CountNewlines(text.data() + counted, line_start - counted);
+        counted = line_start;
+
+        std::string_view line = text.substr(line_start, line_end - line_start);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (LineMatches(line) && !visit(static_cast<uint32_t>(line_number), line)) {
+            return;
+        }
+        position = line_end + 1;
+    }
+}
+
+bool ContentMatcher::Matches(std::string_view text) const {
+    bool found = false;
+    ForEachMatchingLine(text, [&found](uint32_t, std::string_view) {
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+void FormatMatchSnippets(std::string_view text, const ContentMatcher& matcher, unsigned context, std::string& out, std::string_view shown) {
+    std::vector<uint32_t> matches;
+    matcher.ForEachMatchingLine(text, [&matches](uint32_t line, std::string_view) {
+        matches.push_back(line);
+        return true;
+    });
+    if (matches.empty()) {
+        return;
+    }
+
+    // Walk the lines once, printing those within context of a match
+    if (shown.empty()) shown = text;
+    size_t next = 0;  // First match whose range has not been passed yet
+    uint32_t last_printed = 0;
+    uint32_t line_number = 1;
+    for (size_t start = 0; start < shown.size() && next < matches.size(); ++line_number) {
+        size_t end = shown.find('\n', start);
+        if (end == std::string_view::npos) end = shown.size();
+
+        while (next < matches.size() && matches[next] + context < line_number) ++next;
+        if (next < matches.size() && line_number + context >= matches[next]) {
+            if (last_printed != 0 && line_number > last_printed + 1) {
+                out += "--\n";
+            }
+            std::string_view line = shown.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            out += 'L';
+            out += std::to_string(line_number);
+            out += std::binary_search(matches.begin(), matches.end(), line_number) ? ": " : "- ";
+            out.append(line.data(), line.size());
+            out += '\n';
+            last_printed = line_number;
+        }
+        start = end + 1;
+    }
+}
+
+std::vector<uint32_t> SearchFiles(const PathTable& table, const std::vector<uint32_t>& files, const ContentMatcher& matcher, unsigned thread_count, Semaphore* io_slots) {
+    TRACE_PHASE("search");
+    std::vector<char> matched(files.size(), 0);
+    ParallelFor(files.size(), [&](size_t i) {
+        thread_local std::string content;
+        thread_local std::string normalized;
+        bool readable;
+        {
+            SemaphoreGuard slot(io_slots);
+            readable = ReadFileContents(table.Path(files[i]), content);
+        }
+        if (!readable) return;
+        // Matched against the text as it is dumped, so UTF-16 files and CRLF lines are searchable
+        std::string_view text = NormalizeText(content, normalized);
+        matched[i] = !IsBinaryContent(text) && matcher.Matches(text);
+    }, thread_count);
+
+    std::vector<uint32_t> hits;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (matched[i]) hits.push_back(files[i]);
+    }
+    return hits;
+}
+
+std::set<std::filesystem::path> FilterSelectionByContent(const std::set<std::filesystem::path>& selected_paths, const ContentMatcher& matcher, unsigned thread_count) {
+    TRACE_FUNCTION();
+    std::vector<std::filesystem::path> paths;
+    for (const auto& path : selected_paths) {
+        paths.push_back(std::filesystem::absolute(path));
+    }
+    PathTable table = ParallelWalk(paths, thread_count);
+
+    std::set<std::filesystem::path> matching;
+    for (uint32_t index : SearchFiles(table, SelectedFiles(table, paths), matcher, thread_count)) {
+        matching.insert(table.Path(index));
+    }
+    return matching;
+}
+
+}  // namespace Utils
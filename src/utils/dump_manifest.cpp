@@ -0,0 +1,260 @@
+#include "utils/dump_manifest.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "utils/trace.hpp"
+
+namespace Utils {
+
+namespace {
+
+constexpr const char* kHeader = "# repototxt manifest 1";
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+
+uint64_t Load64(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t Rotate(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t Round(uint64_t lane, uint64_t word) {
+    return Rotate(lane + word * kPrime2, 31) * kPrime1;
+}
+
+/**
+ * @brief Parses one unsigned decimal field and the space after it.
+ */
+bool ParseField(const char*& p, uint64_t& value) {
+    char* end = nullptr;
+    value = std::strtoull(p, &end, 10);
+    if (end == p || *end != ' ') return false;
+    p = end + 1;
+    return true;
+}
+
+}  // namespace
+
+uint64_t HashContent(std::string_view text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    uint64_t hash;
+    if (text.size() >= 32) {
+        // Four lanes keep four multiplications in flight
+        uint64_t lane1 = kPrime1 + kPrime2;
+        uint64_t lane2 = kPrime2;
+        uint64_t lane3 = 0;
+        uint64_t lane4 = 0 - kPrime1;
+        for (; end - p >= 32; p += 32) {
+            lane1 = Round(lane1, Load64(p));
+            lane2 = Round(lane2, Load64(p + 8));
+            lane3 = Round(lane3, Load64(p + 16));
+            lane4 = Round(lane4, Load64(p + 24));
+        }
+        hash = Rotate(lane1, 1) + Rotate(lane2, 7) + Rotate(lane3, 12) + Rotate(lane4, 18);
+        for (uint64_t lane : {lane1, lane2, lane3, lane4}) {
+            hash = (hash ^ Round(0, lane)) * kPrime1 + kPrime4;
+        }
+    } else {
+        hash = kPrime3;
+    }
+    hash += text.size();
+
+    for (; end - p >= 8; p += 8) {
+        hash = Rotate(hash ^ Round(0, Load64(p)), 27) * kPrime1 + kPrime4;
+    }
+    for (; p < end; ++p) {
+        hash = Rotate(hash ^ (static_cast<unsigned char>(*p) * kPrime3), 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::string DumpSettings(const DumpOptions& options) {
+    std::string settings = "normalize=";
+    settings += options.normalize ? '1' : '0';
+    settings += " redact=";
+    settings += options.redact ? '1' : '0';
+    settings += " minify=";
+    settings += options.minify ? '1' : '0';
+    settings += " snippets=";
+    settings += std::to_string(options.search ? options.snippet_context : -1);
+    return settings;
+}
+
+std::filesystem::path ManifestPathFor(const std::filesystem::path& dump) {
+    std::filesystem::path path = dump;
+    path += ".manifest";
+    return path;
+}
+
+size_t DumpManifest::Find(std::string_view path) const {
+    auto it = index.find(path);
+    return it == index.end() ? SIZE_MAX : it->second;
+}
+
+void DumpManifest::Index() {
+    index.clear();
+    index.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        index.emplace(entries[i].path, i);
+    }
+}
+
+uint32_t DumpManifest::AddDump(const std::string& dump) {
+    for (size_t i = 1; i < dumps.size(); ++i) {
+        if (dumps[i] == dump) return static_cast<uint32_t>(i);
+    }
+    dumps.push_back(dump);
+    return static_cast<uint32_t>(dumps.size() - 1);
+}
+
+bool DumpManifest::ReadBody(const ManifestEntry& entry, std::string& buffer) const {
+    if (entry.dump >= dumps.size() || dumps[entry.dump].empty()) {
+        return false;
+    }
+    TRACE_FS_CALL(kOpen);
+    std::ifstream file(dumps[entry.dump], std::ios::binary);
+    if (!file || !file.seekg(static_cast<std::streamoff>(entry.offset))) {
+        return false;
+    }
+    TRACE_FS_CALL(kRead);
+    buffer.resize(entry.length);
+    if (!file.read(&buffer[0], static_cast<std::streamsize>(entry.length))) {
+        return false;
+    }
+    return HashContent(buffer) == entry.hash;
+}
+
+bool WriteDumpManifest(const std::filesystem::path& path, const DumpManifest& manifest) {
+    TRACE_FUNCTION();
+    std::string text = kHeader;
+    text += "\nsettings ";
+    text += manifest.settings;
+    text += '\n';
+    for (size_t i = 0; i < manifest.dumps.size(); ++i) {
+        if (manifest.dumps[i].empty()) continue;
+        text += "dump " + std::to_string(i) + " " + manifest.dumps[i] + "\n";
+    }
+
+    // One line per file: hash size mtime length dump:offset path, with '-' for no dump
+    char fields[128];
+    for (const ManifestEntry& entry : manifest.entries) {
+        if (entry.path.find('\n') != std::string::npos) continue;
+        int length;
+        if (entry.dump < manifest.dumps.size() && !manifest.dumps[entry.dump].empty()) {
+            length = std::snprintf(fields, sizeof(fields), "%016" PRIx64 " %" PRIu64 " %" PRId64 " %" PRIu64 " %" PRIu32 ":%" PRIu64 " ",
+                                   entry.hash, entry.size, entry.mtime, entry.length, entry.dump, entry.offset);
+        } else {
+            length = std::snprintf(fields, sizeof(fields), "%016" PRIx64 " %" PRIu64 " %" PRId64 " %" PRIu64 " - ",
+                                   entry.hash, entry.size, entry.mtime, entry.length);
+        }
+        text.append(fields, static_cast<size_t>(length));
+        text += entry.path;
+        text += '\n';
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file && file.write(text.data(), static_cast<std::streamsize>(text.size())) && file.flush();
+}
+
+bool LoadDumpManifest(const std::filesystem::path& path, DumpManifest& manifest, std::string& error) {
+    TRACE_FUNCTION();
+    // Given a dump, its manifest sits next to it; given a manifest, the dump may
+    std::error_code ec;
+    std::filesystem::path manifest_path = path;
+    std::filesystem::path dump_path;
+    if (std::filesystem::is_regular_file(ManifestPathFor(path), ec)) {
+        manifest_path = ManifestPathFor(path);
+        dump_path = path;
+    } else if (path.extension() == ".manifest") {
+        std::filesystem::path beside = path;
+        beside.replace_extension();
+        if (std::filesystem::is_regular_file(beside, ec)) dump_path = beside;
+    }
+
+    std::ifstream file(manifest_path, std::ios::binary);
+    if (!file) {
+        error = "cannot read " + manifest_path.string();
+        return false;
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != kHeader) {
+        error = manifest_path.string() + " is not a dump manifest";
+        return false;
+    }
+
+    manifest = DumpManifest();
+    size_t line_number = 1;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (line.compare(0, 9, "settings ") == 0) {
+            manifest.settings = line.substr(9);
+            continue;
+        }
+        const char* p = line.c_str();
+        uint64_t number = 0;
+        if (line.compare(0, 5, "dump ") == 0) {
+            p += 5;
+            if (!ParseField(p, number) || number > 1024 || *p == '\0') {
+                error = manifest_path.string() + ":" + std::to_string(line_number) + ": malformed dump line";
+                return false;
+            }
+            if (manifest.dumps.size() <= number) manifest.dumps.resize(number + 1);
+            manifest.dumps[number] = p;
+            continue;
+        }
+
+        ManifestEntry entry;
+        char* end = nullptr;
+        entry.hash = std::strtoull(p, &end, 16);
+        bool ok = end == p + 16 && *end == ' ';
+        p = end + 1;
+        ok = ok && ParseField(p, entry.size);
+        if (ok) {
+            entry.mtime = std::strtoll(p, &end, 10);
+            ok = end != p && *end == ' ';
+            p = end + 1;
+        }
+        ok = ok && ParseField(p, entry.length);
+        if (ok && *p == '-') {
+            ok = p[1] == ' ';
+            p += 2;
+        } else if (ok) {
+            entry.dump = static_cast<uint32_t>(std::strtoul(p, &end, 10));
+            ok = end != p && *end == ':' && entry.dump < manifest.dumps.size();
+            p = end + 1;
+            ok = ok && ParseField(p, entry.offset);
+        }
+        if (!ok || *p == '\0') {
+            error = manifest_path.string() + ":" + std::to_string(line_number) + ": malformed entry";
+            return false;
+        }
+        entry.path = p;
+        manifest.entries.push_back(std::move(entry));
+    }
+
+    if (!dump_path.empty()) {
+        manifest.dumps[0] = std::filesystem::absolute(dump_path).string();
+    }
+    manifest.Index();
+    return true;
+}
+
+}  // namespace Utils
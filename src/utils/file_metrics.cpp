@@ -0,0 +1,200 @@
+#include "utils/file_metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FILE_METRICS_SSE2 1
+#endif
+
+#include "utils/parallel_for.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+/**
+ * @brief Formats a count with one decimal and a k/M suffix once it passes a thousand.
+ */
+std::string FormatCount(uint64_t value) {
+    char buffer[32];
+    if (value < 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+    } else if (value < 1000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fk", static_cast<double>(value) / 1e3);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.1fM", static_cast<double>(value) / 1e6);
+    }
+    return buffer;
+}
+
+std::string FormatBytes(uint64_t bytes) {
+    static const char* const kUnits[] = {"KiB", "MiB", "GiB", "TiB"};
+    char buffer[32];
+    if (bytes < 1024) {
+        std::snprintf(buffer, sizeof(buffer), "%llu B", static_cast<unsigned long long>(bytes));
+        return buffer;
+    }
+    double value = static_cast<double>(bytes) / 1024.0;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < sizeof(kUnits) / sizeof(kUnits[0])) {
+        value /= 1024.0;
+        ++unit;
+    }
+    std::snprintf(buffer, sizeof(buffer), "%.1f %s", value, kUnits[unit]);
+    return buffer;
+}
+
+}  // namespace
+
+bool MetricsCache::Lookup(const std::string& path, uint64_t size, std::filesystem::file_time_type time, FileMetrics& metrics) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it == entries.end() || it->second.size != size || it->second.time != time) {
+        return false;
+    }
+    metrics = it->second.metrics;
+    return true;
+}
+
+void MetricsCache::Store(const std::string& path, uint64_t size, std::filesystem::file_time_type time, const FileMetrics& metrics) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[path] = Entry{size, time, metrics};
+}
+
+uint64_t CountNewlines(const char* data, size_t size) {
+    uint64_t count = 0;
+    size_t i = 0;
+
+#ifdef FILE_METRICS_SSE2
+    // Matches are accumulated as per-byte counters (each compare yields -1 per match, so
+    // subtracting adds one) and folded into the total with a SAD before they can overflow
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= size) {
+        __m128i counters = zero;
+        size_t block_end = std::min(size - 15, i + 255 * 16);
+        for (; i < block_end; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, newline));
+        }
+        __m128i sums = _mm_sad_epu8(counters, zero);
+        count += static_cast<uint64_t>(_mm_cvtsi128_si32(sums)) + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    }
+#else
+    // Portable fallback: flag newline bytes eight at a time with SWAR arithmetic
+    constexpr uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr uint64_t kLows = 0x7F7F7F7F7F7F7F7FULL;
+    while (i + 8 <= size) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        uint64_t x = word ^ (kOnes * '\n');
+        // High bit of each byte is set exactly where the byte was '\n'
+        uint64_t matches = ~(((x & kLows) + kLows) | x | kLows);
+        // Move each flag to the low bit of its byte and sum the bytes with one multiply
+        count += (((matches >> 7) * kOnes) >> 56);
+        i += 8;
+    }
+#endif
+
+    for (; i < size; ++i) {
+        count += data[i] == '\n';
+    }
+    return count;
+}
+
+bool MeasureFile(const std::filesystem::path& path, FileMetrics& metrics) {
+    TRACE_FILE_READ();
+    TRACE_FS_CALL(kOpen);
+    metrics = FileMetrics();
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    char chunk[64 * 1024];
+    char last = '\n';
+    while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+        TRACE_FS_CALL(kRead);
+        size_t length = static_cast<size_t>(file.gcount());
+        metrics.bytes += length;
+        metrics.lines += CountNewlines(chunk, length);
+        last = chunk[length - 1];
+    }
+    if (last != '\n') {
+        ++metrics.lines;
+    }
+    metrics.files = 1;
+    return true;
+}
+
+std::vector<FileMetrics> ComputeTreeMetrics(const PathTable& table, MetricsCache* cache, unsigned thread_count, Semaphore* io_slots) {
+    TRACE_PHASE("metrics");
+    std::vector<FileMetrics> metrics(table.size());
+
+    std::vector<uint32_t> files;
+    for (uint32_t index = 0; index < table.size(); ++index) {
+        if (table.Is(index, PathTable::kRegularFile)) files.push_back(index);
+    }
+
+    // Every task writes only its own slot, so no synchronisation is needed besides the cache's
+    ParallelFor(files.size(), [&](size_t i) {
+        uint32_t index = files[i];
+        std::filesystem::path path = table.Path(index);
+        if (cache == nullptr) {
+            SemaphoreGuard slot(io_slots);
+            MeasureFile(path, metrics[index]);
+            return;
+        }
+
+        std::error_code ec;
+        TRACE_FS_CALL(kStat);
+        uint64_t size = std::filesystem::file_size(path, ec);
+        TRACE_FS_CALL(kStat);
+        std::filesystem::file_time_type time = ec ? std::filesystem::file_time_type() : std::filesystem::last_write_time(path, ec);
+        std::string key = table.PathString(index);
+        if (!ec && cache->Lookup(key, size, time, metrics[index])) {
+            return;
+        }
+        bool measured;
+        {
+            SemaphoreGuard slot(io_slots);
+            measured = MeasureFile(path, metrics[index]);
+        }
+        if (measured && !ec) {
+            cache->Store(key, size, time, metrics[index]);
+        }
+    }, thread_count);
+
+    // Ordered() is a pre-order walk, so in reverse every child is visited before its parent
+    const std::vector<uint32_t>& ordered = table.Ordered();
+    for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
+        uint32_t parent = table[*it].parent;
+        if (parent != PathTable::kNone) {
+            metrics[parent].Add(metrics[*it]);
+        }
+    }
+    return metrics;
+}
+
+std::string FormatMetrics(const FileMetrics& metrics, bool with_files) {
+    std::string text;
+    if (with_files) {
+        text += std::to_string(metrics.files);
+        text += metrics.files == 1 ? " file, " : " files, ";
+    }
+    text += FormatBytes(metrics.bytes);
+    text += ", ";
+    text += FormatCount(metrics.lines);
+    text += metrics.lines == 1 ? " line, ~" : " lines, ~";
+    text += FormatCount(EstimateTokens(metrics.bytes));
+    text += " tokens";
+    return text;
+}
+
+}  // namespace Utils
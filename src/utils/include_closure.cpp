@@ -0,0 +1,418 @@
+#include "utils/include_closure.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "utils/parallel_for.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+bool IsBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * @brief Appends the names of the quoted includes of a source file. A directive counts when
+ *        its '#' is the first thing on a line; '#' is found with memchr, so lines without one
+ *        cost next to nothing. Conditional blocks are not evaluated, so the result may hold a
+ *        few more files than a particular build uses.
+ */
+void ScanQuotedIncludes(std::string_view text, std::vector<std::string>& names) {
+    const char* base = text.data();
+    const size_t size = text.size();
+    size_t position = 0;
+    while (position < size) {
+        const void* found = std::memchr(base + position, '#', size - position);
+        if (found == nullptr) {
+            break;
+        }
+        size_t hash = static_cast<size_t>(static_cast<const char*>(found) - base);
+        position = hash + 1;
+
+        size_t line_start = hash;
+        while (line_start > 0 && IsBlank(base[line_start - 1])) --line_start;
+        if (line_start > 0 && base[line_start - 1] != '\n') {
+            continue;
+        }
+
+        size_t i = hash + 1;
+        while (i < size && IsBlank(base[i])) ++i;
+        std::string_view rest = text.substr(i);
+        size_t keyword;
+        if (rest.compare(0, 7, "include") == 0) {
+            keyword = 7;
+        } else if (rest.compare(0, 6, "import") == 0) {
+            keyword = 6;  // Objective-C
+        } else {
+            continue;
+        }
+        i += keyword;
+        while (i < size && IsBlank(base[i])) ++i;
+        if (i == size || base[i] != '"') {
+            continue;
+        }
+        size_t end = i + 1;
+        while (end < size && base[end] != '"' && base[end] != '\n') ++end;
+        if (end < size && base[end] == '"' && end > i + 1) {
+            names.emplace_back(base + i + 1, end - i - 1);
+        }
+        position = end;
+    }
+}
+
+/**
+ * @brief Reads a JSON string starting at the opening quote and moves past its closing quote.
+ *        Escaped code points outside ASCII are kept as '?'; they cannot occur in the flags that
+ *        matter here.
+ */
+bool ReadJsonString(std::string_view text, size_t& position, std::string& out) {
+    out.clear();
+    for (++position; position < text.size(); ++position) {
+        char c = text[position];
+        if (c == '"') {
+            ++position;
+            return true;
+        }
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (++position == text.size()) {
+            break;
+        }
+        switch (text[position]) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u': {
+                unsigned value = 0;
+                for (int digit = 0; digit < 4 && position + 1 < text.size(); ++digit) {
+                    char h = text[++position];
+                    value = value * 16 + static_cast<unsigned>(std::isdigit(static_cast<unsigned char>(h)) ? h - '0' : (std::tolower(static_cast<unsigned char>(h)) - 'a' + 10));
+                }
+                out += value < 0x80 ? static_cast<char>(value) : '?';
+                break;
+            }
+            default: out += text[position]; break;
+        }
+    }
+    return false;
+}
+
+void SkipWhitespace(std::string_view text, size_t& position) {
+    while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) ++position;
+}
+
+/**
+ * @brief Splits a command line into arguments the way a POSIX shell would for the simple
+ *        quoting compilation databases use: single and double quotes and backslash escapes.
+ */
+std::vector<std::string> SplitCommandLine(std::string_view command) {
+    std::vector<std::string> arguments;
+    std::string current;
+    bool in_argument = false;
+    char quote = 0;
+    for (size_t i = 0; i < command.size(); ++i) {
+        char c = command[i];
+        if (quote != 0) {
+            if (c == quote) {
+                quote = 0;
+            } else if (c == '\\' && quote == '"' && i + 1 < command.size()) {
+                current += command[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_argument = true;
+        } else if (c == '\\' && i + 1 < command.size()) {
+            current += command[++i];
+            in_argument = true;
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_argument) arguments.push_back(std::move(current));
+            current.clear();
+            in_argument = false;
+        } else {
+            current += c;
+            in_argument = true;
+        }
+    }
+    if (in_argument) arguments.push_back(std::move(current));
+    return arguments;
+}
+
+void AddIncludeDir(const std::filesystem::path& directory, std::vector<std::filesystem::path>& dirs, std::unordered_set<std::string>& seen) {
+    std::filesystem::path normal = directory.lexically_normal();
+    if (seen.insert(normal.string()).second) {
+        dirs.push_back(std::move(normal));
+    }
+}
+
+/**
+ * @brief Tells whether a normalized absolute path is the root or lies below it.
+ */
+bool IsInside(const std::string& path, const std::string& root) {
+    if (path.compare(0, root.size(), root) != 0) {
+        return false;
+    }
+    return path.size() == root.size() || (!root.empty() && (root.back() == '/' || root.back() == '\\')) || path[root.size()] == '/' || path[root.size()] == '\\';
+}
+
+}  // namespace
+
+bool IsCFamilySource(const std::filesystem::path& path) {
+    static const std::unordered_set<std::string> kExtensions = {
+        ".c", ".cc", ".cpp", ".cxx", ".c++", ".cp", ".m", ".mm",
+        ".h", ".hh", ".hpp", ".hxx", ".h++", ".ipp", ".inl", ".tpp", ".tcc", ".cuh", ".cu"};
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return kExtensions.count(extension) != 0;
+}
+
+std::vector<std::filesystem::path> ReadCompileCommandsIncludeDirs(const std::filesystem::path& compile_commands) {
+    std::vector<std::filesystem::path> dirs;
+    std::ifstream file(compile_commands, std::ios::binary);
+    if (!file) {
+        return dirs;
+    }
+    const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // The database is an array of flat objects; only their "directory", "command" and
+    // "arguments" members matter, so a full JSON parser is not needed
+    std::unordered_set<std::string> seen;
+    std::string directory;
+    std::vector<std::string> arguments;
+    auto finish_entry = [&] {
+        std::filesystem::path base = directory.empty() ? compile_commands.parent_path() : std::filesystem::path(directory);
+        // "/I" is only a flag for MSVC-style drivers; elsewhere it could start a path
+        std::string driver = arguments.empty() ? std::string() : std::filesystem::path(arguments[0]).stem().string();
+        bool msvc = driver == "cl" || driver == "clang-cl" || driver == "CL";
+        for (size_t i = 1; i < arguments.size(); ++i) {
+            const std::string& argument = arguments[i];
+            std::string value;
+            for (const char* flag : {"-iquote", "-isystem", "-I", "/I"}) {
+                if (flag[0] == '/' && !msvc) continue;
+                size_t length = std::strlen(flag);
+                if (argument.compare(0, length, flag) != 0) continue;
+                if (argument.size() > length) {
+                    value = argument.substr(length);
+                } else if (i + 1 < arguments.size()) {
+                    value = arguments[++i];
+                }
+                break;
+            }
+            if (!value.empty()) {
+                AddIncludeDir(base / value, dirs, seen);
+            }
+        }
+        directory.clear();
+        arguments.clear();
+    };
+
+    std::string key;
+    std::string value;
+    size_t position = 0;
+    while (position < text.size()) {
+        char c = text[position];
+        if (c == '}') {
+            finish_entry();
+            ++position;
+            continue;
+        }
+        if (c != '"') {
+            ++position;
+            continue;
+        }
+        if (!ReadJsonString(text, position, key)) break;
+        SkipWhitespace(text, position);
+        if (position == text.size() || text[position] != ':') continue;
+        ++position;
+        SkipWhitespace(text, position);
+        if (position == text.size()) break;
+
+        if (text[position] == '"') {
+            if (!ReadJsonString(text, position, value)) break;
+            if (key == "directory") {
+                directory = value;
+            } else if (key == "command") {
+                arguments = SplitCommandLine(value);
+            }
+        } else if (text[position] == '[' && key == "arguments") {
+            arguments.clear();
+            ++position;
+            for (;;) {
+                SkipWhitespace(text, position);
+                if (position == text.size() || text[position] != '"' || !ReadJsonString(text, position, value)) break;
+                arguments.push_back(value);
+                SkipWhitespace(text, position);
+                if (position < text.size() && text[position] == ',') ++position;
+            }
+        }
+    }
+    return dirs;
+}
+
+std::vector<std::filesystem::path> FindIncludeDirs(const std::filesystem::path& root, const std::vector<std::filesystem::path>& extra) {
+    std::vector<std::filesystem::path> dirs;
+    std::unordered_set<std::string> seen;
+    const std::filesystem::path absolute_root = std::filesystem::absolute(root);
+    for (const auto& dir : extra) {
+        AddIncludeDir(std::filesystem::absolute(dir), dirs, seen);
+    }
+
+    std::vector<std::filesystem::path> databases;
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(absolute_root / "compile_commands.json", ec)) {
+        databases.push_back(absolute_root / "compile_commands.json");
+    }
+    std::vector<std::filesystem::path> below;
+    for (std::filesystem::directory_iterator it(absolute_root, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code type_ec;
+        if (it->is_directory(type_ec) && std::filesystem::is_regular_file(it->path() / "compile_commands.json", type_ec)) {
+            below.push_back(it->path() / "compile_commands.json");
+        }
+    }
+    std::sort(below.begin(), below.end());
+    databases.insert(databases.end(), below.begin(), below.end());
+
+    for (const auto& database : databases) {
+        for (const auto& dir : ReadCompileCommandsIncludeDirs(database)) {
+            AddIncludeDir(dir, dirs, seen);
+        }
+    }
+    return dirs;
+}
+
+std::set<std::filesystem::path> IncludeClosure(const std::vector<std::filesystem::path>& sources, const std::filesystem::path& root, const std::vector<std::filesystem::path>& include_dirs, unsigned thread_count) {
+    TRACE_PHASE("includes");
+    const std::string root_string = std::filesystem::absolute(root).lexically_normal().string();
+
+    // Every file of the closure is visited once; lookups are memoized by (directory, name)
+    // for the including file's directory and by name for the include directories
+    std::unordered_set<std::string> visited;
+    std::unordered_map<std::string, std::string> relative_lookups;  // directory '\0' name -> path or ""
+    std::unordered_map<std::string, std::string> dir_lookups;       // name -> path or ""
+
+    std::vector<std::string> frontier;
+    for (const auto& source : sources) {
+        std::string path = source.lexically_normal().string();
+        if (IsInside(path, root_string) && visited.insert(path).second) {
+            frontier.push_back(std::move(path));
+        }
+    }
+
+    auto lookup = [](const std::filesystem::path& candidate) {
+        std::error_code ec;
+        std::filesystem::path normal = candidate.lexically_normal();
+        TRACE_FS_CALL(kStat);
+        return std::filesystem::is_regular_file(normal, ec) ? normal.string() : std::string();
+    };
+
+    while (!frontier.empty()) {
+        // Scan the whole level at once
+        std::vector<std::vector<std::string>> includes(frontier.size());
+        ParallelFor(frontier.size(), [&](size_t i) {
+            thread_local std::string content;
+            if (ReadFileContents(frontier[i], content) && !IsBinaryContent(content)) {
+                ScanQuotedIncludes(content, includes[i]);
+            }
+        }, thread_count);
+
+        // Resolve the lookups this level needs for the first time, also in parallel
+        std::vector<std::string> directories(frontier.size());
+        std::vector<std::string> new_relative;
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            directories[i] = std::filesystem::path(frontier[i]).parent_path().string();
+            for (const auto& name : includes[i]) {
+                std::string key = directories[i] + '\0' + name;
+                if (relative_lookups.emplace(key, std::string()).second) new_relative.push_back(std::move(key));
+            }
+        }
+        std::vector<std::string> relative_results(new_relative.size());
+        ParallelFor(new_relative.size(), [&](size_t i) {
+            size_t split = new_relative[i].find('\0');
+            relative_results[i] = lookup(std::filesystem::path(new_relative[i].substr(0, split)) / new_relative[i].substr(split + 1));
+        }, thread_count);
+
+        std::vector<std::string> new_names;
+        for (size_t i = 0; i < new_relative.size(); ++i) {
+            if (relative_results[i].empty()) {
+                std::string name = new_relative[i].substr(new_relative[i].find('\0') + 1);
+                if (dir_lookups.emplace(name, std::string()).second) new_names.push_back(std::move(name));
+            }
+            relative_lookups[new_relative[i]] = std::move(relative_results[i]);
+        }
+        std::vector<std::string> dir_results(new_names.size());
+        ParallelFor(new_names.size(), [&](size_t i) {
+            for (const auto& dir : include_dirs) {
+                dir_results[i] = lookup(dir / new_names[i]);
+                if (!dir_results[i].empty()) break;
+            }
+        }, thread_count);
+        for (size_t i = 0; i < new_names.size(); ++i) {
+            dir_lookups[new_names[i]] = std::move(dir_results[i]);
+        }
+
+        // The files reached for the first time make up the next level
+        std::vector<std::string> next;
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            for (const auto& name : includes[i]) {
+                const std::string& relative = relative_lookups[directories[i] + '\0' + name];
+                const std::string& resolved = relative.empty() ? dir_lookups[name] : relative;
+                if (!resolved.empty() && IsInside(resolved, root_string) && visited.insert(resolved).second) {
+                    next.push_back(resolved);
+                }
+            }
+        }
+        frontier = std::move(next);
+    }
+
+    std::set<std::filesystem::path> closure;
+    for (const auto& path : visited) {
+        closure.insert(path);
+    }
+    return closure;
+}
+
+size_t AddIncludeClosure(std::set<std::filesystem::path>& selected_paths, const std::filesystem::path& root, const std::vector<std::filesystem::path>& include_dirs, unsigned thread_count) {
+    TRACE_FUNCTION();
+    std::vector<std::filesystem::path> paths(selected_paths.begin(), selected_paths.end());
+    PathTable table = ParallelWalk(paths, thread_count);
+
+    std::vector<std::filesystem::path> sources;
+    for (uint32_t index : SelectedFiles(table, paths)) {
+        std::filesystem::path path = table.Path(index);
+        if (IsCFamilySource(path)) sources.push_back(std::move(path));
+    }
+
+    size_t added = 0;
+    for (const auto& path : IncludeClosure(sources, root, include_dirs, thread_count)) {
+        // Skip files that the selection already covers, directly or through a directory
+        bool covered = false;
+        for (std::filesystem::path ancestor = path; !covered; ancestor = ancestor.parent_path()) {
+            covered = selected_paths.count(ancestor) != 0;
+            if (ancestor == ancestor.parent_path()) break;
+        }
+        if (!covered) {
+            selected_paths.insert(path);
+            ++added;
+        }
+    }
+    return added;
+}
+
+}  // namespace Utils
@@ -0,0 +1,504 @@
+#include "utils/minifier.hpp"
+
+#include <cstring>
+
+namespace Utils {
+
+namespace {
+
+bool IsIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsHorizontalSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/**
+ * @brief Script keywords after which an expression, and so a regular expression, may follow.
+ */
+const char* const kRegexKeywords[] = {"return", "typeof", "instanceof", "in", "of", "new", "delete", "void",
+                                      "throw", "case", "do", "else", "yield", "await"};
+
+bool EndsWith(std::string_view text, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+}  // namespace
+
+SourceLanguage DetectSourceLanguage(std::string_view path) {
+    static const char* const kCLike[] = {".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", ".inl",
+                                         ".java", ".cs"};
+    static const char* const kScript[] = {".js", ".jsx", ".mjs", ".cjs", ".ts", ".tsx", ".mts", ".cts"};
+    static const char* const kPython[] = {".py", ".pyw", ".pyi"};
+    static const char* const kShell[] = {".sh", ".bash", ".zsh", ".ksh"};
+
+    for (const char* suffix : kCLike) {
+        if (EndsWith(path, suffix)) return SourceLanguage::CLike;
+    }
+    for (const char* suffix : kScript) {
+        if (EndsWith(path, suffix)) return SourceLanguage::Script;
+    }
+    for (const char* suffix : kPython) {
+        if (EndsWith(path, suffix)) return SourceLanguage::Python;
+    }
+    for (const char* suffix : kShell) {
+        if (EndsWith(path, suffix)) return SourceLanguage::Shell;
+    }
+    return SourceLanguage::Text;
+}
+
+Minifier::Minifier(SourceLanguage language) : language(language) {
+}
+
+void Minifier::Feed(std::string_view chunk, std::string& out) {
+    size_t before = out.size();
+    for (char c : chunk) {
+        Consume(c, out);
+    }
+    bytes_in += chunk.size();
+    bytes_out += out.size() - before;
+}
+
+void Minifier::Finish(std::string& out) {
+    size_t before = out.size();
+    if (pending_slash) {
+        pending_slash = false;
+        EmitContent('/', out);
+    }
+    // Whitespace still pending at the end of the input is trailing by definition
+    pending_length = 0;
+    bytes_out += out.size() - before;
+}
+
+void Minifier::EmitContent(char c, std::string& out) {
+    if (pending_length > 0) {
+        out.append(pending_whitespace, pending_length);
+        pending_length = 0;
+    }
+    out += c;
+    line_has_content = true;
+}
+
+void Minifier::EmitVerbatim(char c, std::string& out) {
+    out += c;
+    line_has_content = true;
+}
+
+void Minifier::EndLine(std::string& out) {
+    pending_length = 0;
+    if (line_has_content) {
+        out += '\n';
+        previous_line_blank = false;
+    } else if (!line_had_comment && !previous_line_blank) {
+        // Keep a single blank line out of every run; lines that held only comments disappear
+        out += '\n';
+        previous_line_blank = true;
+    }
+    line_has_content = false;
+    line_had_comment = false;
+
+    previous = '\n';
+    identifier_length = 0;
+    in_number = false;
+    escaped = false;
+
+    if (heredoc_pending) {
+        heredoc_pending = false;
+        state = State::HeredocBody;
+        match_length = 0;
+        heredoc_line_matches = true;
+    } else {
+        state = State::Code;
+    }
+}
+
+void Minifier::TrackIdentifier(char c) {
+    if (IsIdentifierChar(c)) {
+        if (identifier_length == 0) {
+            in_number = IsDigit(c);
+        }
+        if (identifier_length < sizeof(identifier)) {
+            identifier[identifier_length] = c;
+        }
+        ++identifier_length;
+    } else {
+        identifier_length = 0;
+        in_number = false;
+    }
+}
+
+bool Minifier::RawStringPrefix() const {
+    // R"( ... )", optionally with an encoding prefix: LR, uR, UR, u8R
+    if (identifier_length == 0 || identifier_length > 3 || previous != 'R') return false;
+    if (identifier_length == 1) return true;
+    if (identifier_length == 2) return identifier[0] == 'L' || identifier[0] == 'u' || identifier[0] == 'U';
+    return identifier[0] == 'u' && identifier[1] == '8';
+}
+
+bool Minifier::RegexMayFollow(char c) const {
+    // A '/' after an operand divides it; after an operator, an opening bracket, a ';' or '}' or an
+    // expression keyword it starts a regular expression
+    if (IsIdentifierChar(c)) {
+        if (identifier_length > sizeof(identifier)) return false;
+        std::string_view word(identifier, identifier_length);
+        for (const char* keyword : kRegexKeywords) {
+            if (word == keyword) return true;
+        }
+        return false;
+    }
+    return c != ')' && c != ']' && c != '$';
+}
+
+void Minifier::Consume(char c, std::string& out) {
+    switch (state) {
+        case State::Code:
+            ConsumeCode(c, out);
+            break;
+
+        case State::LineComment:
+            if (c == '\n') EndLine(out);
+            break;
+
+        case State::BlockComment:
+            if (pending_star && c == '/') {
+                state = State::Code;
+                pending_star = false;
+                // The comment may have separated two tokens; keep them apart
+                if (line_has_content && pending_length < kMaxPendingWhitespace) {
+                    pending_whitespace[pending_length++] = ' ';
+                }
+                previous = ' ';
+                identifier_length = 0;
+            } else {
+                pending_star = c == '*';
+            }
+            break;
+
+        case State::KeepLine:
+            if (c == '\n') {
+                EndLine(out);
+            } else {
+                EmitContent(c, out);
+            }
+            break;
+
+        case State::String:
+            if (c == '\n' && !escaped && language != SourceLanguage::Shell && quote != '`') {
+                // Unterminated literal: these strings cannot span lines, so resynchronise here
+                EndLine(out);
+                break;
+            }
+            EmitVerbatim(c, out);
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\' && !(language == SourceLanguage::Shell && quote == '\'')) {
+                escaped = true;
+            } else if (c == quote) {
+                state = State::Code;
+                previous = c;
+                identifier_length = 0;
+                regex_allowed = false;
+            }
+            break;
+
+        case State::Regex:
+            if (c == '\n') {
+                // Unterminated literal: regular expressions cannot span lines, so resynchronise here
+                EndLine(out);
+                break;
+            }
+            EmitVerbatim(c, out);
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '[') {
+                in_class = true;
+            } else if (c == ']') {
+                in_class = false;
+            } else if (c == '/' && !in_class) {
+                // Flags that follow are identifier characters and leave a division possible
+                state = State::Code;
+                previous = c;
+                identifier_length = 0;
+                regex_allowed = false;
+            }
+            break;
+
+        case State::QuoteRun:
+            if (c == quote) {
+                EmitVerbatim(c, out);
+                if (++quote_run == 3) {
+                    state = State::TripleString;
+                    quote_run = 0;
+                }
+            } else if (quote_run == 2) {
+                // "" was an empty string
+                state = State::Code;
+                previous = quote;
+                ConsumeCode(c, out);
+            } else {
+                state = State::String;
+                Consume(c, out);
+            }
+            break;
+
+        case State::TripleString:
+            EmitVerbatim(c, out);
+            if (escaped) {
+                escaped = false;
+                quote_run = 0;
+            } else if (c == '\\') {
+                escaped = true;
+                quote_run = 0;
+            } else if (c == quote) {
+                if (++quote_run == 3) {
+                    state = State::Code;
+                    previous = c;
+                    quote_run = 0;
+                }
+            } else {
+                quote_run = 0;
+            }
+            break;
+
+        case State::RawDelimiter:
+            EmitVerbatim(c, out);
+            if (c == '(') {
+                state = State::RawString;
+                match_length = 0;
+            } else if (delimiter_length < 16 && c != ')' && c != '\\' && c != ' ' && c != '\n') {
+                delimiter[delimiter_length++] = c;
+            } else {
+                // Not a valid raw string delimiter; treat what follows as code again
+                state = State::Code;
+            }
+            break;
+
+        case State::RawString:
+            EmitVerbatim(c, out);
+            if (match_length > delimiter_length && c == '"') {
+                state = State::Code;
+                previous = c;
+                identifier_length = 0;
+            } else if (match_length > 0 && match_length <= delimiter_length && c == delimiter[match_length - 1]) {
+                ++match_length;
+            } else {
+                match_length = c == ')' ? 1 : 0;
+            }
+            break;
+
+        case State::HeredocMarker:
+            if (delimiter_length == 0 && c == '<' && previous == '<') {
+                // <<< is a here-string, not a here-document
+                state = State::Code;
+                EmitContent(c, out);
+                previous = ' ';
+            } else if (delimiter_length == 0 && c == '-' && !heredoc_strip_tabs) {
+                heredoc_strip_tabs = true;
+                EmitContent(c, out);
+                previous = c;
+            } else if (delimiter_length == 0 && (c == ' ' || c == '\t')) {
+                EmitContent(c, out);
+                previous = c;
+            } else if (c == '\'' || c == '"' || c == '\\') {
+                EmitContent(c, out);
+                previous = c;
+            } else if (IsIdentifierChar(c) && (delimiter_length > 0 || !IsDigit(c)) && delimiter_length < kMaxDelimiter) {
+                delimiter[delimiter_length++] = c;
+                EmitContent(c, out);
+                previous = c;
+            } else {
+                heredoc_pending = delimiter_length > 0;
+                state = State::Code;
+                previous = ' ';
+                ConsumeCode(c, out);
+            }
+            break;
+
+        case State::HeredocBody:
+            EmitVerbatim(c, out);
+            if (c == '\n') {
+                bool terminator = heredoc_line_matches && match_length == delimiter_length;
+                line_has_content = false;
+                line_had_comment = false;
+                previous_line_blank = false;
+                match_length = 0;
+                heredoc_line_matches = true;
+                if (terminator) {
+                    state = State::Code;
+                    previous = '\n';
+                }
+            } else if (heredoc_strip_tabs && match_length == 0 && c == '\t') {
+                // <<- allows the terminator to be indented with tabs
+            } else if (heredoc_line_matches && match_length < delimiter_length && c == delimiter[match_length]) {
+                ++match_length;
+            } else {
+                heredoc_line_matches = false;
+            }
+            break;
+    }
+    at_file_start = false;
+}
+
+void Minifier::ConsumeCode(char c, std::string& out) {
+    if (pending_hash) {
+        pending_hash = false;
+        if (c == '!') {
+            EmitContent('#', out);
+            EmitContent('!', out);
+            state = State::KeepLine;
+            return;
+        }
+        state = State::LineComment;
+        line_had_comment = true;
+        Consume(c, out);
+        return;
+    }
+
+    if (pending_slash) {
+        pending_slash = false;
+        if (c == '/') {
+            state = State::LineComment;
+            line_had_comment = true;
+            return;
+        }
+        if (c == '*') {
+            state = State::BlockComment;
+            line_had_comment = true;
+            pending_star = false;
+            return;
+        }
+        if (language == SourceLanguage::Script && regex_allowed) {
+            EmitContent('/', out);
+            state = State::Regex;
+            escaped = false;
+            in_class = false;
+            Consume(c, out);
+            return;
+        }
+        EmitContent('/', out);
+        previous = '/';
+        identifier_length = 0;
+        in_number = false;
+        regex_allowed = true;
+    }
+
+    if (language == SourceLanguage::Shell && escaped) {
+        // A backslash in shell code quotes the next character
+        escaped = false;
+        if (c != '\n') {
+            EmitContent(c, out);
+            previous = 'a';  // An escaped character never starts a word, so a following '#' is literal
+            return;
+        }
+    }
+
+    if (c == '\n') {
+        EndLine(out);
+        return;
+    }
+
+    if (IsHorizontalSpace(c)) {
+        if (pending_length == kMaxPendingWhitespace) {
+            out.append(pending_whitespace, pending_length);
+            pending_length = 0;
+        }
+        pending_whitespace[pending_length++] = c;
+        previous = c;
+        identifier_length = 0;
+        in_number = false;
+        return;
+    }
+
+    switch (language) {
+        case SourceLanguage::CLike:
+        case SourceLanguage::Script:
+            if (c == '/') {
+                pending_slash = true;
+                return;
+            }
+            if (c == '"' && RawStringPrefix()) {
+                EmitContent(c, out);
+                state = State::RawDelimiter;
+                delimiter_length = 0;
+                return;
+            }
+            if ((c == '\'' && !in_number) || c == '"' || c == '`') {
+                EmitContent(c, out);
+                state = State::String;
+                quote = c;
+                escaped = false;
+                return;
+            }
+            break;
+
+        case SourceLanguage::Python:
+            if (c == '#') {
+                if (at_file_start) {
+                    pending_hash = true;
+                } else {
+                    state = State::LineComment;
+                    line_had_comment = true;
+                }
+                return;
+            }
+            if (c == '"' || c == '\'') {
+                EmitContent(c, out);
+                state = State::QuoteRun;
+                quote = c;
+                quote_run = 1;
+                escaped = false;
+                return;
+            }
+            break;
+
+        case SourceLanguage::Shell:
+            if (c == '#' && (IsHorizontalSpace(previous) || previous == '\n' || previous == ';' || previous == '|' ||
+                             previous == '&' || previous == '(' || previous == ')')) {
+                if (at_file_start) {
+                    pending_hash = true;
+                } else {
+                    state = State::LineComment;
+                    line_had_comment = true;
+                }
+                return;
+            }
+            if (c == '\\') {
+                EmitContent(c, out);
+                escaped = true;
+                return;
+            }
+            if (c == '\'' || c == '"') {
+                EmitContent(c, out);
+                state = State::String;
+                quote = c;
+                escaped = false;
+                return;
+            }
+            if (c == '<' && previous == '<') {
+                EmitContent(c, out);
+                state = State::HeredocMarker;
+                delimiter_length = 0;
+                heredoc_strip_tabs = false;
+                return;
+            }
+            break;
+
+        case SourceLanguage::Text:
+            break;
+    }
+
+    TrackIdentifier(c);
+    EmitContent(c, out);
+    previous = c;
+    if (language == SourceLanguage::Script) regex_allowed = RegexMayFollow(c);
+}
+
+}  // namespace Utils
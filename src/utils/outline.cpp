@@ -0,0 +1,553 @@
+#include "utils/outline.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utils/minifier.hpp"
+#include "utils/parallel_for.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/redactor.hpp"
+#include "utils/text_encoding.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+constexpr size_t kMaxStatement = 512;   // Longer statements are cut; they are almost never signatures
+constexpr size_t kMaxSignature = 200;
+constexpr size_t kOutlineBatch = 256;   // Files read and scanned per parallel round
+
+bool IsIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+bool EndsWith(std::string_view text, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+std::string_view Trim(std::string_view text) {
+    while (!text.empty() && IsSpace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && IsSpace(text.back())) text.remove_suffix(1);
+    return text;
+}
+
+std::string_view FirstWord(std::string_view text) {
+    size_t end = 0;
+    while (end < text.size() && IsIdentifierChar(text[end])) ++end;
+    return text.substr(0, end);
+}
+
+/**
+ * @brief Finds a whole-word occurrence of word in text before limit.
+ */
+size_t FindWord(std::string_view text, std::string_view word, size_t limit = std::string_view::npos) {
+    limit = std::min(limit, text.size());
+    for (size_t at = text.find(word); at != std::string_view::npos && at < limit; at = text.find(word, at + 1)) {
+        bool starts = at == 0 || !IsIdentifierChar(text[at - 1]);
+        bool ends = at + word.size() == text.size() || !IsIdentifierChar(text[at + word.size()]);
+        if (starts && ends) return at;
+    }
+    return std::string_view::npos;
+}
+
+/**
+ * @brief Finds an assignment '=' (not ==, <=, >=, != or =>) in text.
+ */
+size_t FindAssignment(std::string_view text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '=') continue;
+        char before = i > 0 ? text[i - 1] : ' ';
+        char after = i + 1 < text.size() ? text[i + 1] : ' ';
+        if (after == '=' || after == '>' || before == '=' || before == '!' || before == '<' || before == '>') continue;
+        return i;
+    }
+    return std::string_view::npos;
+}
+
+void AddEntry(std::vector<OutlineEntry>& entries, uint32_t line, uint32_t depth, std::string_view signature) {
+    signature = Trim(signature);
+    if (signature.empty()) return;
+    OutlineEntry entry{line, depth, {}};
+    if (signature.size() > kMaxSignature) {
+        entry.signature.assign(signature.substr(0, kMaxSignature));
+        entry.signature += "...";
+    } else {
+        entry.signature.assign(signature);
+    }
+    entries.push_back(std::move(entry));
+}
+
+// ---------------------------------------------------------------------------------------------
+// C, C++, Java, C#, JavaScript and TypeScript
+
+enum class StatementKind {
+    Other,
+    Container,  // Its block holds declarations: namespace, class, struct, enum, extern "C"
+    Function,   // Its block is a body we do not descend into
+};
+
+bool IsControlKeyword(std::string_view word) {
+    static const char* const kKeywords[] = {"if", "else", "for", "while", "do", "switch", "case", "catch", "try",
+                                            "return", "sizeof", "new", "delete", "throw", "using", "typedef",
+                                            "static_assert", "decltype", "alignof", "co_return", "co_await",
+                                            "await", "yield", "goto", "default", "with", "synchronized", "lock"};
+    for (const char* keyword : kKeywords) {
+        if (word == keyword) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Tells whether a statement looks like a function head: a name directly followed by a
+ *        parameter list, and not a control statement or an initialisation.
+ */
+bool LooksLikeFunction(std::string_view statement) {
+    size_t paren = statement.find('(');
+    if (paren == std::string_view::npos || paren == 0) return false;
+    if (IsControlKeyword(FirstWord(statement))) return false;
+
+    size_t assignment = FindAssignment(statement);
+    bool is_operator = FindWord(statement, "operator") != std::string_view::npos;
+    if (assignment != std::string_view::npos && assignment < paren && !is_operator) return false;
+
+    size_t name_end = paren;
+    while (name_end > 0 && statement[name_end - 1] == ' ') --name_end;
+    if (name_end == 0) return false;
+    char last = statement[name_end - 1];
+    if (IsIdentifierChar(last) || last == '>') return true;
+    return is_operator && std::strchr("=<>!+-*/%&|^~[]", last) != nullptr;
+}
+
+StatementKind ClassifyBlock(std::string_view statement) {
+    if (statement.empty()) return StatementKind::Other;
+    if (StartsWith(statement, "extern \"C")) return StatementKind::Container;
+
+    size_t paren = statement.find('(');
+    size_t assignment = FindAssignment(statement);
+    static const char* const kContainers[] = {"namespace", "class", "struct", "union", "enum", "interface", "module"};
+    for (const char* keyword : kContainers) {
+        size_t at = FindWord(statement, keyword, paren);
+        if (at != std::string_view::npos && (assignment == std::string_view::npos || assignment < at)) {
+            return StatementKind::Container;
+        }
+    }
+
+    // JavaScript: function declarations and expressions, arrow functions
+    if (statement.find("=>") != std::string_view::npos || FindWord(statement, "function") != std::string_view::npos) {
+        return StatementKind::Function;
+    }
+    return LooksLikeFunction(statement) ? StatementKind::Function : StatementKind::Other;
+}
+
+bool IsAccessLabel(std::string_view statement) {
+    return statement == "public" || statement == "private" || statement == "protected" ||
+           statement == "public slots" || statement == "private slots" || statement == "protected slots" ||
+           statement == "signals" || statement == "Q_SIGNALS" || statement == "Q_SLOTS";
+}
+
+void OutlineCLike(std::string_view content, std::vector<OutlineEntry>& entries) {
+    enum class State { Code, LineComment, BlockComment, String, Preprocessor };
+    State state = State::Code;
+    char quote = 0;
+    bool escaped = false;
+    bool at_line_start = true;
+
+    std::string statement;
+    statement.reserve(kMaxStatement);
+    uint32_t statement_line = 0;
+    uint32_t line = 1;
+    int paren_depth = 0;
+    int inner_braces = 0;  // Braces inside parentheses, e.g. lambdas passed as arguments
+
+    // One flag per open brace: true if the block holds declarations
+    std::vector<bool> blocks;
+    uint32_t body_depth = 0;      // Open function bodies and initialisers
+    uint32_t container_depth = 0;
+
+    auto reset = [&] {
+        statement.clear();
+        paren_depth = 0;
+        inner_braces = 0;
+    };
+    auto append = [&](char c) {
+        if (IsSpace(c)) {
+            if (!statement.empty() && statement.back() != ' ' && statement.size() < kMaxStatement) statement += ' ';
+            return;
+        }
+        if (statement.empty()) statement_line = line;
+        if (statement.size() < kMaxStatement) statement += c;
+    };
+
+    for (size_t i = 0; i < content.size(); ++i) {
+        char c = content[i];
+        char next = i + 1 < content.size() ? content[i + 1] : '\0';
+
+        switch (state) {
+            case State::LineComment:
+                if (c == '\n') state = State::Code;
+                break;
+            case State::BlockComment:
+                if (c == '*' && next == '/') {
+                    state = State::Code;
+                    ++i;
+                    append(' ');
+                }
+                break;
+            case State::Preprocessor:
+                if (c == '\n' && !escaped) state = State::Code;
+                escaped = c == '\\' || (escaped && c == '\r');
+                break;
+            case State::String:
+                if (c == '\n' && quote != '`' && !escaped) {
+                    state = State::Code;  // Unterminated literal; resynchronise on the next line
+                } else if (body_depth == 0) {
+                    append(c);
+                }
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == quote) {
+                    state = State::Code;
+                }
+                break;
+            case State::Code:
+                if (c == '/' && next == '/') {
+                    state = State::LineComment;
+                    ++i;
+                    break;
+                }
+                if (c == '/' && next == '*') {
+                    state = State::BlockComment;
+                    ++i;
+                    break;
+                }
+                if (c == '#' && at_line_start) {
+                    state = State::Preprocessor;
+                    escaped = false;
+                    break;
+                }
+                if (c == '"' || c == '`' ||
+                    (c == '\'' && !(i > 0 && content[i - 1] >= '0' && content[i - 1] <= '9'))) {
+                    state = State::String;
+                    quote = c;
+                    escaped = false;
+                    if (body_depth == 0) append(c);
+                    break;
+                }
+                if (c == '(') {
+                    ++paren_depth;
+                } else if (c == ')') {
+                    paren_depth = std::max(0, paren_depth - 1);
+                } else if (c == '{' && paren_depth > 0) {
+                    ++inner_braces;
+                } else if (c == '}' && inner_braces > 0) {
+                    --inner_braces;
+                } else if (c == '{') {
+                    bool container = false;
+                    if (body_depth == 0) {
+                        std::string_view head = Trim(statement);
+                        StatementKind kind = ClassifyBlock(head);
+                        container = kind == StatementKind::Container;
+                        if (kind != StatementKind::Other && !StartsWith(head, "extern \"C")) {
+                            AddEntry(entries, statement_line, container_depth, head);
+                        }
+                    }
+                    blocks.push_back(container);
+                    if (container) {
+                        ++container_depth;
+                    } else {
+                        ++body_depth;
+                    }
+                    reset();
+                    break;
+                } else if (c == '}') {
+                    if (!blocks.empty()) {
+                        if (blocks.back()) {
+                            --container_depth;
+                        } else {
+                            --body_depth;
+                        }
+                        blocks.pop_back();
+                    }
+                    reset();
+                    break;
+                } else if (c == ';' && paren_depth == 0 && inner_braces == 0) {
+                    if (body_depth == 0) {
+                        std::string_view head = Trim(statement);
+                        if (LooksLikeFunction(head)) {
+                            AddEntry(entries, statement_line, container_depth, head);
+                        }
+                    }
+                    reset();
+                    break;
+                } else if (c == ':' && next != ':' && body_depth == 0 && IsAccessLabel(Trim(statement))) {
+                    reset();
+                    break;
+                }
+                if (body_depth == 0) append(c);
+                break;
+        }
+
+        if (c == '\n') {
+            ++line;
+            at_line_start = true;
+        } else if (!IsSpace(c)) {
+            at_line_start = false;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Line-oriented languages
+
+/**
+ * @brief Calls visit(line_number, indentation, text) for every line of content.
+ */
+template <typename Visit>
+void ForEachLine(std::string_view content, Visit visit) {
+    uint32_t line = 1;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string_view::npos) end = content.size();
+        std::string_view text = content.substr(start, end - start);
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+
+        uint32_t indentation = 0;
+        while (indentation < text.size() && (text[indentation] == ' ' || text[indentation] == '\t')) ++indentation;
+        visit(line, indentation, text.substr(indentation));
+
+        start = end + 1;
+        ++line;
+    }
+}
+
+size_t CountOccurrences(std::string_view text, std::string_view needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string_view::npos; at = text.find(needle, at + needle.size())) {
+        ++count;
+    }
+    return count;
+}
+
+void OutlinePython(std::string_view content, std::vector<OutlineEntry>& entries) {
+    char open_quote = 0;  // Quote character of an open triple-quoted string
+    ForEachLine(content, [&](uint32_t line, uint32_t indentation, std::string_view text) {
+        if (open_quote != 0) {
+            const char* closing = open_quote == '"' ? "\"\"\"" : "'''";
+            if (CountOccurrences(text, closing) % 2 == 1) open_quote = 0;
+            return;
+        }
+        if (StartsWith(text, "def ") || StartsWith(text, "async def ") || StartsWith(text, "class ")) {
+            std::string_view signature = text;
+            if (!signature.empty() && signature.back() == ':') signature.remove_suffix(1);
+            AddEntry(entries, line, indentation / 4, signature);
+        } else if (text.empty() || text[0] == '#') {
+            return;
+        }
+        if (CountOccurrences(text, "\"\"\"") % 2 == 1) {
+            open_quote = '"';
+        } else if (CountOccurrences(text, "'''") % 2 == 1) {
+            open_quote = '\'';
+        }
+    });
+}
+
+void OutlineShell(std::string_view content, std::vector<OutlineEntry>& entries) {
+    ForEachLine(content, [&](uint32_t line, uint32_t, std::string_view text) {
+        if (StartsWith(text, "function ")) {
+            AddEntry(entries, line, 0, text.substr(0, text.find('{')));
+            return;
+        }
+        std::string_view name = FirstWord(text);
+        std::string_view rest = Trim(text.substr(name.size()));
+        if (!name.empty() && StartsWith(rest, "()")) {
+            AddEntry(entries, line, 0, text.substr(0, text.find('{')));
+        }
+    });
+}
+
+void OutlineMarkdown(std::string_view content, std::vector<OutlineEntry>& entries) {
+    bool in_fence = false;
+    ForEachLine(content, [&](uint32_t line, uint32_t indentation, std::string_view text) {
+        if (StartsWith(text, "```") || StartsWith(text, "~~~")) {
+            in_fence = !in_fence;
+            return;
+        }
+        if (in_fence || indentation >= 4 || text.empty() || text[0] != '#') return;
+        size_t level = text.find_first_not_of('#');
+        if (level == std::string_view::npos || level > 6 || text[level] != ' ') return;
+        AddEntry(entries, line, static_cast<uint32_t>(level - 1), text);
+    });
+}
+
+/**
+ * @brief Fallback for languages without a dedicated scanner (Go, Rust, Ruby, Kotlin, ...):
+ *        any line that starts with a common declaration keyword.
+ */
+void OutlineGeneric(std::string_view content, std::vector<OutlineEntry>& entries) {
+    static const char* const kModifiers[] = {"pub", "pub(crate)", "export", "public", "private", "protected",
+                                             "internal", "static", "async", "unsafe", "abstract", "final",
+                                             "open", "override", "data", "sealed", "default"};
+    static const char* const kKeywords[] = {"func", "fn", "def", "impl", "trait", "struct", "enum", "type",
+                                            "class", "interface", "module", "object", "fun", "mod", "union",
+                                            "function", "sub", "proc", "package"};
+    ForEachLine(content, [&](uint32_t line, uint32_t indentation, std::string_view text) {
+        std::string_view rest = text;
+        for (bool stripped = true; stripped;) {
+            stripped = false;
+            for (const char* modifier : kModifiers) {
+                size_t length = std::strlen(modifier);
+                if (StartsWith(rest, modifier) && rest.size() > length && rest[length] == ' ') {
+                    rest = Trim(rest.substr(length));
+                    stripped = true;
+                }
+            }
+        }
+        std::string_view word = FirstWord(rest);
+        if (word.empty() || word.size() == rest.size() || rest[word.size()] != ' ') return;
+        for (const char* keyword : kKeywords) {
+            if (word == keyword) {
+                std::string_view signature = Trim(text.substr(0, text.find('{')));
+                if (!signature.empty() && signature.back() == ':') signature.remove_suffix(1);
+                AddEntry(entries, line, indentation / 4, signature);
+                return;
+            }
+        }
+    });
+}
+
+/**
+ * @brief One slot of a parallel outline batch; buffers are reused across batches.
+ */
+struct OutlineJob {
+    std::string path;
+    std::string content;
+    std::string normalized;
+    std::string redacted;
+    std::vector<Redaction> redactions;
+    std::vector<OutlineEntry> entries;
+    std::string outline;
+    bool readable = false;
+};
+
+}  // namespace
+
+void ExtractOutline(std::string_view path, std::string_view content, std::vector<OutlineEntry>& entries) {
+    entries.clear();
+    if (IsBinaryContent(content)) {
+        return;
+    }
+    if (EndsWith(path, ".md") || EndsWith(path, ".markdown")) {
+        OutlineMarkdown(content, entries);
+        return;
+    }
+    switch (DetectSourceLanguage(path)) {
+        case SourceLanguage::CLike:
+        case SourceLanguage::Script:
+            OutlineCLike(content, entries);
+            break;
+        case SourceLanguage::Python:
+            OutlinePython(content, entries);
+            break;
+        case SourceLanguage::Shell:
+            OutlineShell(content, entries);
+            break;
+        case SourceLanguage::Text:
+            OutlineGeneric(content, entries);
+            break;
+    }
+}
+
+void FormatOutline(const std::vector<OutlineEntry>& entries, std::string& out) {
+    for (const auto& entry : entries) {
+        out.append(2 * static_cast<size_t>(entry.depth), ' ');
+        out += 'L';
+        out += std::to_string(entry.line);
+        out += ": ";
+        out += entry.signature;
+        out += '\n';
+    }
+}
+
+DumpStats VisitFileOutlines(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options, const FileVisitor& visit) {
+    TRACE_FUNCTION();
+    PathTable table = ParallelWalk(selected_paths, options.threads, options.order);
+    return VisitFileOutlines(table, SelectedFiles(table, selected_paths), options, DumpFileReader(options), visit);
+}
+
+DumpStats VisitFileOutlines(const PathTable& table, const std::vector<uint32_t>& files, const DumpOptions& options, const FileReader& read, const FileVisitor& visit) {
+    TRACE_PHASE("outline");
+    // Work in fixed-size batches so memory stays bounded while output keeps its order; the
+    // job slots and their buffers are reused from one batch to the next
+    DumpStats stats;
+    std::vector<OutlineJob> jobs(std::min(files.size(), kOutlineBatch));
+    for (size_t first = 0; first < files.size(); first += kOutlineBatch) {
+        size_t count = std::min(kOutlineBatch, files.size() - first);
+
+        ParallelFor(count, [&](size_t i) {
+            OutlineJob& job = jobs[i];
+            uint32_t index = files[first + i];
+            job.path.clear();
+            table.AppendPath(index, job.path);
+            job.outline.clear();
+            job.readable = read(table.Path(index), job.content);
+            job.redactions.clear();
+            if (job.readable) {
+                // Declarations can carry initializers, so secrets are removed first
+                std::string_view content = job.content;
+                if (options.normalize) {
+                    content = NormalizeText(content, job.normalized);
+                }
+                if (options.redact) {
+                    content = RedactSecrets(job.path, content, job.redacted, job.redactions);
+                }
+                ExtractOutline(job.path, content, job.entries);
+                FormatOutline(job.entries, job.outline);
+            }
+        }, options.threads);
+
+        for (size_t i = 0; i < count; ++i) {
+            const OutlineJob& job = jobs[i];
+            if (job.readable) {
+                ++stats.files;
+                stats.bytes_read += job.content.size();
+                stats.redactions.insert(stats.redactions.end(), job.redactions.begin(), job.redactions.end());
+            }
+            visit(job.path, job.outline, job.readable);
+        }
+    }
+    return stats;
+}
+
+DumpStats PrintFileOutlines(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options) {
+    return PrintFileOutlines(ParallelWalk(selected_paths, options.threads, options.order), selected_paths, out_stream, options);
+}
+
+DumpStats PrintFileOutlines(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options) {
+    TRACE_FUNCTION();
+    std::string output;
+    return VisitFileOutlines(table, SelectedFiles(table, selected_paths), options, DumpFileReader(options), [&](std::string_view path, std::string_view outline, bool readable) {
+        output.clear();
+        if (readable) {
+            options.templates.file.Emit(path, outline, output);
+        } else {
+            options.templates.error.Emit(path, {}, output);
+        }
+        out_stream.write(output.data(), static_cast<std::streamsize>(output.size()));
+    });
+}
+
+}  // namespace Utils
@@ -0,0 +1,411 @@
+#include "utils/output_template.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define OUTPUT_TEMPLATE_SSE2 1
+#endif
+
+namespace Utils {
+
+namespace {
+
+/**
+ * @brief Returns the length of the fence needed to wrap content in a Markdown code block:
+ *        one backtick longer than the longest run inside the content, and at least three.
+ */
+size_t FenceLength(std::string_view content) {
+    size_t longest = 0;
+    const char* data = content.data();
+    const char* end = data + content.size();
+    while (true) {
+        const char* tick = static_cast<const char*>(std::memchr(data, '`', end - data));
+        if (tick == nullptr) break;
+        const char* run_end = tick;
+        while (run_end < end && *run_end == '`') ++run_end;
+        longest = std::max(longest, static_cast<size_t>(run_end - tick));
+        data = run_end;
+    }
+    return std::max<size_t>(3, longest + 1);
+}
+
+void AppendJsonEscapedByte(unsigned char c, std::string& out) {
+    static const char kHex[] = "0123456789abcdef";
+    switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        default:
+            if (c < 0x20) {
+                out += "\\u00";
+                out += kHex[c >> 4];
+                out += kHex[c & 0xF];
+            } else {
+                out += static_cast<char>(c);
+            }
+    }
+}
+
+bool NeedsJsonEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+}  // namespace
+
+void AppendJsonEscaped(std::string_view text, std::string& out) {
+    out.reserve(out.size() + text.size() + text.size() / 8);
+
+    const char* data = text.data();
+    size_t size = text.size();
+    size_t i = 0;
+    size_t run_start = 0;  // Start of the bytes that are known to need no escaping
+
+#ifdef OUTPUT_TEMPLATE_SSE2
+    // Check 16 bytes at a time; clean blocks are copied later in one append
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    while (i + 16 <= size) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(block, control_max), control_max);
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)), control);
+        int mask = _mm_movemask_epi8(special);
+        if (mask == 0) {
+            i += 16;
+            continue;
+        }
+        while (mask != 0) {
+            size_t position = i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+            out.append(data + run_start, position - run_start);
+            AppendJsonEscapedByte(static_cast<unsigned char>(data[position]), out);
+            run_start = position + 1;
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+#else
+    // Portable fallback: test eight bytes per step with SWAR arithmetic
+    constexpr uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr uint64_t kHighs = 0x8080808080808080ULL;
+    while (i + 8 <= size) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        uint64_t control = (word - kOnes * 0x20) & ~word;
+        uint64_t quotes = word ^ (kOnes * '"');
+        uint64_t backslashes = word ^ (kOnes * '\\');
+        uint64_t has_quote = (quotes - kOnes) & ~quotes;
+        uint64_t has_backslash = (backslashes - kOnes) & ~backslashes;
+        if (((control | has_quote | has_backslash) & kHighs) != 0) {
+            for (size_t j = i; j < i + 8; ++j) {
+                if (NeedsJsonEscape(static_cast<unsigned char>(data[j]))) {
+                    out.append(data + run_start, j - run_start);
+                    AppendJsonEscapedByte(static_cast<unsigned char>(data[j]), out);
+                    run_start = j + 1;
+                }
+            }
+        }
+        i += 8;
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (NeedsJsonEscape(static_cast<unsigned char>(data[i]))) {
+            out.append(data + run_start, i - run_start);
+            AppendJsonEscapedByte(static_cast<unsigned char>(data[i]), out);
+            run_start = i + 1;
+        }
+    }
+    out.append(data + run_start, size - run_start);
+}
+
+void AppendXmlEscaped(std::string_view text, std::string& out) {
+    size_t run_start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char* entity = nullptr;
+        switch (text[i]) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            default:
+                continue;
+        }
+        out.append(text.data() + run_start, i - run_start);
+        out += entity;
+        run_start = i + 1;
+    }
+    out.append(text.data() + run_start, text.size() - run_start);
+}
+
+bool OutputTemplate::Compile(std::string_view spec, TemplateEscape escape, OutputTemplate& result, std::string& error) {
+    OutputTemplate compiled;
+    compiled.escape = escape;
+
+    auto add_literal = [&](std::string_view text) {
+        if (text.empty()) return;
+        // Merge adjacent literals so emitting costs one append per run of text
+        if (!compiled.ops.empty() && compiled.ops.back().code == OpCode::Literal) {
+            compiled.ops.back().length += text.size();
+        } else {
+            compiled.ops.push_back(Op{OpCode::Literal, compiled.literals.size(), text.size()});
+        }
+        compiled.literals.append(text.data(), text.size());
+    };
+
+    size_t i = 0;
+    while (i < spec.size()) {
+        size_t brace = spec.find_first_of("{}", i);
+        if (brace == std::string_view::npos) {
+            add_literal(spec.substr(i));
+            break;
+        }
+        add_literal(spec.substr(i, brace - i));
+
+        if (brace + 1 < spec.size() && spec[brace + 1] == spec[brace]) {
+            add_literal(spec.substr(brace, 1));
+            i = brace + 2;
+            continue;
+        }
+        if (spec[brace] == '}') {
+            error = "unmatched '}' at offset " + std::to_string(brace);
+            return false;
+        }
+
+        size_t close = spec.find('}', brace);
+        if (close == std::string_view::npos) {
+            error = "unterminated placeholder at offset " + std::to_string(brace);
+            return false;
+        }
+
+        std::string_view name = spec.substr(brace + 1, close - brace - 1);
+        if (name == "path") {
+            compiled.ops.push_back(Op{OpCode::Path});
+        } else if (name == "lang") {
+            compiled.ops.push_back(Op{OpCode::Language});
+        } else if (name == "fence") {
+            compiled.ops.push_back(Op{OpCode::Fence});
+            compiled.uses_fence = true;
+        } else if (name == "content") {
+            compiled.ops.push_back(Op{OpCode::Content});
+        } else {
+            error = "unknown placeholder {" + std::string(name) + "}";
+            return false;
+        }
+        i = close + 1;
+    }
+
+    result = std::move(compiled);
+    return true;
+}
+
+void OutputTemplate::Emit(std::string_view path, std::string_view content, std::string& out, size_t* content_offset) const {
+    size_t fence_length = uses_fence ? FenceLength(content) : 0;
+    if (content_offset) {
+        *content_offset = std::string::npos;
+    }
+
+    for (const Op& op : ops) {
+        switch (op.code) {
+            case OpCode::Literal:
+                out.append(literals, op.offset, op.length);
+                break;
+            case OpCode::Path:
+                if (escape == TemplateEscape::Json) {
+                    AppendJsonEscaped(path, out);
+                } else if (escape == TemplateEscape::Xml) {
+                    AppendXmlEscaped(path, out);
+                } else {
+                    out.append(path.data(), path.size());
+                }
+                break;
+            case OpCode::Language:
+                out.append(LanguageTag(path));
+                break;
+            case OpCode::Fence:
+                out.append(fence_length, '`');
+                break;
+            case OpCode::Content:
+                if (escape == TemplateEscape::Json) {
+                    // JSON keeps the content byte-exact
+                    AppendJsonEscaped(content, out);
+                    break;
+                }
+                if (escape == TemplateEscape::Xml) {
+                    AppendXmlEscaped(content, out);
+                } else {
+                    if (content_offset && *content_offset == std::string::npos) {
+                        *content_offset = out.size();
+                    }
+                    out.append(content.data(), content.size());
+                }
+                // Text formats always end the content on a line break, like the line-by-line copy did
+                if (!content.empty() && content.back() != '\n') {
+                    out += '\n';
+                }
+                break;
+        }
+    }
+}
+
+const OutputTemplates& OutputTemplates::ForFormat(OutputFormat format) {
+    struct Spec {
+        const char* file;
+        const char* error;
+        const char* tree;
+        TemplateEscape escape;
+    };
+    static const Spec kSpecs[] = {
+        // Plain
+        {"\nContents of {path}:\n{content}",
+         "\nContents of {path}:\nFailed to open {path}\n",
+         "{content}",
+         TemplateEscape::None},
+        // Markdown
+        {"\n### {path}\n\n{fence}{lang}\n{content}{fence}\n",
+         "\n### {path}\n\nFailed to open {path}\n",
+         "{fence}text\n{content}{fence}\n",
+         TemplateEscape::None},
+        // Xml
+        {"<file path=\"{path}\">\n{content}</file>\n",
+         "<file path=\"{path}\" error=\"Failed to open\"/>\n",
+         "<tree>\n{content}</tree>\n",
+         TemplateEscape::Xml},
+        // Json
+        {"{{\"path\":\"{path}\",\"content\":\"{content}\"}}\n",
+         "{{\"path\":\"{path}\",\"error\":\"Failed to open\"}}\n",
+         "{{\"tree\":\"{content}\"}}\n",
+         TemplateEscape::Json},
+    };
+
+    static const std::vector<OutputTemplates> kCompiled = [] {
+        std::vector<OutputTemplates> compiled;
+        for (const Spec& spec : kSpecs) {
+            OutputTemplates templates;
+            std::string error;
+            OutputTemplate::Compile(spec.file, spec.escape, templates.file, error);
+            OutputTemplate::Compile(spec.error, spec.escape, templates.error, error);
+            OutputTemplate::Compile(spec.tree, spec.escape, templates.tree, error);
+            compiled.push_back(std::move(templates));
+        }
+        return compiled;
+    }();
+
+    return kCompiled[static_cast<size_t>(format)];
+}
+
+bool ParseOutputFormat(std::string_view name, OutputFormat& format) {
+    if (name == "plain" || name == "text") {
+        format = OutputFormat::Plain;
+    } else if (name == "markdown" || name == "md") {
+        format = OutputFormat::Markdown;
+    } else if (name == "xml") {
+        format = OutputFormat::Xml;
+    } else if (name == "json") {
+        format = OutputFormat::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+TemplateEscape EscapeForFormat(OutputFormat format) {
+    switch (format) {
+        case OutputFormat::Xml:
+            return TemplateEscape::Xml;
+        case OutputFormat::Json:
+            return TemplateEscape::Json;
+        default:
+            return TemplateEscape::None;
+    }
+}
+
+std::string_view LanguageTag(std::string_view path) {
+    struct Mapping {
+        const char* suffix;
+        const char* language;
+    };
+    // Checked in order against the end of the path; whole file names come first
+    static const Mapping kMappings[] = {
+        {"CMakeLists.txt", "cmake"},
+        {"Makefile", "makefile"},
+        {"Dockerfile", "dockerfile"},
+        {".cpp", "cpp"},
+        {".cc", "cpp"},
+        {".cxx", "cpp"},
+        {".hpp", "cpp"},
+        {".hh", "cpp"},
+        {".hxx", "cpp"},
+        {".hpp.in", "cpp"},
+        {".c", "c"},
+        {".h", "c"},
+        {".py", "python"},
+        {".js", "javascript"},
+        {".mjs", "javascript"},
+        {".cjs", "javascript"},
+        {".jsx", "jsx"},
+        {".ts", "typescript"},
+        {".tsx", "tsx"},
+        {".sh", "bash"},
+        {".bash", "bash"},
+        {".zsh", "zsh"},
+        {".ps1", "powershell"},
+        {".rs", "rust"},
+        {".go", "go"},
+        {".java", "java"},
+        {".kt", "kotlin"},
+        {".cs", "csharp"},
+        {".rb", "ruby"},
+        {".php", "php"},
+        {".swift", "swift"},
+        {".nix", "nix"},
+        {".cmake", "cmake"},
+        {".json", "json"},
+        {".yaml", "yaml"},
+        {".yml", "yaml"},
+        {".toml", "toml"},
+        {".xml", "xml"},
+        {".html", "html"},
+        {".css", "css"},
+        {".md", "markdown"},
+        {".sql", "sql"},
+    };
+
+    for (const Mapping& mapping : kMappings) {
+        size_t length = std::strlen(mapping.suffix);
+        if (path.size() >= length && path.compare(path.size() - length, length, mapping.suffix) == 0) {
+            return mapping.language;
+        }
+    }
+    return {};
+}
+
+}  // namespace Utils
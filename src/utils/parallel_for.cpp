@@ -0,0 +1,65 @@
+#include "utils/parallel_for.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "utils/trace.hpp"
+
+namespace Utils {
+
+unsigned DefaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ParallelFor(size_t count, const std::function<void(size_t)>& body, unsigned thread_count) {
+    if (thread_count == 0) {
+        thread_count = DefaultThreadCount();
+    }
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, count));
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    TRACE_CAPTURE_PHASE(phase);
+    auto work = [&] {
+        TRACE_ADOPT_PHASE(phase);
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+            body(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (unsigned i = 1; i < thread_count; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+Semaphore::Semaphore(unsigned count) : count(count) {
+}
+
+void Semaphore::Acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this] { return count > 0; });
+    --count;
+}
+
+void Semaphore::Release() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++count;
+    }
+    available.notify_one();
+}
+
+}  // namespace Utils
@@ -0,0 +1,324 @@
+#include "utils/parallel_walker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "utils/trace.hpp"
+
+namespace Utils {
+
+namespace {
+
+#ifdef _WIN32
+constexpr char kSeparator = '\\';
+#else
+constexpr char kSeparator = '/';
+#endif
+
+// Directory listing is I/O bound; past this point extra threads only add contention.
+constexpr unsigned kMaxWalkerThreads = 8;
+
+/**
+ * @brief A directory waiting to be listed: its entry in the table and its full path.
+ */
+struct PendingDirectory {
+    uint32_t index;
+    std::string path;
+};
+
+/**
+ * @brief Per-thread state of the walker. The owner pushes and pops at the back of its deque,
+ *        thieves take from the front so they pick up the shallowest (largest) pending subtrees.
+ */
+struct Worker {
+    std::mutex mutex;
+    std::deque<PendingDirectory> pending;
+
+    // Scratch buffers for the directory currently being listed
+    std::string names;
+    std::vector<std::pair<size_t, uint8_t>> listed;  // end offset of each name in `names`, flags
+};
+
+class Walker {
+   public:
+    Walker(PathTable& table, unsigned thread_count) : table(table), workers(thread_count) {
+    }
+
+    void Seed(uint32_t index, std::string path) {
+        Push(0, PendingDirectory{index, std::move(path)});
+    }
+
+    void Run() {
+        std::vector<std::thread> threads;
+        threads.reserve(workers.size() - 1);
+        TRACE_CAPTURE_PHASE(phase);
+        for (size_t i = 1; i < workers.size(); ++i) {
+            threads.emplace_back([&, i] {
+                TRACE_ADOPT_PHASE(phase);
+                Work(i);
+            });
+        }
+        Work(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+   private:
+    PathTable& table;
+    std::mutex table_mutex;
+    std::vector<Worker> workers;
+    std::atomic<size_t> outstanding{0};  // Directories pushed but not yet fully listed
+    std::atomic<size_t> queued{0};       // Directories sitting in some deque
+
+    // Workers with nothing to list or steal sleep here until a push or the end of the walk
+    std::mutex idle_mutex;
+    std::condition_variable work_available;
+    std::atomic<unsigned> sleeping{0};
+
+    void Push(size_t self, PendingDirectory directory) {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(workers[self].mutex);
+            workers[self].pending.emplace_back(std::move(directory));
+        }
+        // Sequentially consistent with the sleeper's increment of `sleeping` and its check of
+        // `queued`: either it sees this directory or this push sees it asleep and wakes it
+        queued.fetch_add(1);
+        if (sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            work_available.notify_one();
+        }
+    }
+
+    bool PopOwn(size_t self, PendingDirectory& directory) {
+        std::lock_guard<std::mutex> lock(workers[self].mutex);
+        if (workers[self].pending.empty()) return false;
+        directory = std::move(workers[self].pending.back());
+        workers[self].pending.pop_back();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Steal(size_t self, PendingDirectory& directory) {
+        for (size_t offset = 1; offset < workers.size(); ++offset) {
+            Worker& victim = workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.pending.empty()) {
+                directory = std::move(victim.pending.front());
+                victim.pending.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Work(size_t self) {
+        PendingDirectory directory;
+        while (true) {
+            if (PopOwn(self, directory) || Steal(self, directory)) {
+                workers[self].names.clear();
+                workers[self].listed.clear();
+                ListDirectory(self, directory.path);
+                Publish(self, directory);
+                if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    // The walk is over; release every sleeping worker
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    work_available.notify_all();
+                }
+            } else if (outstanding.load(std::memory_order_acquire) == 0) {
+                return;
+            } else {
+                WaitForWork();
+            }
+        }
+    }
+
+    /**
+     * @brief Parks an idle worker until a directory is queued anywhere or the walk is over.
+     */
+    void WaitForWork() {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        sleeping.fetch_add(1);
+        work_available.wait(lock, [this] {
+            return queued.load() > 0 || outstanding.load(std::memory_order_acquire) == 0;
+        });
+        sleeping.fetch_sub(1);
+    }
+
+    /**
+     * @brief Records a listed directory's children in the table under one lock, then queues
+     *        the subdirectories on this worker's deque.
+     */
+    void Publish(size_t self, const PendingDirectory& directory) {
+        Worker& worker = workers[self];
+        std::vector<std::tuple<uint32_t, size_t, size_t>> subdirectories;  // table index, name start, name end
+
+        {
+            std::lock_guard<std::mutex> lock(table_mutex);
+            size_t start = 0;
+            for (const auto& [end, flags] : worker.listed) {
+                std::string_view name(worker.names.data() + start, end - start);
+                uint32_t index = table.AddChild(directory.index, name, flags);
+                if ((flags & PathTable::kDirectory) && !(flags & PathTable::kSymlink)) {
+                    subdirectories.emplace_back(index, start, end);
+                }
+                start = end;
+            }
+        }
+
+        std::string prefix = directory.path;
+        if (prefix.empty() || prefix.back() != kSeparator) prefix += kSeparator;
+        for (const auto& [index, start, end] : subdirectories) {
+            Push(self, PendingDirectory{index, prefix + worker.names.substr(start, end - start)});
+        }
+    }
+
+    void Record(size_t self, const char* name, uint8_t flags) {
+        Worker& worker = workers[self];
+        worker.names += name;
+        worker.listed.emplace_back(worker.names.size(), flags);
+    }
+
+#ifndef _WIN32
+    void ListDirectory(size_t self, const std::string& directory) {
+        TRACE_FS_CALL(kListDirectory);
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr) {
+            return;
+        }
+
+        std::string child = directory;
+        if (child.empty() || child.back() != '/') child += '/';
+        const size_t prefix_length = child.size();
+
+        while (dirent* item = readdir(dir)) {
+            const char* name = item->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            unsigned char type = item->d_type;
+            uint8_t flags = 0;
+
+            if (type == DT_UNKNOWN || type == DT_LNK) {
+                child.resize(prefix_length);
+                child += name;
+            }
+
+            if (type == DT_UNKNOWN) {
+                // Some filesystems do not fill d_type; fall back to lstat for those entries only
+                struct stat info;
+                TRACE_FS_CALL(kStat);
+                if (lstat(child.c_str(), &info) != 0) continue;
+                if (S_ISDIR(info.st_mode)) type = DT_DIR;
+                else if (S_ISREG(info.st_mode)) type = DT_REG;
+                else if (S_ISLNK(info.st_mode)) type = DT_LNK;
+            }
+
+            if (type == DT_DIR) {
+                flags = PathTable::kDirectory;
+            } else if (type == DT_REG) {
+                flags = PathTable::kRegularFile;
+            } else if (type == DT_LNK) {
+                flags = PathTable::kSymlink;
+                struct stat target;
+                TRACE_FS_CALL(kStat);
+                if (stat(child.c_str(), &target) == 0) {
+                    if (S_ISDIR(target.st_mode)) flags |= PathTable::kDirectory;
+                    if (S_ISREG(target.st_mode)) flags |= PathTable::kRegularFile;
+                }
+            }
+
+            Record(self, name, flags);
+        }
+        closedir(dir);
+    }
+#else
+    void ListDirectory(size_t self, const std::string& directory) {
+        TRACE_FS_CALL(kListDirectory);
+        std::error_code ec;
+        std::filesystem::directory_iterator it(std::filesystem::u8path(directory), ec);
+        for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            std::error_code type_ec;
+            uint8_t flags = 0;
+            if (it->is_symlink(type_ec)) flags |= PathTable::kSymlink;
+            if (it->is_directory(type_ec)) flags |= PathTable::kDirectory;
+            if (it->is_regular_file(type_ec)) flags |= PathTable::kRegularFile;
+            Record(self, it->path().filename().u8string().c_str(), flags);
+        }
+    }
+#endif
+};
+
+}  // namespace
+
+PathTable ParallelWalk(const std::vector<std::filesystem::path>& roots, unsigned thread_count, NameOrder order) {
+    TRACE_PHASE("walk");
+    if (thread_count == 0) {
+        thread_count = std::clamp(std::thread::hardware_concurrency(), 1u, kMaxWalkerThreads);
+    }
+
+    // Intern the roots first so nested or repeated selections collapse onto one entry
+    PathTable table;
+    std::vector<std::pair<uint32_t, std::filesystem::path>> directories;
+    for (const auto& root : roots) {
+        std::error_code ec;
+        std::filesystem::path absolute = std::filesystem::absolute(root, ec);
+        if (ec) continue;
+
+        TRACE_FS_CALL(kStat);
+        auto status = std::filesystem::status(absolute, ec);
+        std::error_code link_ec;
+        TRACE_FS_CALL(kStat);
+        bool symlink = std::filesystem::is_symlink(std::filesystem::symlink_status(absolute, link_ec));
+        // A dangling or looping symlink cannot be followed, but still has its place in the tree
+        if (ec && !symlink) continue;
+
+        uint8_t flags = PathTable::kSelected;
+        if (!ec && std::filesystem::is_directory(status)) flags |= PathTable::kDirectory;
+        if (!ec && std::filesystem::is_regular_file(status)) flags |= PathTable::kRegularFile;
+        if (symlink) flags |= PathTable::kSymlink;
+
+        uint32_t index = table.Intern(absolute, flags);
+        if (flags & PathTable::kDirectory) {
+            directories.emplace_back(index, std::move(absolute));
+        }
+    }
+
+    // Only walk directories that are not already covered by a selected ancestor
+    Walker walker(table, thread_count);
+    std::vector<uint32_t> seeded;
+    for (auto& [index, path] : directories) {
+        bool covered = std::find(seeded.begin(), seeded.end(), index) != seeded.end();
+        for (uint32_t parent = table[index].parent; !covered && parent != PathTable::kNone; parent = table[parent].parent) {
+            covered = table.Is(parent, PathTable::kSelected) && table.Is(parent, PathTable::kDirectory);
+        }
+        if (covered) continue;
+
+        seeded.push_back(index);
+#ifdef _WIN32
+        walker.Seed(index, path.u8string());
+#else
+        walker.Seed(index, path.string());
+#endif
+    }
+    walker.Run();
+
+    table.Finalize(order);
+    return table;
+}
+
+}  // namespace Utils
@@ -0,0 +1,276 @@
+#include "utils/path_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Utils {
+
+namespace {
+
+#ifdef _WIN32
+constexpr char kSeparator = '\\';
+#else
+constexpr char kSeparator = '/';
+#endif
+
+bool IsSeparator(char c) {
+    return c == '/' || c == kSeparator;
+}
+
+std::string ComponentString(const std::filesystem::path& component) {
+#ifdef _WIN32
+    return component.u8string();
+#else
+    return component.string();
+#endif
+}
+
+/**
+ * @brief Packs the first eight bytes of a name into a big-endian integer, so most name
+ *        comparisons during sorting are a single integer compare.
+ */
+uint64_t PrefixKey(std::string_view name) {
+    uint64_t key = 0;
+    size_t n = std::min<size_t>(name.size(), 8);
+    for (size_t i = 0; i < 8; ++i) {
+        key <<= 8;
+        if (i < n) key |= static_cast<unsigned char>(name[i]);
+    }
+    return key;
+}
+
+/**
+ * @brief Rewrites a name so that comparing the result byte by byte gives natural order: every run
+ *        of digits becomes '0', the count of its significant digits and those digits, so a longer
+ *        number sorts after a shorter one and equal lengths compare digit by digit.
+ */
+void AppendNaturalKey(std::string_view name, std::string& out) {
+    size_t i = 0;
+    while (i < name.size()) {
+        if (name[i] < '0' || name[i] > '9') {
+            out += name[i++];
+            continue;
+        }
+        size_t start = i;
+        while (i < name.size() && name[i] >= '0' && name[i] <= '9') ++i;
+        size_t first = start;
+        while (first < i && name[first] == '0') ++first;
+        size_t digits = std::min<size_t>(i - first, 255);
+        out += '0';
+        out += static_cast<char>(digits);
+        out.append(name.data() + first, digits);
+    }
+}
+
+}  // namespace
+
+uint32_t PathTable::Append(uint32_t parent, std::string_view name, uint8_t flags) {
+    Entry entry;
+    entry.parent = parent;
+    entry.name_offset = static_cast<uint32_t>(arena.size());
+    entry.name_length = static_cast<uint32_t>(name.size());
+    entry.rank = kNone;
+    entry.flags = flags;
+    arena.append(name.data(), name.size());
+    entries.push_back(entry);
+    return static_cast<uint32_t>(entries.size() - 1);
+}
+
+uint32_t PathTable::Intern(const std::filesystem::path& path, uint8_t flags) {
+    uint32_t parent = kNone;
+    for (auto it = path.begin(); it != path.end();) {
+        std::string name = ComponentString(*it);
+        ++it;
+        if (name.empty()) continue;
+
+        bool last = it == path.end();
+        uint8_t component_flags = kInterned | (last ? flags : kDirectory);
+
+        auto found = interned.find({parent, name});
+        if (found != interned.end()) {
+            entries[found->second].flags |= component_flags;
+            parent = found->second;
+        } else {
+            uint32_t index = Append(parent, name, component_flags);
+            interned.emplace(std::make_pair(parent, std::move(name)), index);
+            parent = index;
+        }
+    }
+    return parent;
+}
+
+uint32_t PathTable::AddChild(uint32_t parent, std::string_view name, uint8_t flags) {
+    if (Is(parent, kInterned)) {
+        auto found = interned.find({parent, std::string(name)});
+        if (found != interned.end()) {
+            entries[found->second].flags |= flags;
+            return found->second;
+        }
+    }
+    return Append(parent, name, flags);
+}
+
+void PathTable::AppendPath(uint32_t index, std::string& out) const {
+    const Entry& entry = entries[index];
+    if (entry.parent != kNone) {
+        AppendPath(entry.parent, out);
+    }
+    std::string_view name = Name(index);
+    if (!out.empty() && !IsSeparator(out.back()) && !(name.size() == 1 && IsSeparator(name[0]))) {
+        out += kSeparator;
+    }
+    out.append(name.data(), name.size());
+}
+
+std::string PathTable::PathString(uint32_t index) const {
+    std::string out;
+    AppendPath(index, out);
+    return out;
+}
+
+std::filesystem::path PathTable::Path(uint32_t index) const {
+#ifdef _WIN32
+    return std::filesystem::u8path(PathString(index));
+#else
+    return std::filesystem::path(PathString(index));
+#endif
+}
+
+void PathTable::Finalize(NameOrder order) {
+    const size_t count = entries.size();
+    const size_t groups = count + 1;  // One group per entry plus one for the top-level entries
+
+    // Bucket every entry under its parent (counting sort into a CSR layout)
+    child_offsets.assign(groups + 1, 0);
+    for (const Entry& entry : entries) {
+        size_t group = entry.parent == kNone ? count : entry.parent;
+        ++child_offsets[group + 1];
+    }
+    for (size_t i = 1; i <= groups; ++i) {
+        child_offsets[i] += child_offsets[i - 1];
+    }
+    child_indices.resize(count);
+    std::vector<uint32_t> cursor(child_offsets.begin(), child_offsets.end() - 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t group = entries[i].parent == kNone ? count : entries[i].parent;
+        child_indices[cursor[group]++] = i;
+    }
+
+    // Sort siblings by name, comparing precomputed prefixes before falling back to the full name
+    std::vector<uint64_t> keys(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        keys[i] = PrefixKey(Name(i));
+    }
+    for (size_t group = 0; group < groups; ++group) {
+        auto first = child_indices.begin() + child_offsets[group];
+        auto last = child_indices.begin() + child_offsets[group + 1];
+        if (last - first < 2) continue;
+        std::sort(first, last, [&](uint32_t a, uint32_t b) {
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            return Name(a) < Name(b);
+        });
+    }
+
+    // Listing order puts directories first. In byte order the name-sorted groups only need a
+    // stable partition; natural order sorts again on keys built once per entry.
+    listing_indices = child_indices;
+    std::string natural;
+    std::vector<uint32_t> natural_offsets;
+    if (order == NameOrder::Natural) {
+        natural_offsets.reserve(count + 1);
+        for (uint32_t i = 0; i < count; ++i) {
+            natural_offsets.push_back(static_cast<uint32_t>(natural.size()));
+            AppendNaturalKey(Name(i), natural);
+        }
+        natural_offsets.push_back(static_cast<uint32_t>(natural.size()));
+        for (uint32_t i = 0; i < count; ++i) {
+            keys[i] = PrefixKey(std::string_view(natural).substr(natural_offsets[i], natural_offsets[i + 1] - natural_offsets[i]));
+        }
+    }
+    auto natural_key = [&](uint32_t index) {
+        return std::string_view(natural).substr(natural_offsets[index], natural_offsets[index + 1] - natural_offsets[index]);
+    };
+    for (size_t group = 0; group < groups; ++group) {
+        auto first = listing_indices.begin() + child_offsets[group];
+        auto last = listing_indices.begin() + child_offsets[group + 1];
+        if (last - first < 2) continue;
+        auto files = std::stable_partition(first, last, [&](uint32_t index) {
+            return Is(index, kDirectory);
+        });
+        if (order != NameOrder::Natural) continue;
+        // Names that read as the same number ("07" and "7") fall back to byte order, so the
+        // order stays total
+        auto natural_less = [&](uint32_t a, uint32_t b) {
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            int compared = natural_key(a).compare(natural_key(b));
+            return compared != 0 ? compared < 0 : Name(a) < Name(b);
+        };
+        std::sort(first, files, natural_less);
+        std::sort(files, last, natural_less);
+    }
+
+    // A pre-order walk over the listings visits every directory before what lies beneath it
+    ordered.clear();
+    ordered.reserve(count);
+    std::vector<uint32_t> stack;
+    Range roots = RootListing();
+    for (auto it = roots.end(); it != roots.begin();) {
+        stack.push_back(*--it);
+    }
+    while (!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+        entries[index].rank = static_cast<uint32_t>(ordered.size());
+        ordered.push_back(index);
+
+        Range children = Listing(index);
+        for (auto it = children.end(); it != children.begin();) {
+            stack.push_back(*--it);
+        }
+    }
+}
+
+PathTable::Range PathTable::Group(const std::vector<uint32_t>& indices, size_t group) const {
+    if (group + 1 >= child_offsets.size()) {
+        return Range{nullptr, nullptr};
+    }
+    const uint32_t* base = indices.data();
+    return Range{base + child_offsets[group], base + child_offsets[group + 1]};
+}
+
+PathTable::Range PathTable::Children(uint32_t index) const {
+    return Group(child_indices, index);
+}
+
+PathTable::Range PathTable::Roots() const {
+    return Group(child_indices, entries.size());
+}
+
+PathTable::Range PathTable::Listing(uint32_t index) const {
+    return Group(listing_indices, index);
+}
+
+PathTable::Range PathTable::RootListing() const {
+    return Group(listing_indices, entries.size());
+}
+
+uint32_t PathTable::Find(const std::filesystem::path& path) const {
+    uint32_t current = kNone;
+    for (const auto& component : path) {
+        std::string name = ComponentString(component);
+        if (name.empty()) continue;
+
+        Range candidates = current == kNone ? Roots() : Children(current);
+        auto it = std::lower_bound(candidates.begin(), candidates.end(), name,
+                                   [this](uint32_t index, const std::string& value) {
+                                       return Name(index) < value;
+                                   });
+        if (it == candidates.end() || Name(*it) != name) {
+            return kNone;
+        }
+        current = *it;
+    }
+    return current;
+}
+
+}  // namespace Utils
@@ -0,0 +1,304 @@
+#include "utils/selection_profile.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+#include "utils/parallel_walker.hpp"
+#include "utils/trace.hpp"
+
+namespace Utils {
+
+namespace {
+
+// File layout, all integers little-endian:
+//   "RTTP" | u32 version | 3 x (u32 count | count x (u32 length | bytes))
+// The sections are paths, include rules and exclude rules, in that order.
+constexpr char kMagic[4] = {'R', 'T', 'T', 'P'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxStringLength = 1u << 20;
+
+void WriteU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+bool ReadU32(std::string_view data, size_t& offset, uint32_t& value) {
+    if (data.size() - offset < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+    }
+    offset += 4;
+    return true;
+}
+
+void WriteStrings(std::string& out, const std::vector<std::string>& strings) {
+    WriteU32(out, static_cast<uint32_t>(strings.size()));
+    for (const auto& value : strings) {
+        WriteU32(out, static_cast<uint32_t>(value.size()));
+        out += value;
+    }
+}
+
+bool ReadStrings(std::string_view data, size_t& offset, std::vector<std::string>& strings) {
+    uint32_t count = 0;
+    if (!ReadU32(data, offset, count)) return false;
+    strings.clear();
+    strings.reserve(std::min<size_t>(count, data.size() / 4));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t length = 0;
+        if (!ReadU32(data, offset, length) || length > kMaxStringLength || data.size() - offset < length) {
+            return false;
+        }
+        strings.emplace_back(data.substr(offset, length));
+        offset += length;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the path relative to root with '/' separators, or an empty string if the
+ *        path is not inside root.
+ */
+std::string RelativeGenericPath(const std::filesystem::path& path, const std::filesystem::path& root) {
+    std::filesystem::path relative = std::filesystem::absolute(path).lexically_relative(std::filesystem::absolute(root));
+    if (relative.empty() || *relative.begin() == "..") {
+        return {};
+    }
+#ifdef _WIN32
+    return relative.generic_u8string();
+#else
+    return relative.generic_string();
+#endif
+}
+
+bool MatchFrom(std::string_view pattern, std::string_view path) {
+    size_t pi = 0;
+    size_t si = 0;
+    while (pi < pattern.size()) {
+        if (pattern.compare(pi, 2, "**") == 0) {
+            size_t rest = pi + 2;
+            if (rest < pattern.size() && pattern[rest] == '/') ++rest;
+            if (rest == pattern.size()) return true;
+            // "**/" may swallow any number of whole components, including none
+            for (size_t k = si; k <= path.size(); ++k) {
+                if ((k == si || path[k - 1] == '/') && MatchFrom(pattern.substr(rest), path.substr(k))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (pattern[pi] == '*') {
+            for (size_t k = si;; ++k) {
+                if (MatchFrom(pattern.substr(pi + 1), path.substr(k))) return true;
+                if (k == path.size() || path[k] == '/') return false;
+            }
+        }
+        if (si == path.size()) return false;
+        if (pattern[pi] == '?') {
+            if (path[si] == '/') return false;
+        } else if (pattern[pi] != path[si]) {
+            return false;
+        }
+        ++pi;
+        ++si;
+    }
+    return si == path.size();
+}
+
+/**
+ * @brief Tells whether a stored path other than the relative path itself brings it in: the
+ *        root, or one of its parent directories.
+ */
+bool CoveredByAncestor(const std::vector<std::string>& paths, std::string_view relative) {
+    for (const auto& path : paths) {
+        if (path == "." || (relative.size() > path.size() && relative.compare(0, path.size(), path) == 0 && relative[path.size()] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MatchesAny(const std::vector<std::string>& patterns, std::string_view path) {
+    for (const auto& pattern : patterns) {
+        if (GlobMatch(pattern, path)) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool GlobMatch(std::string_view pattern, std::string_view path) {
+    if (pattern.find('/') == std::string_view::npos) {
+        size_t slash = path.rfind('/');
+        return MatchFrom(pattern, slash == std::string_view::npos ? path : path.substr(slash + 1));
+    }
+    if (!pattern.empty() && pattern[0] == '/') {
+        pattern.remove_prefix(1);
+    }
+    return MatchFrom(pattern, path);
+}
+
+std::filesystem::path SelectionProfilePath(const std::filesystem::path& root, const std::string& name) {
+    return root / ".repototxt" / "profiles" / (name + ".rtp");
+}
+
+bool SaveSelectionProfile(const std::filesystem::path& root, const std::string& name, const SelectionProfile& profile) {
+    TRACE_FUNCTION();
+    std::string data(kMagic, sizeof(kMagic));
+    WriteU32(data, kVersion);
+    WriteStrings(data, profile.paths);
+    WriteStrings(data, profile.include_rules);
+    WriteStrings(data, profile.exclude_rules);
+
+    std::filesystem::path path = SelectionProfilePath(root, name);
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec) {
+        return false;
+    }
+
+    // Write to a temporary file first so an interrupted save never leaves a truncated profile
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, ec);
+    return !ec;
+}
+
+bool LoadSelectionProfile(const std::filesystem::path& root, const std::string& name, SelectionProfile& profile) {
+    TRACE_FUNCTION();
+    TRACE_FS_CALL(kOpen);
+    std::ifstream file(SelectionProfilePath(root, name), std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    size_t offset = sizeof(kMagic);
+    uint32_t version = 0;
+    if (data.size() < sizeof(kMagic) || data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0 ||
+        !ReadU32(data, offset, version) || version != kVersion) {
+        return false;
+    }
+
+    SelectionProfile loaded;
+    if (!ReadStrings(data, offset, loaded.paths) ||
+        !ReadStrings(data, offset, loaded.include_rules) ||
+        !ReadStrings(data, offset, loaded.exclude_rules)) {
+        return false;
+    }
+    profile = std::move(loaded);
+    return true;
+}
+
+void StoreSelection(const std::set<std::filesystem::path>& selected_paths, const std::filesystem::path& root, SelectionProfile& profile,
+                    const std::set<std::filesystem::path>* applied) {
+    if (applied == nullptr || (profile.include_rules.empty() && profile.exclude_rules.empty())) {
+        profile.paths.clear();
+        for (const auto& path : selected_paths) {
+            std::string relative = RelativeGenericPath(path, root);
+            if (!relative.empty()) {
+                profile.paths.push_back(std::move(relative));
+            }
+        }
+        return;
+    }
+
+    // Writing back the expanded files would freeze the profile: the rules would never pick up
+    // another file. Only the entries the user toggled are recorded.
+    for (const auto& path : *applied) {
+        if (selected_paths.count(path)) continue;
+        std::string relative = RelativeGenericPath(path, root);
+        if (relative.empty()) continue;
+        profile.paths.erase(std::remove(profile.paths.begin(), profile.paths.end(), relative), profile.paths.end());
+        if (CoveredByAncestor(profile.paths, relative)) {
+            // The leading '/' anchors the rule to this one path
+            std::string rule = "/" + relative;
+            if (std::find(profile.exclude_rules.begin(), profile.exclude_rules.end(), rule) == profile.exclude_rules.end()) {
+                profile.exclude_rules.push_back(std::move(rule));
+            }
+        }
+    }
+    for (const auto& path : selected_paths) {
+        if (applied->count(path)) continue;
+        std::string relative = RelativeGenericPath(path, root);
+        if (relative.empty()) continue;
+        // Selecting an entry again lifts the exclusion recorded when it was deselected
+        profile.exclude_rules.erase(std::remove(profile.exclude_rules.begin(), profile.exclude_rules.end(), "/" + relative),
+                                    profile.exclude_rules.end());
+        if (std::find(profile.paths.begin(), profile.paths.end(), relative) == profile.paths.end()) {
+            profile.paths.push_back(std::move(relative));
+        }
+    }
+}
+
+std::set<std::filesystem::path> ApplySelectionProfile(const SelectionProfile& profile, const std::filesystem::path& root, unsigned thread_count) {
+    return ApplySelectionProfile(profile, root, ParallelWalk({std::filesystem::absolute(root)}, thread_count));
+}
+
+std::set<std::filesystem::path> ApplySelectionProfile(const SelectionProfile& profile, const std::filesystem::path& root, const PathTable& table) {
+    TRACE_PHASE("select");
+    std::set<std::filesystem::path> selected;
+    std::filesystem::path absolute_root = std::filesystem::absolute(root);
+
+    uint32_t root_index = table.Find(absolute_root);
+    if (root_index == PathTable::kNone) {
+        return selected;
+    }
+
+    const std::unordered_set<std::string> wanted(profile.paths.begin(), profile.paths.end());
+    const bool has_rules = !profile.include_rules.empty() || !profile.exclude_rules.empty();
+
+    // Per-entry state, inherited from the parent. Ordered() is a pre-order walk, so a parent is
+    // always visited before its children and its relative path is a prefix of theirs.
+    enum : uint8_t { kInside = 1, kChosen = 2, kExcluded = 4 };
+    std::vector<uint8_t> state(table.size(), 0);
+    std::vector<uint32_t> path_end(table.size(), 0);  // Length of the entry's relative path in `relative`
+    std::string relative;
+
+    for (uint32_t index : table.Ordered()) {
+        uint32_t parent = table[index].parent;
+        if (index == root_index) {
+            // The root itself is stored as "."
+            state[index] = kInside | (wanted.count(".") ? kChosen : 0);
+            if ((state[index] & kChosen) && !has_rules) selected.insert(absolute_root);
+            continue;
+        }
+        if (parent == PathTable::kNone || !(state[parent] & kInside)) {
+            continue;
+        }
+
+        relative.resize(path_end[parent]);
+        if (!relative.empty()) relative += '/';
+        relative.append(table.Name(index));
+        path_end[index] = static_cast<uint32_t>(relative.size());
+
+        uint8_t flags = kInside | (state[parent] & (kChosen | kExcluded));
+        if (!(flags & kChosen) && wanted.count(relative)) flags |= kChosen;
+        if (!(flags & kExcluded) && MatchesAny(profile.exclude_rules, relative)) flags |= kExcluded;
+        state[index] = flags;
+
+        if (!(flags & kChosen) || (flags & kExcluded)) continue;
+
+        if (!has_rules) {
+            // Report only the topmost selected entry of every subtree
+            if (!(state[parent] & kChosen)) selected.insert(table.Path(index));
+        } else if (table.Is(index, PathTable::kRegularFile) &&
+                   (profile.include_rules.empty() || MatchesAny(profile.include_rules, relative))) {
+            selected.insert(table.Path(index));
+        }
+    }
+    return selected;
+}
+
+}  // namespace Utils
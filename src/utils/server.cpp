@@ -0,0 +1,765 @@
+#include "utils/server.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+namespace Utils {
+
+int RunServer(const std::filesystem::path&, const std::string&, size_t, NameOrder) {
+    std::cerr << "Server mode needs Unix domain sockets and is not available on this platform\n";
+    return 1;
+}
+
+int RunClient(const std::string&, const std::vector<std::string>&, std::ostream&) {
+    std::cerr << "Server mode needs Unix domain sockets and is not available on this platform\n";
+    return 1;
+}
+
+}  // namespace Utils
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <streambuf>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "utils/outline.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/selection_profile.hpp"
+#include "utils/trace.hpp"
+#include "utils/utils.hpp"
+
+namespace Utils {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr uint32_t kMaxRequestBytes = 1 << 20;
+constexpr size_t kFrameBytes = 64 * 1024;  // Dump data is sent in frames of about this size
+constexpr int kMaxClients = 64;
+
+bool SendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool ReceiveAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+void PutLength(uint32_t length, char* out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+}
+
+uint32_t GetLength(const char* in) {
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) {
+        length |= static_cast<uint32_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return length;
+}
+
+bool SendFrame(int fd, char type, std::string_view payload) {
+    char header[5];
+    PutLength(static_cast<uint32_t>(payload.size()), header);
+    header[4] = type;
+    return SendAll(fd, header, sizeof(header)) && SendAll(fd, payload.data(), payload.size());
+}
+
+/**
+ * @brief Stream buffer that sends everything written to it as 'D' frames. Once the peer is
+ *        gone, writes fail and the stream goes bad, so the dump stops producing output.
+ */
+class FrameStreamBuf : public std::streambuf {
+   public:
+    explicit FrameStreamBuf(int fd) : fd(fd) {
+        buffer.resize(kFrameBytes);
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    bool Failed() const {
+        return failed;
+    }
+
+   protected:
+    int_type overflow(int_type c) override {
+        if (!Send()) return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        // File blocks larger than a frame go out directly instead of through the buffer
+        if (size >= static_cast<std::streamsize>(buffer.size())) {
+            if (!Send()) return 0;
+            for (std::streamsize offset = 0; offset < size; offset += static_cast<std::streamsize>(kFrameBytes)) {
+                size_t chunk = static_cast<size_t>(std::min<std::streamsize>(size - offset, kFrameBytes));
+                if (failed || !SendFrame(fd, 'D', std::string_view(data + offset, chunk))) {
+                    failed = true;
+                    return offset;
+                }
+            }
+            return size;
+        }
+        return std::streambuf::xsputn(data, size);
+    }
+
+    int sync() override {
+        return Send() ? 0 : -1;
+    }
+
+   private:
+    bool Send() {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        setp(buffer.data(), buffer.data() + buffer.size());
+        if (failed) return false;
+        if (size > 0 && !SendFrame(fd, 'D', std::string_view(buffer.data(), size))) {
+            failed = true;
+        }
+        return !failed;
+    }
+
+    int fd;
+    bool failed = false;
+    std::vector<char> buffer;
+};
+
+struct CachedFile {
+    std::string content;
+    uint64_t size;
+    std::filesystem::file_time_type time;
+};
+
+/**
+ * @brief Least-recently-used cache of file contents, bounded by the total content size.
+ *        Entries are shared, so a file stays alive for the readers still using it after it
+ *        is evicted. Thread-safe.
+ */
+class ContentCache {
+   public:
+    explicit ContentCache(size_t capacity) : capacity(capacity) {}
+
+    std::shared_ptr<const CachedFile> Get(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = slots.find(path);
+        if (it == slots.end()) return nullptr;
+        order.splice(order.begin(), order, it->second.position);
+        return it->second.file;
+    }
+
+    /**
+     * @brief Invalidations since the cache was created. A reader takes this before reading a
+     *        file and hands it back to Put(), which drops the content if anything was
+     *        invalidated in between, as the content may predate the change.
+     */
+    uint64_t Epoch() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return epoch;
+    }
+
+    void Put(const std::string& path, std::shared_ptr<const CachedFile> file, uint64_t read_epoch) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (read_epoch != epoch || file->content.size() > capacity / 4) return;
+        EraseLocked(path);
+        order.push_front(path);
+        bytes += file->content.size();
+        slots.emplace(path, Slot{std::move(file), order.begin()});
+        while (bytes > capacity) {
+            EraseLocked(order.back());
+        }
+    }
+
+    void Erase(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++epoch;
+        EraseLocked(path);
+    }
+
+    void ErasePrefix(const std::string& prefix) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++epoch;
+        for (auto it = order.begin(); it != order.end();) {
+            const std::string& path = *it++;
+            if (path.compare(0, prefix.size(), prefix) == 0) EraseLocked(path);
+        }
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++epoch;
+        slots.clear();
+        order.clear();
+        bytes = 0;
+    }
+
+   private:
+    using Order = std::list<std::string>;
+    struct Slot {
+        std::shared_ptr<const CachedFile> file;
+        Order::iterator position;
+    };
+
+    void EraseLocked(const std::string& path) {
+        auto it = slots.find(path);
+        if (it == slots.end()) return;
+        bytes -= it->second.file->content.size();
+        Order::iterator position = it->second.position;
+        slots.erase(it);
+        order.erase(position);  // Last, as path may refer to the list element
+    }
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    size_t bytes = 0;
+    uint64_t epoch = 0;
+    Order order;  // Most recently used first
+    std::unordered_map<std::string, Slot> slots;
+};
+
+/**
+ * @brief Scan index of the served root, with the paths that change notifications do not cover.
+ */
+struct Index {
+    PathTable table;
+    std::unordered_set<std::string> unwatched;  // Symlinked files, whose targets may change unseen
+};
+
+std::atomic<const char*> socket_to_remove{nullptr};
+
+extern "C" void HandleTermination(int) {
+    if (const char* path = socket_to_remove.load()) {
+        unlink(path);
+    }
+    _exit(0);
+}
+
+class Server {
+   public:
+    Server(std::filesystem::path root, size_t cache_bytes, NameOrder order) : root(std::move(root)), order(order), cache(cache_bytes) {}
+
+    int Run(const std::string& socket_path);
+
+   private:
+    std::shared_ptr<const Index> CurrentIndex();
+    void Watch(const PathTable& table);
+    void UnwatchTree(const std::string& directory);
+    void WatchLoop();
+    void ServeClient(int fd);
+    bool ServeRequest(int fd, const std::vector<std::string>& arguments);
+    bool ReadCached(const std::filesystem::path& path, std::string& buffer, const Index& index);
+
+    const std::filesystem::path root;
+    const NameOrder order;  // Listing order of the index, and so of every dump served
+    ContentCache cache;
+
+    std::mutex index_mutex;  // Serializes rebuilds
+    std::shared_ptr<const Index> index;
+    std::atomic<bool> index_dirty{true};
+    std::atomic<bool> watching{false};  // Every directory of the index is watched
+    std::atomic<int> clients{0};
+
+    int notify_fd = -1;
+    std::mutex watch_mutex;
+    std::unordered_map<int, std::string> watch_paths;  // Watch descriptor -> directory
+    std::unordered_set<std::string> watched;
+};
+
+std::shared_ptr<const Index> Server::CurrentIndex() {
+    std::lock_guard<std::mutex> lock(index_mutex);
+    // Without full notification coverage every request rescans; changes during a rescan mark
+    // the index dirty again, so the next request picks them up
+    if (index_dirty.exchange(false) || !index || !watching) {
+        auto fresh = std::make_shared<Index>();
+        fresh->table = ParallelWalk({root}, 0, order);
+        for (uint32_t i = 0; i < fresh->table.size(); ++i) {
+            if (fresh->table.Is(i, PathTable::kRegularFile) && fresh->table.Is(i, PathTable::kSymlink)) {
+                fresh->unwatched.insert(fresh->table.PathString(i));
+            }
+        }
+        Watch(fresh->table);
+        index = std::move(fresh);
+    }
+    return index;
+}
+
+void Server::Watch(const PathTable& table) {
+#ifdef __linux__
+    if (notify_fd < 0) return;
+    constexpr uint32_t kMask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                               IN_DELETE_SELF | IN_MOVE_SELF | IN_ATTRIB | IN_ONLYDIR;
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    bool complete = true;
+    for (uint32_t i = 0; i < table.size(); ++i) {
+        if (!table.Is(i, PathTable::kDirectory) || table.Is(i, PathTable::kSymlink)) continue;
+        std::string path = table.PathString(i);
+        if (watched.count(path)) continue;
+        int wd = inotify_add_watch(notify_fd, path.c_str(), kMask);
+        if (wd < 0) {
+            if (errno != ENOENT) complete = false;  // Usually the watch limit; a vanished directory is harmless
+            continue;
+        }
+        auto previous = watch_paths.find(wd);
+        if (previous != watch_paths.end()) {
+            // A renamed directory keeps its watch descriptor; its old name is no longer watched
+            watched.erase(previous->second);
+        }
+        watch_paths[wd] = path;
+        watched.insert(std::move(path));
+    }
+    if (!complete && watching) {
+        std::cerr << "Could not watch every directory (raise fs.inotify.max_user_watches); rescanning per request\n";
+    }
+    watching = complete;
+#else
+    (void)table;
+#endif
+}
+
+/**
+ * @brief Drops the watches of a directory and everything beneath it. Called with watch_mutex
+ *        held when the directory was moved: its watches follow it, but events on them would
+ *        still be reported under the old names until a rescan watches it where it is now.
+ */
+void Server::UnwatchTree(const std::string& directory) {
+#ifdef __linux__
+    for (auto it = watch_paths.begin(); it != watch_paths.end();) {
+        const std::string& path = it->second;
+        if (path.compare(0, directory.size(), directory) == 0 && (path.size() == directory.size() || path[directory.size()] == '/')) {
+            inotify_rm_watch(notify_fd, it->first);
+            watched.erase(path);
+            it = watch_paths.erase(it);
+        } else {
+            ++it;
+        }
+    }
+#else
+    (void)directory;
+#endif
+}
+
+void Server::WatchLoop() {
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t length = read(notify_fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) break;
+
+        for (char* p = buffer; p < buffer + length;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; nothing cached can be trusted
+                cache.Clear();
+                index_dirty = true;
+                continue;
+            }
+
+            std::string path;
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex);
+                auto it = watch_paths.find(event->wd);
+                if (it == watch_paths.end()) continue;
+                path = it->second;
+                if (event->mask & IN_IGNORED) {
+                    // The directory is gone or was moved; a rescan watches it again where it is now
+                    watched.erase(path);
+                    watch_paths.erase(it);
+                    continue;
+                }
+                if (event->mask & IN_MOVE_SELF) {
+                    UnwatchTree(path);
+                } else if ((event->mask & IN_MOVED_FROM) && (event->mask & IN_ISDIR)) {
+                    UnwatchTree(path + '/' + event->name);
+                }
+            }
+            if (event->len > 0) {
+                path += '/';
+                path += event->name;
+            }
+
+            if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                index_dirty = true;
+                if (event->mask & (IN_ISDIR | IN_DELETE_SELF | IN_MOVE_SELF)) cache.ErasePrefix(path + '/');
+            }
+            cache.Erase(path);
+        }
+    }
+#endif
+}
+
+bool Server::ReadCached(const std::filesystem::path& path, std::string& buffer, const Index& index) {
+    std::string key = path.string();
+    bool validate = !watching || index.unwatched.count(key);
+
+    std::error_code ec;
+    uint64_t size = 0;
+    std::filesystem::file_time_type time;
+    if (validate) {
+        TRACE_FS_CALL(kStat);
+        size = std::filesystem::file_size(path, ec);
+        if (!ec) {
+            TRACE_FS_CALL(kStat);
+            time = std::filesystem::last_write_time(path, ec);
+        }
+        if (ec) return false;
+    }
+
+    if (auto cached = cache.Get(key)) {
+        if (!validate || (cached->size == size && cached->time == time)) {
+            buffer.assign(cached->content);
+            return true;
+        }
+    }
+
+    uint64_t epoch = cache.Epoch();
+    if (!ReadFileContents(path, buffer)) {
+        return false;
+    }
+    if (!validate) {
+        TRACE_FS_CALL(kStat);
+        time = std::filesystem::last_write_time(path, ec);
+        if (ec) return true;
+    }
+    cache.Put(key, std::make_shared<const CachedFile>(CachedFile{buffer, buffer.size(), time}), epoch);
+    return true;
+}
+
+bool Server::ServeRequest(int fd, const std::vector<std::string>& arguments) {
+    TRACE_FUNCTION();
+    auto fail = [fd](const std::string& message) {
+        return SendFrame(fd, 'E', message) && SendFrame(fd, 'Z', {});
+    };
+
+    if (arguments.empty()) {
+        return fail("empty request");
+    }
+    const std::string& action = arguments[0];
+    if (action != "cat-all" && action != "cat-tree" && action != "cat-outline") {
+        return fail("unsupported action " + action);
+    }
+
+    DumpOptions options;
+    OutputFormat format = OutputFormat::Plain;
+    SelectionProfile profile;
+    for (size_t i = 1; i < arguments.size(); ++i) {
+        const std::string& arg = arguments[i];
+        bool has_value = i + 1 < arguments.size();
+        if (arg == "--minify") {
+            options.minify = true;
+        } else if (arg == "--no-redact") {
+            options.redact = false;
+        } else if (arg == "--keep-encoding") {
+            options.normalize = false;
+        } else if (arg == "--format" && has_value) {
+            if (!ParseOutputFormat(arguments[++i], format)) {
+                return fail("unknown output format " + arguments[i]);
+            }
+        } else if (arg == "--include" && has_value) {
+            profile.include_rules.push_back(arguments[++i]);
+        } else if (arg == "--exclude" && has_value) {
+            profile.exclude_rules.push_back(arguments[++i]);
+        } else if (arg == "--path" && has_value) {
+            std::filesystem::path path = std::filesystem::path(arguments[++i]).lexically_normal();
+            if (path.is_absolute()) {
+                path = path.lexically_relative(root);
+            }
+            std::string relative = path.generic_string();
+            while (relative.size() > 1 && relative.back() == '/') relative.pop_back();
+            if (relative.empty()) relative = ".";
+            if (relative == ".." || relative.compare(0, 3, "../") == 0) {
+                return fail(arguments[i] + " is outside the served root " + root.string());
+            }
+            profile.paths.push_back(std::move(relative));
+        } else {
+            return fail("unknown option " + arg);
+        }
+    }
+    options.templates = OutputTemplates::ForFormat(format);
+    if (profile.paths.empty()) {
+        profile.paths.emplace_back(".");
+    }
+
+    std::shared_ptr<const Index> current = CurrentIndex();
+    std::set<std::filesystem::path> selection = ApplySelectionProfile(profile, root, current->table);
+    if (selection.empty()) {
+        return fail("nothing selected");
+    }
+    std::vector<std::filesystem::path> absolute_paths(selection.begin(), selection.end());
+
+    FrameStreamBuf frames(fd);
+    std::ostream out(&frames);
+    PrintDirectoryTree(current->table, absolute_paths, CommonRoot(absolute_paths), out, options);
+
+    DumpStats stats;
+    if (action != "cat-tree") {
+        FileReader read = [this, &current](const std::filesystem::path& path, std::string& buffer) {
+            return ReadCached(path, buffer, *current);
+        };
+        std::string block;
+        FileVisitor visit = [&](std::string_view path, std::string_view body, bool readable) {
+            if (frames.Failed()) return;
+            block.clear();
+            if (readable) {
+                options.templates.file.Emit(path, body, block);
+            } else {
+                options.templates.error.Emit(path, {}, block);
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        };
+        std::vector<uint32_t> files = SelectedFiles(current->table, absolute_paths);
+        stats = action == "cat-outline" ? VisitFileOutlines(current->table, files, options, read, visit)
+                                        : VisitFileContents(current->table, files, options, read, visit);
+    }
+    out.flush();
+    if (frames.Failed()) {
+        return false;
+    }
+
+    std::string summary = std::to_string(stats.files) + " files, " + std::to_string(stats.bytes_read) + " bytes read";
+    if (options.minify) {
+        summary += ", minified " + std::to_string(stats.minified_bytes_in) + " -> " + std::to_string(stats.minified_bytes_out) + " bytes";
+    }
+    if (!stats.redactions.empty()) {
+        summary += ", redacted " + std::to_string(stats.redactions.size()) + " secrets";
+        for (const Redaction& redaction : stats.redactions) {
+            summary += "\n  " + redaction.path + ":" + std::to_string(redaction.line) + ": " + redaction.kind;
+        }
+    }
+    return SendFrame(fd, 'S', summary) && SendFrame(fd, 'Z', {});
+}
+
+void Server::ServeClient(int fd) {
+    std::vector<std::string> arguments;
+    std::string payload;
+    char header[4];
+    while (ReceiveAll(fd, header, sizeof(header))) {
+        uint32_t length = GetLength(header);
+        if (length > kMaxRequestBytes) {
+            SendFrame(fd, 'E', "request too large");
+            break;
+        }
+        payload.resize(length);
+        if (!ReceiveAll(fd, &payload[0], length)) break;
+
+        arguments.clear();
+        for (size_t start = 0; start < payload.size();) {
+            size_t end = payload.find('\n', start);
+            if (end == std::string::npos) end = payload.size();
+            arguments.push_back(payload.substr(start, end - start));
+            start = end + 1;
+        }
+
+        bool ok = false;
+        try {
+            ok = ServeRequest(fd, arguments);
+        } catch (const std::exception& e) {
+            ok = SendFrame(fd, 'E', e.what()) && SendFrame(fd, 'Z', {});
+        }
+        if (!ok) break;
+    }
+    close(fd);
+    --clients;
+}
+
+int Server::Run(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path must be between 1 and " << sizeof(address.sun_path) - 1 << " bytes long\n";
+        return 1;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Cannot create socket: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // A socket left behind by a server that died can be replaced; a live one cannot
+    struct stat info;
+    if (lstat(socket_path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::cerr << socket_path << " exists and is not a socket\n";
+            close(listen_fd);
+            return 1;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) {
+            std::cerr << "A server is already listening on " << socket_path << "\n";
+            close(listen_fd);
+            return 1;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    // The socket hands out file contents, so only the owner may connect
+    mode_t previous_mask = umask(0077);
+    int bound = bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    umask(previous_mask);
+    if (bound != 0 || listen(listen_fd, 16) != 0) {
+        std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+        close(listen_fd);
+        return 1;
+    }
+
+    static std::string registered_path;
+    registered_path = socket_path;
+    socket_to_remove = registered_path.c_str();
+    std::signal(SIGINT, HandleTermination);
+    std::signal(SIGTERM, HandleTermination);
+    std::signal(SIGPIPE, SIG_IGN);
+
+#ifdef __linux__
+    notify_fd = inotify_init1(IN_CLOEXEC);
+    if (notify_fd < 0) {
+        std::cerr << "inotify unavailable (" << std::strerror(errno) << "); rescanning per request\n";
+    } else {
+        watching = true;
+        std::thread(&Server::WatchLoop, this).detach();
+    }
+#endif
+
+    // Warm the index before the first client arrives
+    std::shared_ptr<const Index> warm = CurrentIndex();
+    std::cerr << "Serving " << root.string() << " (" << warm->table.size() << " entries) on " << socket_path << "\n";
+    warm.reset();
+
+    for (;;) {
+        int client = accept(listen_fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "accept failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+        if (clients >= kMaxClients) {
+            SendFrame(client, 'E', "too many clients");
+            close(client);
+            continue;
+        }
+        ++clients;
+        std::thread(&Server::ServeClient, this, client).detach();
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 1;
+}
+
+}  // namespace
+
+int RunServer(const std::filesystem::path& root, const std::string& socket_path, size_t cache_bytes, NameOrder order) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root, ec)) {
+        std::cerr << root.string() << " is not a directory\n";
+        return 1;
+    }
+    // The server lives until the process is terminated
+    static Server* server = nullptr;
+    server = new Server(std::filesystem::absolute(root).lexically_normal(), cache_bytes, order);
+    return server->Run(socket_path);
+}
+
+int RunClient(const std::string& socket_path, const std::vector<std::string>& request, std::ostream& out) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid socket path: " << socket_path << "\n";
+        return 1;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << "\n";
+        if (fd >= 0) close(fd);
+        return 1;
+    }
+
+    std::string payload;
+    for (const auto& argument : request) {
+        payload += argument;
+        payload += '\n';
+    }
+    char header[5];
+    PutLength(static_cast<uint32_t>(payload.size()), header);
+    if (!SendAll(fd, header, 4) || !SendAll(fd, payload.data(), payload.size())) {
+        std::cerr << "Cannot send request: " << std::strerror(errno) << "\n";
+        close(fd);
+        return 1;
+    }
+
+    int status = 1;
+    std::string frame;
+    while (ReceiveAll(fd, header, sizeof(header))) {
+        frame.resize(GetLength(header));
+        if (!frame.empty() && !ReceiveAll(fd, &frame[0], frame.size())) break;
+        if (header[4] == 'D') {
+            out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        } else if (header[4] == 'E') {
+            std::cerr << "Server error: " << frame << "\n";
+        } else if (header[4] == 'S') {
+            std::cerr << frame << "\n";
+            status = 0;
+        } else if (header[4] == 'Z') {
+            break;
+        }
+    }
+    close(fd);
+    out.flush();
+    return status;
+}
+
+}  // namespace Utils
+
+#endif  // _WIN32
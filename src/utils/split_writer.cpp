@@ -0,0 +1,120 @@
+#include "utils/split_writer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace Utils {
+
+namespace {
+
+/**
+ * @brief Returns how many bytes of text to put in the next piece: everything up to the last
+ *        line break within limit, or a cut inside an overlong line that keeps UTF-8 sequences
+ *        intact.
+ */
+size_t CutPoint(std::string_view text, size_t limit) {
+    if (text.size() <= limit) {
+        return text.size();
+    }
+    size_t newline = text.rfind('\n', limit - 1);
+    if (newline != std::string_view::npos) {
+        return newline + 1;
+    }
+    size_t cut = limit;
+    while (cut > 1 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80) {
+        --cut;
+    }
+    return cut;
+}
+
+}  // namespace
+
+SplitWriter::SplitWriter(std::string header, uint64_t max_bytes, const OutputTemplates& templates, PartSink sink)
+    : header(std::move(header)), templates(templates), sink(std::move(sink)) {
+    // A header that does not fit on its own still leaves the whole limit to the files
+    budget = max_bytes > this->header.size() ? max_bytes - this->header.size() : max_bytes;
+    budget = std::max<uint64_t>(budget, 1);
+    part = this->header;
+}
+
+void SplitWriter::AddFile(std::string_view path, std::string_view body, bool readable) {
+    if (stopped) {
+        return;
+    }
+    block.clear();
+    if (readable) {
+        templates.file.Emit(path, body, block);
+    } else {
+        templates.error.Emit(path, {}, block);
+    }
+
+    if (block.size() <= budget || !readable) {
+        AddBlock(block);
+    } else {
+        AddPieces(path, body);
+    }
+}
+
+size_t SplitWriter::Finish(std::string_view trailer) {
+    if (!trailer.empty() && !stopped) {
+        AddBlock(trailer);
+    }
+    // A dump that fits in one part is handed over whole; an empty one still produces a part
+    // holding the header
+    if (parts == 0) {
+        if (!stopped && !sink(part, ++parts)) {
+            stopped = true;
+        }
+    } else {
+        Flush();
+    }
+    return parts;
+}
+
+void SplitWriter::AddBlock(std::string_view text) {
+    size_t used = part.size() - header.size();
+    if (used > 0 && used + text.size() > budget) {
+        Flush();
+    }
+    part.append(text.data(), text.size());
+}
+
+void SplitWriter::AddPieces(std::string_view path, std::string_view body) {
+    // What the template adds around a piece, escaping aside
+    std::string wrapper;
+    templates.file.Emit(path, {}, wrapper);
+    const uint64_t overhead = wrapper.size();
+
+    while (!body.empty() && !stopped) {
+        // Top up the current part when a useful amount of room is left, otherwise start a new one
+        uint64_t available = budget - std::min<uint64_t>(budget, part.size() - header.size());
+        if (available <= overhead + budget / 4) {
+            Flush();
+            available = budget;
+        }
+        size_t limit = static_cast<size_t>(std::max<uint64_t>(available > overhead ? available - overhead : 1, 1));
+
+        size_t take = CutPoint(body, limit);
+        for (;;) {
+            block.clear();
+            templates.file.Emit(path, body.substr(0, take), block);
+            if (block.size() <= available || take <= 1) break;
+            // Escaping made the piece outgrow the room left; retry with less text
+            take = CutPoint(body, std::max<size_t>(take / 2, 1));
+        }
+        part += block;
+        body.remove_prefix(take);
+    }
+}
+
+void SplitWriter::Flush() {
+    if (stopped || part.size() == header.size()) {
+        return;
+    }
+    if (!sink(part, ++parts)) {
+        stopped = true;
+    }
+    part = header;
+}
+
+}  // namespace Utils
@@ -0,0 +1,326 @@
+#include "utils/text_encoding.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXT_ENCODING_SSE2 1
+#endif
+
+namespace Utils {
+
+namespace {
+
+// Bytes looked at when deciding whether text with NULs is UTF-16
+constexpr size_t kUtf16Sample = 4096;
+
+/**
+ * @brief Returns the offset of the first byte at or after position that is not ASCII or is a
+ *        carriage return, or size if there is none. Everything before it can be copied as is.
+ */
+size_t NextSpecial(const unsigned char* data, size_t position, size_t size) {
+#ifdef TEXT_ENCODING_SSE2
+    // A block is clean when no byte has its high bit set and none equals '\r'; four blocks
+    // are tested per step so the loop runs at memory speed on long ASCII runs
+    const __m128i carriage_return = _mm_set1_epi8('\r');
+    while (position + 64 <= size) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(data + position);
+        __m128i a = _mm_loadu_si128(in);
+        __m128i b = _mm_loadu_si128(in + 1);
+        __m128i c = _mm_loadu_si128(in + 2);
+        __m128i d = _mm_loadu_si128(in + 3);
+        __m128i high = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        __m128i returns = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(a, carriage_return), _mm_cmpeq_epi8(b, carriage_return)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(c, carriage_return), _mm_cmpeq_epi8(d, carriage_return)));
+        if (_mm_movemask_epi8(_mm_or_si128(high, returns)) != 0) break;
+        position += 64;
+    }
+    while (position + 16 <= size) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        int mask = _mm_movemask_epi8(block) | _mm_movemask_epi8(_mm_cmpeq_epi8(block, carriage_return));
+        if (mask != 0) {
+            return position + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+        position += 16;
+    }
+#else
+    // Portable fallback: test eight bytes per step with SWAR arithmetic
+    constexpr uint64_t kOnes = 0x0101010101010101ULL;
+    constexpr uint64_t kHighs = 0x8080808080808080ULL;
+    while (position + 8 <= size) {
+        uint64_t word;
+        std::memcpy(&word, data + position, sizeof(word));
+        uint64_t x = word ^ (kOnes * '\r');
+        // High bit set for non-ASCII bytes, and (at least) for the first '\r'
+        if (((word | ((x - kOnes) & ~x)) & kHighs) != 0) break;
+        position += 8;
+    }
+#endif
+    for (; position < size; ++position) {
+        if (data[position] >= 0x80 || data[position] == '\r') return position;
+    }
+    return size;
+}
+
+/**
+ * @brief Returns the length of the UTF-8 sequence starting with a non-ASCII byte, or 0 if it
+ *        is invalid: a stray continuation byte, a truncated sequence, an overlong form, a
+ *        surrogate or a code point past U+10FFFF.
+ */
+size_t Utf8SequenceLength(const unsigned char* p, size_t available) {
+    auto continuation = [&](size_t i) { return i < available && (p[i] & 0xC0) == 0x80; };
+    unsigned char lead = p[0];
+    if (lead < 0xC2) {
+        return 0;
+    }
+    if (lead < 0xE0) {
+        return continuation(1) ? 2 : 0;
+    }
+    if (lead < 0xF0) {
+        if (!continuation(1) || !continuation(2)) return 0;
+        if (lead == 0xE0 && p[1] < 0xA0) return 0;   // Overlong
+        if (lead == 0xED && p[1] >= 0xA0) return 0;  // Surrogate
+        return 3;
+    }
+    if (lead < 0xF5) {
+        if (!continuation(1) || !continuation(2) || !continuation(3)) return 0;
+        if (lead == 0xF0 && p[1] < 0x90) return 0;   // Overlong
+        if (lead == 0xF4 && p[1] >= 0x90) return 0;  // Past U+10FFFF
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * @brief Normalizes UTF-8: drops the BOM, turns CR and CRLF into LF and removes invalid
+ *        sequences. Nothing is copied until the first change. When an invalid byte shows up
+ *        before any valid multi-byte sequence and the text had no BOM, it is most likely
+ *        Latin-1; latin1 is then set and nothing is returned.
+ */
+std::string_view NormalizeUtf8(std::string_view text, size_t bom, std::string& buffer, bool& latin1) {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+    char* out = nullptr;  // Set once the first change is made; the output never outgrows the input
+    size_t copied = 0;    // Start of the bytes that still have to be copied once writing
+    bool seen_sequence = false;
+
+    auto copy_up_to = [&](size_t end) {
+        if (out == nullptr) {
+            buffer.resize(size);
+            out = &buffer[0];
+        }
+        std::memcpy(out, data + copied, end - copied);
+        out += end - copied;
+    };
+    if (bom != 0) {
+        copied = bom;
+        copy_up_to(bom);
+    }
+
+    size_t position = bom;
+    while ((position = NextSpecial(data, position, size)) < size) {
+        if (data[position] == '\r') {
+            copy_up_to(position);
+            *out++ = '\n';
+            position += position + 1 < size && data[position + 1] == '\n' ? 2 : 1;
+            copied = position;
+            continue;
+        }
+        size_t length = Utf8SequenceLength(data + position, size - position);
+        if (length != 0) {
+            seen_sequence = true;
+            position += length;
+            continue;
+        }
+        if (!seen_sequence && bom == 0) {
+            latin1 = true;
+            return {};
+        }
+        copy_up_to(position);
+        copied = ++position;
+    }
+    if (out == nullptr) {
+        return text;
+    }
+    copy_up_to(size);
+    buffer.resize(static_cast<size_t>(out - &buffer[0]));
+    return buffer;
+}
+
+/**
+ * @brief Transcodes Latin-1 to UTF-8: every byte above 0x7F becomes two bytes.
+ */
+std::string_view TranscodeLatin1(std::string_view text, std::string& buffer) {
+    const auto* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+    buffer.resize(2 * size);
+    char* const start = &buffer[0];
+    char* out = start;
+
+    size_t position = 0;
+    while (position < size) {
+        size_t special = NextSpecial(data, position, size);
+        std::memcpy(out, data + position, special - position);
+        out += special - position;
+        // Non-ASCII bytes tend to cluster, so they are converted in a tight loop
+        for (position = special; position < size && data[position] >= 0x80; ++position) {
+            *out++ = static_cast<char>(0xC0 | (data[position] >> 6));
+            *out++ = static_cast<char>(0x80 | (data[position] & 0x3F));
+        }
+        if (position < size && data[position] == '\r') {
+            *out++ = '\n';
+            position += position + 1 < size && data[position + 1] == '\n' ? 2 : 1;
+        }
+    }
+    buffer.resize(static_cast<size_t>(out - start));
+    return buffer;
+}
+
+/**
+ * @brief Transcodes UTF-16 to UTF-8, turning CR and CRLF into LF and dropping unpaired
+ *        surrogates and a trailing odd byte.
+ */
+template <bool kBigEndian>
+std::string_view TranscodeUtf16(std::string_view text, size_t bom, std::string& buffer) {
+    const auto* in = reinterpret_cast<const unsigned char*>(text.data()) + bom;
+    const size_t units = (text.size() - bom) / 2;
+    auto unit_at = [in](size_t i) -> uint32_t {
+        return kBigEndian ? (uint32_t{in[2 * i]} << 8) | in[2 * i + 1] : in[2 * i] | (uint32_t{in[2 * i + 1]} << 8);
+    };
+
+    // A unit never takes more than three bytes (a surrogate pair takes four for two units);
+    // the slack lets the vector path store eight bytes at a time
+    buffer.resize(units * 3 + 16);
+    char* const start = &buffer[0];
+    char* out = start;
+
+    size_t i = 0;
+    while (i < units) {
+        size_t block_end = std::min(units, i + 8);
+#ifdef TEXT_ENCODING_SSE2
+        // Eight ASCII units without a CR are narrowed to bytes with a single pack
+        if (i + 8 <= units) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+            if (kBigEndian) {
+                block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+            }
+            __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(block, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128());
+            if (_mm_movemask_epi8(ascii) == 0xFFFF) {
+                __m128i narrow = _mm_packus_epi16(block, block);
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(narrow, _mm_set1_epi8('\r'))) & 0xFF) == 0) {
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), narrow);
+                    out += 8;
+                    i += 8;
+                    continue;
+                }
+            }
+        }
+#endif
+        // The same eight units (or the tail) one at a time
+        while (i < block_end) {
+            uint32_t unit = unit_at(i++);
+            if (unit < 0x80) {
+                if (unit == '\r') {
+                    *out++ = '\n';
+                    if (i < units && unit_at(i) == '\n') ++i;
+                } else {
+                    *out++ = static_cast<char>(unit);
+                }
+            } else if (unit < 0x800) {
+                *out++ = static_cast<char>(0xC0 | (unit >> 6));
+                *out++ = static_cast<char>(0x80 | (unit & 0x3F));
+            } else if (unit >= 0xD800 && unit < 0xDC00) {
+                // A high surrogate only counts together with the low one after it
+                uint32_t low = i < units ? unit_at(i) : 0;
+                if (low >= 0xDC00 && low < 0xE000) {
+                    ++i;
+                    uint32_t code_point = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+                    *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+                }
+            } else if (unit < 0xDC00 || unit >= 0xE000) {
+                *out++ = static_cast<char>(0xE0 | (unit >> 12));
+                *out++ = static_cast<char>(0x80 | ((unit >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (unit & 0x3F));
+            }
+        }
+    }
+    buffer.resize(static_cast<size_t>(out - start));
+    return buffer;
+}
+
+}  // namespace
+
+TextEncoding DetectTextEncoding(std::string_view text, size_t& bom_length) {
+    bom_length = 0;
+    auto starts_with = [&text](std::string_view bom) { return text.compare(0, bom.size(), bom) == 0; };
+    if (starts_with("\xEF\xBB\xBF")) {
+        bom_length = 3;
+        return TextEncoding::Utf8;
+    }
+    if (starts_with("\xFF\xFE")) {
+        bom_length = 2;
+        return TextEncoding::Utf16LE;
+    }
+    if (starts_with("\xFE\xFF")) {
+        bom_length = 2;
+        return TextEncoding::Utf16BE;
+    }
+    if (std::memchr(text.data(), '\0', text.size()) == nullptr) {
+        return TextEncoding::Utf8;
+    }
+
+    // Without a BOM, UTF-16 shows itself through the zero high bytes of its ASCII characters:
+    // many NULs on one side of each unit and next to none on the other
+    const size_t sample = std::min(text.size(), kUtf16Sample) & ~size_t{1};
+    size_t even = 0;
+    size_t odd = 0;
+    for (size_t i = 0; i < sample; i += 2) {
+        even += text[i] == '\0';
+        odd += text[i + 1] == '\0';
+    }
+    const size_t units = sample / 2;
+    if (odd * 4 >= units && even * 16 <= odd) {
+        return TextEncoding::Utf16LE;
+    }
+    if (even * 4 >= units && odd * 16 <= even) {
+        return TextEncoding::Utf16BE;
+    }
+    return TextEncoding::Binary;
+}
+
+std::string_view NormalizeText(std::string_view text, std::string& buffer, TextEncoding* encoding) {
+    size_t bom = 0;
+    TextEncoding detected = DetectTextEncoding(text, bom);
+    std::string_view result = text;
+    switch (detected) {
+        case TextEncoding::Utf8: {
+            bool latin1 = false;
+            result = NormalizeUtf8(text, bom, buffer, latin1);
+            if (latin1) {
+                detected = TextEncoding::Latin1;
+                result = TranscodeLatin1(text, buffer);
+            }
+            break;
+        }
+        case TextEncoding::Utf16LE:
+            result = TranscodeUtf16<false>(text, bom, buffer);
+            break;
+        case TextEncoding::Utf16BE:
+            result = TranscodeUtf16<true>(text, bom, buffer);
+            break;
+        case TextEncoding::Latin1:
+        case TextEncoding::Binary:
+            break;
+    }
+    if (encoding != nullptr) {
+        *encoding = detected;
+    }
+    return result;
+}
+
+}  // namespace Utils
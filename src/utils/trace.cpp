@@ -0,0 +1,371 @@
+#include "utils/trace.hpp"
+
+#ifdef REPOTOTXT_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace Utils {
+namespace Trace {
+
+namespace {
+
+constexpr size_t kMaxPhases = 64;
+constexpr size_t kFsCallKinds = static_cast<size_t>(FsCall::kCount);
+constexpr const char* kFsCallNames[kFsCallKinds] = {"open", "read", "stat", "list"};
+
+// Read latencies land in power-of-two buckets of nanoseconds: bucket b holds [2^b, 2^(b+1))
+constexpr size_t kLatencyBuckets = 40;
+
+// Every block carries its size in front of it, so frees can be subtracted from the live total
+constexpr size_t kHeader = alignof(std::max_align_t);
+
+std::atomic<uint64_t> total_allocations{0};
+std::atomic<uint64_t> total_allocated_bytes{0};
+std::atomic<int64_t> live_bytes{0};
+std::atomic<int64_t> peak_live_bytes{0};
+
+// Plain per-thread counters, so a span can report what its own thread allocated
+thread_local uint64_t thread_allocations = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+
+std::atomic<uint32_t> next_thread_id{1};
+thread_local uint32_t thread_id = 0;
+thread_local uint32_t current_phase = 0;
+
+uint64_t Nanoseconds(std::chrono::steady_clock::time_point time) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+}
+
+uint64_t Now() {
+    return Nanoseconds(std::chrono::steady_clock::now());
+}
+
+uint32_t ThreadId() {
+    if (thread_id == 0) {
+        thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    }
+    return thread_id;
+}
+
+/**
+ * @brief A finished span, with times in nanoseconds of the steady clock.
+ */
+struct Span {
+    const char* name;
+    uint32_t thread;
+    bool phase;
+    uint64_t start;
+    uint64_t duration;
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+};
+
+void AppendJsonString(std::string& out, const char* text) {
+    out += '"';
+    for (; *text != '\0'; ++text) {
+        if (*text == '"' || *text == '\\') out += '\\';
+        out += *text;
+    }
+    out += '"';
+}
+
+void AppendMicroseconds(std::string& out, uint64_t nanoseconds) {
+    out += std::to_string(nanoseconds / 1000);
+    out += '.';
+    std::string fraction = std::to_string(nanoseconds % 1000);
+    out.append(3 - fraction.size(), '0');
+    out += fraction;
+}
+
+/**
+ * @brief Everything recorded during the run. It is created by the first span and writes the
+ *        trace when it is destroyed at exit.
+ */
+class State {
+   public:
+    ~State() {
+        Write();
+    }
+
+    uint32_t RegisterPhase(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uint32_t i = 0; i < phase_count; ++i) {
+            if (std::strcmp(phase_names[i], name) == 0) return i;
+        }
+        if (phase_count == kMaxPhases) return 0;
+        phase_names[phase_count] = name;
+        return phase_count++;
+    }
+
+    void AddSpan(const Span& span) {
+        std::lock_guard<std::mutex> lock(mutex);
+        spans.push_back(span);
+    }
+
+    void CountFsCall(uint32_t phase, FsCall call) {
+        fs_calls[phase][static_cast<size_t>(call)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AddReadLatency(uint64_t nanoseconds) {
+        size_t bucket = 0;
+        while (bucket + 1 < kLatencyBuckets && (nanoseconds >> (bucket + 1)) != 0) ++bucket;
+        read_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+   private:
+    void Write();
+    void PrintSummary(const char* file, uint64_t reads, const uint64_t (&latency)[kLatencyBuckets]);
+
+    std::mutex mutex;
+    std::vector<Span> spans;
+    const char* phase_names[kMaxPhases] = {"other"};
+    uint32_t phase_count = 1;
+    std::atomic<uint64_t> fs_calls[kMaxPhases][kFsCallKinds] = {};
+    std::atomic<uint64_t> read_latency[kLatencyBuckets] = {};
+};
+
+State& GetState() {
+    static State state;
+    return state;
+}
+
+void State::Write() {
+    const char* file = std::getenv("REPOTOTXT_TRACE_FILE");
+    if (file == nullptr || *file == '\0') {
+        file = "repototxt-trace.json";
+    }
+
+    uint64_t origin = spans.empty() ? 0 : spans.front().start;
+    for (const Span& span : spans) {
+        origin = std::min(origin, span.start);
+    }
+
+    std::string json = "{\"traceEvents\":[";
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const Span& span = spans[i];
+        if (i != 0) json += ',';
+        json += "\n{\"name\":";
+        AppendJsonString(json, span.name);
+        json += span.phase ? ",\"cat\":\"phase\"" : ",\"cat\":\"function\"";
+        json += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(span.thread);
+        json += ",\"ts\":";
+        AppendMicroseconds(json, span.start - origin);
+        json += ",\"dur\":";
+        AppendMicroseconds(json, span.duration);
+        json += ",\"args\":{\"allocations\":" + std::to_string(span.allocations);
+        json += ",\"allocated_bytes\":" + std::to_string(span.allocated_bytes) + "}}";
+    }
+    json += "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{";
+    json += "\"allocations\":" + std::to_string(total_allocations.load());
+    json += ",\"allocated_bytes\":" + std::to_string(total_allocated_bytes.load());
+    json += ",\"peak_live_bytes\":" + std::to_string(peak_live_bytes.load());
+
+    json += ",\"filesystem_calls\":{";
+    for (uint32_t phase = 0; phase < phase_count; ++phase) {
+        if (phase != 0) json += ',';
+        AppendJsonString(json, phase_names[phase]);
+        json += ":{";
+        for (size_t call = 0; call < kFsCallKinds; ++call) {
+            if (call != 0) json += ',';
+            AppendJsonString(json, kFsCallNames[call]);
+            json += ':' + std::to_string(fs_calls[phase][call].load());
+        }
+        json += '}';
+    }
+
+    uint64_t latency[kLatencyBuckets];
+    uint64_t reads = 0;
+    json += "},\"read_latency_ns\":[";
+    bool first = true;
+    for (size_t bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+        latency[bucket] = read_latency[bucket].load();
+        reads += latency[bucket];
+        if (latency[bucket] == 0) continue;
+        if (!first) json += ',';
+        first = false;
+        json += "{\"below\":" + std::to_string(uint64_t{2} << bucket) + ",\"count\":" + std::to_string(latency[bucket]) + '}';
+    }
+    json += "]}}\n";
+
+    std::ofstream out(file, std::ios::binary);
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    if (!out) {
+        std::cerr << "Could not write the trace to " << file << "\n";
+        return;
+    }
+    PrintSummary(file, reads, latency);
+}
+
+void State::PrintSummary(const char* file, uint64_t reads, const uint64_t (&latency)[kLatencyBuckets]) {
+    std::cerr << "Trace written to " << file << "\n"
+              << "  allocations: " << total_allocations.load() << " (" << total_allocated_bytes.load()
+              << " bytes), peak live " << peak_live_bytes.load() << " bytes\n"
+              << "  filesystem calls by phase:\n";
+    for (uint32_t phase = 0; phase < phase_count; ++phase) {
+        uint64_t total = 0;
+        for (size_t call = 0; call < kFsCallKinds; ++call) total += fs_calls[phase][call].load();
+        if (total == 0) continue;
+        std::cerr << "    " << phase_names[phase] << ":";
+        for (size_t call = 0; call < kFsCallKinds; ++call) {
+            std::cerr << " " << kFsCallNames[call] << " " << fs_calls[phase][call].load();
+        }
+        std::cerr << "\n";
+    }
+    if (reads == 0) {
+        return;
+    }
+
+    // Percentiles are reported as the upper bound of the bucket they fall in
+    std::cerr << "  file reads: " << reads;
+    const std::pair<const char*, double> percentiles[] = {{"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"max", 1.0}};
+    for (const auto& [label, fraction] : percentiles) {
+        uint64_t wanted = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(reads) + 0.5));
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        while (bucket + 1 < kLatencyBuckets && (seen += latency[bucket]) < wanted) ++bucket;
+        std::cerr << ", " << label << " < " << (uint64_t{2} << bucket) / 1000.0 << " us";
+    }
+    std::cerr << "\n";
+}
+
+void* CountedAllocate(std::size_t size) noexcept {
+    void* block = std::malloc(size + kHeader);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    *static_cast<std::size_t*>(block) = size;
+
+    ++thread_allocations;
+    thread_allocated_bytes += size;
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    total_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = live_bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + kHeader;
+}
+
+void CountedFree(void* pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    void* block = static_cast<char*>(pointer) - kHeader;
+    live_bytes.fetch_sub(static_cast<int64_t>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+    std::free(block);
+}
+
+}  // namespace
+
+Scope::Scope(const char* name, bool phase)
+    : name(name),
+      previous_phase(current_phase),
+      phase(phase),
+      start(Now()),
+      allocations(thread_allocations),
+      allocated_bytes(thread_allocated_bytes) {
+    if (phase) {
+        current_phase = GetState().RegisterPhase(name);
+    }
+}
+
+Scope::~Scope() {
+    Span span{name, ThreadId(), phase, start, Now() - start, thread_allocations - allocations, thread_allocated_bytes - allocated_bytes};
+    if (phase) {
+        current_phase = previous_phase;
+    }
+    GetState().AddSpan(span);
+}
+
+ReadTimer::~ReadTimer() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    GetState().AddReadLatency(static_cast<uint64_t>(elapsed.count()));
+}
+
+void CountFsCall(FsCall call) {
+    GetState().CountFsCall(current_phase, call);
+}
+
+void RecordSpan(const char* name, std::chrono::steady_clock::time_point start) {
+    uint64_t begin = Nanoseconds(start);
+    GetState().AddSpan(Span{name, ThreadId(), false, begin, Now() - begin, 0, 0});
+}
+
+uint32_t CurrentPhase() {
+    return current_phase;
+}
+
+void AdoptPhase(uint32_t phase) {
+    current_phase = phase;
+}
+
+}  // namespace Trace
+}  // namespace Utils
+
+// The counting allocator hook: every global new and delete goes through the counters above.
+// Over-aligned allocations keep the library's own operators, which never reach these.
+
+void* operator new(std::size_t size) {
+    for (;;) {
+        if (void* pointer = Utils::Trace::CountedAllocate(size)) {
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    Utils::Trace::CountedFree(pointer);
+}
+
+#endif  // REPOTOTXT_TRACE
@@ -0,0 +1,201 @@
+#include "utils/unified_diff.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Utils {
+
+namespace {
+
+// Myers keeps one frontier per edit distance, so memory grows with the square of the number of
+// changed lines. Past this many, a diff would hardly be smaller than the file anyway.
+constexpr int kMaxEditDistance = 2048;
+
+/**
+ * @brief Splits a text into lines, each keeping its '\n'; the last line may lack one.
+ */
+void SplitLines(std::string_view text, std::vector<std::string_view>& lines) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        end = end == std::string_view::npos ? text.size() : end + 1;
+        lines.push_back(text.substr(start, end - start));
+        start = end;
+    }
+}
+
+/**
+ * @brief Finds the shortest edit script turning a into b with Myers' O(ND) algorithm.
+ *
+ * @param a Line ids of the old version.
+ * @param b Line ids of the new version.
+ * @param ops Receives 'E' (equal), 'D' (delete from a) and 'I' (insert from b), in order.
+ * @return false If the edit distance exceeds kMaxEditDistance.
+ */
+bool ShortestEditScript(const uint32_t* a, int n, const uint32_t* b, int m, std::vector<char>& ops) {
+    int max_d = std::min(n + m, kMaxEditDistance);
+    std::vector<int> v(2 * static_cast<size_t>(max_d) + 2, 0);
+    const int offset = max_d + 1;
+    // trace holds the frontier of every round d at trace_start[d], for diagonals -d..d
+    std::vector<int> trace;
+    std::vector<size_t> trace_start;
+
+    int distance = -1;
+    for (int d = 0; d <= max_d && distance < 0; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                distance = d;
+            }
+        }
+        trace_start.push_back(trace.size());
+        trace.insert(trace.end(), v.begin() + offset - d, v.begin() + offset + d + 1);
+    }
+    if (distance < 0) {
+        return false;
+    }
+
+    // Walk back from the end, collecting the script in reverse
+    size_t first = ops.size();
+    int x = n;
+    int y = m;
+    for (int d = distance; d > 0; --d) {
+        const int* previous = trace.data() + trace_start[d - 1] + (d - 1);  // previous[k] for k in -(d-1)..d-1
+        int k = x - y;
+        int previous_k = (k == -d || (k != d && previous[k - 1] < previous[k + 1])) ? k + 1 : k - 1;
+        int previous_x = previous[previous_k];
+        int previous_y = previous_x - previous_k;
+        while (x > previous_x && y > previous_y) {
+            ops.push_back('E');
+            --x;
+            --y;
+        }
+        ops.push_back(x == previous_x ? 'I' : 'D');
+        x = previous_x;
+        y = previous_y;
+    }
+    while (x > 0 && y > 0) {
+        ops.push_back('E');
+        --x;
+        --y;
+    }
+    std::reverse(ops.begin() + static_cast<std::ptrdiff_t>(first), ops.end());
+    return true;
+}
+
+void AppendRange(size_t start, size_t length, std::string& out) {
+    // diff -u numbers an empty range after the line it follows
+    out += std::to_string(length == 0 ? start : start + 1);
+    if (length != 1) {
+        out += ',';
+        out += std::to_string(length);
+    }
+}
+
+void AppendLine(char prefix, std::string_view line, std::string& out) {
+    out += prefix;
+    out.append(line.data(), line.size());
+    if (line.empty() || line.back() != '\n') {
+        out += "\n\\ No newline at end of file\n";
+    }
+}
+
+}  // namespace
+
+bool AppendUnifiedDiff(std::string_view old_text, std::string_view new_text, std::string_view path, size_t context, std::string& out) {
+    std::vector<std::string_view> old_lines;
+    std::vector<std::string_view> new_lines;
+    SplitLines(old_text, old_lines);
+    SplitLines(new_text, new_lines);
+
+    // Lines are compared as small integers: equal text, equal id
+    std::unordered_map<std::string_view, uint32_t> ids;
+    ids.reserve(old_lines.size() + new_lines.size());
+    auto to_ids = [&ids](const std::vector<std::string_view>& lines, std::vector<uint32_t>& result) {
+        result.reserve(lines.size());
+        for (std::string_view line : lines) {
+            result.push_back(ids.emplace(line, static_cast<uint32_t>(ids.size())).first->second);
+        }
+    };
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+    to_ids(old_lines, a);
+    to_ids(new_lines, b);
+
+    // An edit usually touches a small region, so the common head and tail are matched directly
+    size_t head = 0;
+    while (head < a.size() && head < b.size() && a[head] == b[head]) ++head;
+    size_t tail = 0;
+    while (tail < a.size() - head && tail < b.size() - head && a[a.size() - 1 - tail] == b[b.size() - 1 - tail]) ++tail;
+
+    std::vector<char> ops(head, 'E');
+    if (!ShortestEditScript(a.data() + head, static_cast<int>(a.size() - head - tail), b.data() + head,
+                            static_cast<int>(b.size() - head - tail), ops)) {
+        return false;
+    }
+    ops.insert(ops.end(), tail, 'E');
+
+    // Line positions before every op, for the hunk headers
+    std::vector<size_t> old_at(ops.size() + 1, 0);
+    std::vector<size_t> new_at(ops.size() + 1, 0);
+    for (size_t p = 0; p < ops.size(); ++p) {
+        old_at[p + 1] = old_at[p] + (ops[p] != 'I');
+        new_at[p + 1] = new_at[p] + (ops[p] != 'D');
+    }
+
+    size_t mark = out.size();
+    out += "--- ";
+    out.append(path.data(), path.size());
+    out += "\n+++ ";
+    out.append(path.data(), path.size());
+    out += '\n';
+
+    size_t p = 0;
+    while (p < ops.size()) {
+        while (p < ops.size() && ops[p] == 'E') ++p;
+        if (p == ops.size()) break;
+
+        // A hunk runs from context lines before its first change to context lines after its last,
+        // taking in later changes whose gap could not hold two runs of context
+        size_t begin = p >= context ? p - context : 0;
+        size_t last_change = p;
+        for (size_t q = p + 1; q < ops.size(); ++q) {
+            if (ops[q] == 'E') continue;
+            if (q - last_change - 1 > 2 * context) break;
+            last_change = q;
+        }
+        size_t end = std::min(ops.size(), last_change + 1 + context);
+
+        out += "@@ -";
+        AppendRange(old_at[begin], old_at[end] - old_at[begin], out);
+        out += " +";
+        AppendRange(new_at[begin], new_at[end] - new_at[begin], out);
+        out += " @@\n";
+        for (size_t q = begin; q < end; ++q) {
+            if (ops[q] == 'E') {
+                AppendLine(' ', old_lines[old_at[q]], out);
+            } else if (ops[q] == 'D') {
+                AppendLine('-', old_lines[old_at[q]], out);
+            } else {
+                AppendLine('+', new_lines[new_at[q]], out);
+            }
+        }
+        p = end;
+    }
+
+    if (out.size() - mark >= new_text.size()) {
+        out.resize(mark);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace Utils
@@ -1,20 +1,27 @@
 #include "utils/utils.hpp"
 
 #include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <sstream>
-
-#ifdef _WIN32
-#include <windows.h>
-#elif __APPLE__
-#include <cstdio>
-#elif __linux__
-#include <cstdio>
-#endif
+#include <string_view>
+#include <utility>
+
+#include "utils/content_search.hpp"
+#include "utils/dump_manifest.hpp"
+#include "utils/file_metrics.hpp"
+#include "utils/minifier.hpp"
+#include "utils/outline.hpp"
+#include "utils/parallel_walker.hpp"
+#include "utils/redactor.hpp"
+#include "utils/split_writer.hpp"
+#include "utils/text_encoding.hpp"
+#include "utils/trace.hpp"
+#include "utils/unified_diff.hpp"
 
 namespace Utils {
 
@@ -40,12 +47,15 @@ bool IsSubPath(const std::filesystem::path& path1, const std::filesystem::path&
 /**
  * @brief Recursively prints the directory tree structure.
  *
- * @param path Current path to process.
+ * @param table Scan index produced by the parallel walker.
+ * @param index Entry of the current path in the table.
+ * @param name Name to print for the current path.
  * @param prefix String prefix for formatting the tree.
  * @param isLast Boolean indicating if the current item is the last in its directory.
  * @param out_stream The output stream to write the tree to.
+ * @param metrics Per-entry counters to print after each name, or nullptr for names only.
  */
-void PrintDirectoryTreeHelper(const std::filesystem::path& path, const std::string& prefix, bool isLast, std::ostream& out_stream) {
+void PrintDirectoryTreeHelper(const PathTable& table, uint32_t index, std::string_view name, const std::string& prefix, bool isLast, std::ostream& out_stream, const std::vector<FileMetrics>* metrics) {
 #ifdef _WIN32
     // ASCII symbols for Windows
     std::string branch = isLast ? "+-- " : "|-- ";
@@ -56,25 +66,22 @@ void PrintDirectoryTreeHelper(const std::filesystem::path& path, const std::stri
     std::string new_prefix = prefix + (isLast ? "    " : "│   ");
 #endif
 
-    out_stream << prefix << branch << path.filename().string() << "\n";
-
-    if (std::filesystem::is_directory(path)) {
-        std::vector<std::filesystem::directory_entry> entries;
-        for (const auto& entry : std::filesystem::directory_iterator(path)) {
-            entries.emplace_back(entry);
-        }
+    out_stream << prefix << branch << name;
+    if (metrics != nullptr && index != PathTable::kNone) {
+        bool directory = table.Is(index, PathTable::kDirectory);
+        out_stream << " (" << FormatMetrics((*metrics)[index], directory) << ")";
+    }
+    out_stream << "\n";
 
-        // Sort entries alphabetically, directories first
-        std::sort(entries.begin(), entries.end(), [](const std::filesystem::directory_entry& a, const std::filesystem::directory_entry& b) {
-            if (a.is_directory() && !b.is_directory()) return true;
-            if (!a.is_directory() && b.is_directory()) return false;
-            return a.path().filename().string() < b.path().filename().string();
-        });
+    if (index == PathTable::kNone) {
+        return;
+    }
 
-        for (size_t i = 0; i < entries.size(); ++i) {
-            bool last = (i == entries.size() - 1);
-            PrintDirectoryTreeHelper(entries[i].path(), new_prefix, last, out_stream);
-        }
+    // The listing is in the canonical order the contents are printed in as well
+    PathTable::Range children = table.Listing(index);
+    for (const uint32_t* it = children.begin(); it != children.end(); ++it) {
+        bool last = (it + 1 == children.end());
+        PrintDirectoryTreeHelper(table, *it, table.Name(*it), new_prefix, last, out_stream, metrics);
     }
 }
 
@@ -84,30 +91,311 @@ void PrintDirectoryTreeHelper(const std::filesystem::path& path, const std::stri
  * @param selected_paths Vector of selected file and directory paths.
  * @param root The root path from which to start generating the tree.
  * @param out_stream The output stream to write the tree to.
+ * @param options Output options; the tree is wrapped in the format's tree template and, when
+ *                annotate is set, every entry is followed by its size, line and token counts.
+ */
+void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream, const DumpOptions& options) {
+    // List every selected directory up front so the printer never touches the filesystem
+    PrintDirectoryTree(ParallelWalk(selected_paths, options.threads, options.order), selected_paths, root, out_stream, options);
+}
+
+/**
+ * @brief Generates the directory tree of the selected paths from an existing scan index.
+ *
+ * @param table Scan index holding the selected paths and everything beneath them.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param root The root path from which to start generating the tree.
+ * @param out_stream The output stream to write the tree to.
+ * @param options Output options, as for the overload that walks the selection itself.
  */
-void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream) {
+void PrintDirectoryTree(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, const std::filesystem::path& root, std::ostream& out_stream, const DumpOptions& options) {
+    TRACE_PHASE("tree");
+    // Render the tree first so the format's tree template can wrap it as a whole
+    std::ostringstream tree_stream;
+
     // Print the root
-    out_stream << root.string() << " (root)\n";
+    tree_stream << root.string() << " (root)\n";
+
+    // Measure every listed file in one parallel pass and roll the totals up the tree
+    std::vector<FileMetrics> metrics;
+    if (options.annotate) {
+        metrics = ComputeTreeMetrics(table, nullptr, options.threads, options.io_slots);
+    }
 
-    // Iterate through each selected path
+    // Look every selected path up under the spelling the walker recorded, and print them in
+    // listing order, which is the order their contents follow
+    std::vector<std::pair<uint32_t, const std::filesystem::path*>> listed;
     for (const auto& path : selected_paths) {
         // Only process paths that are subpaths of root
         if (IsSubPath(root, path)) {
-            // Calculate the relative path from root
-            std::filesystem::path relative = std::filesystem::relative(path, root);
+            listed.emplace_back(table.Find(std::filesystem::absolute(path)), &path);
+        }
+    }
+    auto rank = [&table](uint32_t index) {
+        return index == PathTable::kNone ? PathTable::kNone : table[index].rank;
+    };
+    std::stable_sort(listed.begin(), listed.end(), [&rank](const auto& a, const auto& b) {
+        return rank(a.first) < rank(b.first);
+    });
 
-            // If the relative path is empty, it's the root itself
-            if (relative.empty()) continue;
+    for (const auto& [index, path] : listed) {
+        // Calculate the relative path from root. Lexically: resolving symlinks would print a
+        // selected link under its target's name, and throws on links that loop
+        std::filesystem::path relative = path->lexically_relative(root);
 
-            // Build the full path
-            std::filesystem::path current = root / relative;
+        // If the relative path is empty, it's the root itself
+        if (relative.empty()) continue;
 
-            // Determine if it's the last item in its directory
-            bool isLast = true;  // For simplicity, assume it's the last
+        // Build the full path
+        std::filesystem::path current = root / relative;
 
-            PrintDirectoryTreeHelper(current, "", isLast, out_stream);
+        // Determine if it's the last item in its directory
+        bool isLast = true;  // For simplicity, assume it's the last
+
+        PrintDirectoryTreeHelper(table, index, current.filename().string(), "", isLast, tree_stream, options.annotate ? &metrics : nullptr);
+    }
+
+    std::string buffer;
+    options.templates.tree.Emit({}, tree_stream.str(), buffer);
+    out_stream << buffer;
+}
+
+/**
+ * @brief Reads a whole file into the given buffer, reusing its capacity.
+ *
+ * @param path The file to read.
+ * @param buffer Receives the file contents.
+ * @return true If the file could be opened.
+ * @return false Otherwise.
+ */
+bool ReadFileContents(const std::filesystem::path& path, std::string& buffer) {
+    TRACE_FILE_READ();
+    TRACE_FS_CALL(kOpen);
+    buffer.clear();
+    // Binary mode: line endings are left to NormalizeText, which handles every platform alike
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    char chunk[64 * 1024];
+    while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+        TRACE_FS_CALL(kRead);
+        buffer.append(chunk, static_cast<size_t>(file.gcount()));
+    }
+    return true;
+}
+
+/**
+ * @brief The reader dumps use: ReadFileContents, holding one of options.io_slots while it reads.
+ *
+ * @param options Output options; must outlive the reader.
+ * @return The reader.
+ */
+FileReader DumpFileReader(const DumpOptions& options) {
+    return [&options](const std::filesystem::path& path, std::string& buffer) {
+        SemaphoreGuard slot(options.io_slots);
+        return ReadFileContents(path, buffer);
+    };
+}
+
+/**
+ * @brief Lists the regular files at or below the selected paths, in output order.
+ *
+ * @param table Scan index holding the selected paths.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @return Table indices of the files.
+ */
+std::vector<uint32_t> SelectedFiles(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths) {
+    TRACE_FUNCTION();
+    std::vector<uint8_t> selected(table.size(), 0);
+    for (const auto& path : selected_paths) {
+        uint32_t index = table.Find(std::filesystem::absolute(path));
+        if (index != PathTable::kNone) selected[index] = 1;
+    }
+
+    // Ordered() visits parents first, so selection can be inherited in the same pass
+    std::vector<uint32_t> files;
+    for (uint32_t index : table.Ordered()) {
+        uint32_t parent = table[index].parent;
+        if (parent != PathTable::kNone && selected[parent]) selected[index] = 1;
+        if (selected[index] && table.Is(index, PathTable::kRegularFile)) files.push_back(index);
+    }
+    return files;
+}
+
+/**
+ * @brief Reads every regular file below the selected paths, in output order, and hands its
+ *        contents to the visitor after the enabled content stages have run.
+ *
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param options Output options; decides which content stages run.
+ * @param visit Called once per file.
+ * @return Counters describing what was read.
+ */
+DumpStats VisitFileContents(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options, const FileVisitor& visit) {
+    TRACE_FUNCTION();
+    // The table holds every path once and orders it like std::filesystem::path, so a file
+    // reachable through several selected directories is only printed once
+    PathTable table = ParallelWalk(selected_paths, options.threads, options.order);
+    return VisitFileContents(table, SelectedFiles(table, selected_paths), options, DumpFileReader(options), visit);
+}
+
+/**
+ * @brief Reads the size and last write time a manifest compares; both are 0 if the file is gone.
+ */
+void FileStamp(const std::filesystem::path& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    TRACE_FS_CALL(kStat);
+    size = std::filesystem::file_size(path, ec);
+    mtime = 0;
+    if (!ec) {
+        TRACE_FS_CALL(kStat);
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+        if (!ec) mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    }
+    if (ec) size = 0;
+}
+
+/**
+ * @brief Runs the content stages over the given files of a scan index and hands each result to
+ *        the visitor, in the order given. With options.since, files whose body the earlier dump
+ *        already holds are left out; those whose size and modification time still match its
+ *        manifest are not even read.
+ *
+ * @param table Scan index holding the files.
+ * @param files Table indices of the files to visit.
+ * @param options Output options; decides which content stages run.
+ * @param read Supplies the contents of a file.
+ * @param visit Called once per file.
+ * @return Counters describing what was read.
+ */
+DumpStats VisitFileContents(const PathTable& table, const std::vector<uint32_t>& files, const DumpOptions& options, const FileReader& read, const FileVisitor& visit) {
+    TRACE_PHASE("contents");
+    // Buffers are reused across files, so steady state does no per-file allocation
+    DumpStats stats;
+    std::string file_path;
+    std::string content;
+    std::string transformed;
+    std::string normalized;
+    std::string redacted;
+    std::string previous_body;
+    std::string diff;
+
+    const DumpManifest* since = options.since.get();
+    DumpManifest* manifest = options.manifest;
+    bool stamp = since || manifest;
+    // Snippets depend on the search, which the settings cannot capture
+    bool trust_stamps = since && since->settings == DumpSettings(options) && !(options.search && options.snippet_context >= 0);
+    std::vector<char> seen(since ? since->entries.size() : 0, 0);
+    std::vector<uint32_t> carried_dumps(since ? since->dumps.size() : 0, ManifestEntry::kNoDump);
+    if (manifest) manifest->settings = DumpSettings(options);
+
+    // An entry of the earlier manifest goes into the new one unchanged, still pointing at its dump
+    auto carry = [&](const ManifestEntry& previous, uint64_t size, int64_t mtime) {
+        if (!manifest) return;
+        ManifestEntry entry = previous;
+        entry.size = size;
+        entry.mtime = mtime;
+        if (entry.dump < carried_dumps.size() && !since->dumps[entry.dump].empty()) {
+            if (carried_dumps[entry.dump] == ManifestEntry::kNoDump) {
+                carried_dumps[entry.dump] = manifest->AddDump(since->dumps[entry.dump]);
+            }
+            entry.dump = carried_dumps[entry.dump];
+        } else {
+            entry.dump = ManifestEntry::kNoDump;
+        }
+        manifest->entries.push_back(std::move(entry));
+    };
+
+    for (uint32_t index : files) {
+        file_path.clear();
+        table.AppendPath(index, file_path);
+
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (stamp) FileStamp(table.Path(index), size, mtime);
+        const ManifestEntry* previous = nullptr;
+        if (since) {
+            size_t found = since->Find(file_path);
+            if (found != SIZE_MAX) {
+                seen[found] = 1;
+                previous = &since->entries[found];
+            }
+        }
+        if (previous && trust_stamps && mtime != 0 && previous->size == size && previous->mtime == mtime) {
+            ++stats.unchanged;
+            carry(*previous, size, mtime);
+            continue;
+        }
+
+        if (read(table.Path(index), content)) {
+            stats.bytes_read += content.size();
+            size_t redactions_before = stats.redactions.size();
+
+            // Encoding comes first, so the other stages only ever see UTF-8 with LF line
+            // endings; secrets go next, so no later stage can pass them on
+            std::string_view body = content;
+            if (options.normalize) {
+                body = NormalizeText(body, normalized);
+            }
+            std::string_view searched = body;
+            if (options.redact) {
+                body = RedactSecrets(file_path, body, redacted, stats.redactions);
+            }
+            if (options.search && options.snippet_context >= 0) {
+                // Snippets keep the original line numbers, so they are never minified. Lines are
+                // picked on the text the search selected the file by and printed redacted, which
+                // keeps every line in place
+                transformed.clear();
+                FormatMatchSnippets(searched, *options.search, static_cast<unsigned>(options.snippet_context), transformed, body);
+                body = transformed;
+            } else if (options.minify) {
+                transformed.clear();
+                Minifier minifier(DetectSourceLanguage(file_path));
+                minifier.Feed(body, transformed);
+                minifier.Finish(transformed);
+                stats.minified_bytes_in += minifier.BytesIn();
+                stats.minified_bytes_out += minifier.BytesOut();
+                body = transformed;
+            }
+
+            if (stamp) {
+                uint64_t hash = HashContent(body);
+                if (previous && previous->hash == hash) {
+                    // Touched but not changed
+                    stats.redactions.resize(redactions_before);
+                    ++stats.unchanged;
+                    carry(*previous, size, mtime);
+                    continue;
+                }
+                if (since) stats.changes.push_back(FileChange{file_path, previous ? 'M' : 'A'});
+                std::string_view written = body;
+                if (previous && options.diff && since->ReadBody(*previous, previous_body)) {
+                    diff.clear();
+                    if (AppendUnifiedDiff(previous_body, body, file_path, 3, diff)) written = diff;
+                }
+                if (manifest) {
+                    // Only a body written whole can serve as the base of a later diff
+                    bool whole = written.data() == body.data();
+                    manifest->entries.push_back(ManifestEntry{file_path, size, mtime, hash, body.size(), whole ? ManifestEntry::kPending : ManifestEntry::kNoDump, 0});
+                }
+                body = written;
+            }
+
+            ++stats.files;
+            visit(file_path, body, true);
+        } else {
+            visit(file_path, {}, false);
         }
     }
+
+    if (since) {
+        for (size_t i = 0; i < seen.size(); ++i) {
+            if (!seen[i]) stats.changes.push_back(FileChange{since->entries[i].path, 'D'});
+        }
+    }
+    return stats;
 }
 
 /**
@@ -116,40 +404,100 @@ void PrintDirectoryTree(const std::vector<std::filesystem::path>& selected_paths
  *
  * @param selected_paths Vector of selected file and directory paths.
  * @param out_stream The output stream to write the file contents to.
+ * @param options Output options; each file is written through the format's file template. When
+ *                options.manifest names the dump being written, every body written verbatim gets
+ *                its position in the stream recorded.
+ * @return Counters describing what was written.
  */
-void PrintFileContents(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream) {
-    // To avoid printing the same file multiple times if it's selected multiple times via different directories
-    std::vector<std::filesystem::path> files_to_print;
+DumpStats PrintFileContents(const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options) {
+    // The table holds every path once, so a file reachable through several selected
+    // directories is only printed once
+    return PrintFileContents(ParallelWalk(selected_paths, options.threads, options.order), selected_paths, out_stream, options);
+}
 
-    for (const auto& path : selected_paths) {
-        if (std::filesystem::is_regular_file(path)) {
-            files_to_print.emplace_back(std::filesystem::absolute(path));
-        } else if (std::filesystem::is_directory(path)) {
-            // Recursively iterate through directory and collect all regular files
-            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
-                if (std::filesystem::is_regular_file(entry.path())) {
-                    files_to_print.emplace_back(std::filesystem::absolute(entry.path()));
+/**
+ * @brief Prints the contents of the selected files from an existing scan index.
+ *
+ * @param table Scan index holding the selected paths and everything beneath them.
+ * @param selected_paths Vector of selected file and directory paths.
+ * @param out_stream The output stream to write the file contents to.
+ * @param options Output options, as for the overload that walks the selection itself.
+ * @return Counters describing what was written.
+ */
+DumpStats PrintFileContents(const PathTable& table, const std::vector<std::filesystem::path>& selected_paths, std::ostream& out_stream, const DumpOptions& options) {
+    TRACE_FUNCTION();
+    std::string output;
+    DumpManifest* manifest = options.manifest;
+    bool locate = manifest && !manifest->dumps[0].empty();
+    return VisitFileContents(table, SelectedFiles(table, selected_paths), options, DumpFileReader(options), [&](std::string_view path, std::string_view body, bool readable) {
+        output.clear();
+        size_t content_offset = std::string::npos;
+        if (readable) {
+            options.templates.file.Emit(path, body, output, &content_offset);
+        } else {
+            options.templates.error.Emit(path, {}, output);
+        }
+        if (readable && manifest && !manifest->entries.empty() && manifest->entries.back().dump == ManifestEntry::kPending) {
+            ManifestEntry& entry = manifest->entries.back();
+            entry.dump = ManifestEntry::kNoDump;
+            if (locate && content_offset != std::string::npos) {
+                // Streams that cannot tell their position (pipes) leave the body unlocated
+                std::streamoff position = out_stream.tellp();
+                if (position >= 0) {
+                    entry.dump = 0;
+                    entry.offset = static_cast<uint64_t>(position) + content_offset;
                 }
             }
         }
-    }
+        out_stream.write(output.data(), static_cast<std::streamsize>(output.size()));
+    });
+}
 
-    // Remove duplicate files
-    std::sort(files_to_print.begin(), files_to_print.end());
-    files_to_print.erase(std::unique(files_to_print.begin(), files_to_print.end()), files_to_print.end());
+void PrintChangeList(const DumpStats& stats, std::ostream& out_stream, const DumpOptions& options) {
+    std::string list = "Changes since the earlier dump";
+    if (stats.unchanged > 0) {
+        list += " (" + std::to_string(stats.unchanged) + (stats.unchanged == 1 ? " unchanged file" : " unchanged files") + " left out)";
+    }
+    list += stats.changes.empty() ? ": none\n" : ":\n";
+    for (const FileChange& change : stats.changes) {
+        list += change.kind;
+        list += ' ';
+        list += change.path;
+        list += '\n';
+    }
 
-    for (const auto& file_path : files_to_print) {
-        out_stream << "\nContents of " << file_path.string() << ":\n";
+    std::string buffer;
+    options.templates.tree.Emit({}, list, buffer);
+    out_stream << buffer;
+}
 
-        std::ifstream file(file_path);
-        if (file) {
-            std::string line;
-            while (std::getline(file, line)) {
-                out_stream << line << "\n";
-            }
-        } else {
-            out_stream << "Failed to open " << file_path.string() << "\n";
+void PrintDumpReport(const DumpStats& stats, const DumpOptions& options, std::ostream& out_stream) {
+    if (options.minify) {
+        uint64_t saved = stats.minified_bytes_in - stats.minified_bytes_out;
+        out_stream << "Minified " << stats.files << " files: " << stats.minified_bytes_in << " -> "
+                   << stats.minified_bytes_out << " bytes (saved " << saved << " bytes, ~"
+                   << EstimateTokens(stats.minified_bytes_in) - EstimateTokens(stats.minified_bytes_out) << " tokens)\n";
+    }
+    if (!stats.redactions.empty()) {
+        // Where and what, never the secret itself
+        constexpr size_t kListed = 20;
+        out_stream << "Redacted " << stats.redactions.size() << (stats.redactions.size() == 1 ? " secret" : " secrets")
+                   << " (disable with --no-redact):\n";
+        for (size_t i = 0; i < stats.redactions.size() && i < kListed; ++i) {
+            const Redaction& redaction = stats.redactions[i];
+            out_stream << "  " << redaction.path << ":" << redaction.line << ": " << redaction.kind << "\n";
+        }
+        if (stats.redactions.size() > kListed) {
+            out_stream << "  ... and " << stats.redactions.size() - kListed << " more\n";
+        }
+    }
+    if (options.since) {
+        size_t counts[3] = {0, 0, 0};
+        for (const FileChange& change : stats.changes) {
+            ++counts[change.kind == 'A' ? 0 : change.kind == 'M' ? 1 : 2];
         }
+        out_stream << "Since the earlier dump: " << counts[0] << " added, " << counts[1] << " modified, " << counts[2]
+                   << " deleted, " << stats.unchanged << " unchanged and left out\n";
     }
 }
 
@@ -157,45 +505,222 @@ void PrintFileContents(const std::vector<std::filesystem::path>& selected_paths,
  * @brief Gets the contents of the selected files and directories as a single string.
  *
  * @param selected_paths Vector of selected file and directory paths.
+ * @param options Output options, as for PrintFileContents.
  * @return A string containing all the file contents concatenated.
  */
-std::string GetFileContents(const std::vector<std::filesystem::path>& selected_paths) {
+std::string GetFileContents(const std::vector<std::filesystem::path>& selected_paths, const DumpOptions& options) {
     std::ostringstream oss;
+    PrintFileContents(selected_paths, oss, options);
+    return oss.str();
+}
 
-    // Collect all files to read
-    std::vector<std::filesystem::path> files_to_read;
+/**
+ * @brief Finds the longest common ancestor of the given absolute paths.
+ *
+ * @param absolute_paths The paths; must not be empty.
+ * @return The common ancestor, or the current directory if the paths share none.
+ */
+std::filesystem::path CommonRoot(const std::vector<std::filesystem::path>& absolute_paths) {
+    std::filesystem::path common_root = absolute_paths[0];
+    for (const auto& path : absolute_paths) {
+        auto it1 = common_root.begin();
+        auto it2 = path.begin();
+        std::filesystem::path temp_root;
+        while (it1 != common_root.end() && it2 != path.end() && *it1 == *it2) {
+            temp_root /= *it1;
+            ++it1;
+            ++it2;
+        }
+        common_root = temp_root;
+        if (common_root.empty()) {
+            break;  // No common root
+        }
+    }
 
-    for (const auto& path : selected_paths) {
-        if (std::filesystem::is_regular_file(path)) {
-            files_to_read.emplace_back(std::filesystem::absolute(path));
-        } else if (std::filesystem::is_directory(path)) {
-            // Recursively iterate through directory and collect all regular files
-            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
-                if (std::filesystem::is_regular_file(entry.path())) {
-                    files_to_read.emplace_back(std::filesystem::absolute(entry.path()));
-                }
+    if (common_root.empty()) {
+        // If there's no common root, use the current directory as the base
+        common_root = std::filesystem::current_path();
+    }
+    return common_root;
+}
+
+/**
+ * @brief Writes a dump in parts of at most options.split_bytes bytes, each starting with the tree.
+ *        A delta leaves the tree out and ends its last part with the change list instead, as an
+ *        unsplit one does. Parts go to numbered files when a prefix is set or the action prints,
+ *        and to successive clipboard copies otherwise, as soon as they are full.
+ *
+ * @param table Scan index of the selection.
+ * @param absolute_paths The selected paths, made absolute.
+ * @param common_root Root of the printed tree.
+ * @param action CaA, CaO, CoA or CoO.
+ * @param options Output options.
+ */
+void DumpSplitSelection(const PathTable& table, const std::vector<std::filesystem::path>& absolute_paths, const std::filesystem::path& common_root, const std::string& action, const DumpOptions& options) {
+    TRACE_FUNCTION();
+    bool copy = action == "CoA" || action == "CoO";
+    bool outline = action == "CaO" || action == "CoO";
+
+    SplitWriter::PartSink sink;
+    if (copy && options.split_prefix.empty()) {
+        sink = [clipboard = options.clipboard](std::string_view part, size_t number) {
+            if (number > 1) {
+                // Give the user a chance to paste the previous part before it is replaced
+                std::cerr << "Part " << number - 1 << " is on the clipboard. Press Enter to copy part " << number << "...";
+                std::string line;
+                std::getline(std::cin, line);
             }
-        }
+            if (!CopyToClipboard(part, clipboard)) {
+                return false;
+            }
+            std::cerr << "Copied part " << number << " (" << part.size() << " bytes)\n";
+            return true;
+        };
+    } else {
+        std::string prefix = options.split_prefix.empty() ? "repototxt" : options.split_prefix;
+        sink = [prefix](std::string_view part, size_t number) {
+            char suffix[24];
+            std::snprintf(suffix, sizeof(suffix), ".%03zu", number);
+            std::string name = prefix + suffix;
+            std::ofstream file(name, std::ios::binary | std::ios::trunc);
+            if (!file || !file.write(part.data(), static_cast<std::streamsize>(part.size()))) {
+                std::cerr << "Failed to write " << name << "\n";
+                return false;
+            }
+            std::cerr << "Wrote part " << number << " to " << name << " (" << part.size() << " bytes)\n";
+            return true;
+        };
     }
 
-    // Remove duplicate files
-    std::sort(files_to_read.begin(), files_to_read.end());
-    files_to_read.erase(std::unique(files_to_read.begin(), files_to_read.end()), files_to_read.end());
+    std::ostringstream tree_stream;
+    if (!options.since) {
+        PrintDirectoryTree(table, absolute_paths, common_root, tree_stream, options);
+    }
 
-    for (const auto& file_path : files_to_read) {
-        oss << "\nContents of " << file_path.string() << ":\n";
+    SplitWriter writer(tree_stream.str(), options.split_bytes, options.templates, sink);
+    auto add = [&writer](std::string_view path, std::string_view body, bool readable) {
+        writer.AddFile(path, body, readable);
+    };
+    std::vector<uint32_t> files = SelectedFiles(table, absolute_paths);
+    FileReader read = DumpFileReader(options);
+    DumpStats stats = outline ? VisitFileOutlines(table, files, options, read, add) : VisitFileContents(table, files, options, read, add);
+    std::ostringstream change_stream;
+    if (options.since) {
+        PrintChangeList(stats, change_stream, options);
+    }
+    writer.Finish(change_stream.str());
+    PrintDumpReport(stats, options, std::cerr);
+}
 
-        std::ifstream file(file_path);
-        if (file) {
-            std::string line;
-            while (std::getline(file, line)) {
-                oss << line << "\n";
+/**
+ * @brief Writes the tree and/or contents of a selection, as requested by one of the UI buttons.
+ *
+ * @param selected_paths The selected files and directories.
+ * @param action CaA (cat all), CaT (cat tree), CaO (cat outline), CoA (copy all), CoT (copy tree)
+ *               or CoO (copy outline).
+ * @param options Output options.
+ */
+void DumpSelection(const std::set<std::filesystem::path>& selected_paths, const std::string& action, const DumpOptions& options) {
+    TRACE_FUNCTION();
+    if (!selected_paths.empty()) {
+        // Ensure all selected paths are absolute
+        std::vector<std::filesystem::path> absolute_paths;
+        for (const auto& path : selected_paths) {
+            absolute_paths.push_back(std::filesystem::absolute(path));
+        }
+
+        // Determine the common root path
+        std::filesystem::path common_root = CommonRoot(absolute_paths);
+
+        // One walk of the selection serves the tree and the contents alike
+        PathTable table = ParallelWalk(absolute_paths, options.threads, options.order);
+
+        // Content dumps can leave a manifest next to them, for a later delta against them
+        DumpOptions content_options = options;
+        DumpManifest manifest;
+        std::filesystem::path manifest_path;
+        bool contents = action == "CaA" || action == "CoA";
+        if (contents && !options.manifest_for.empty()) {
+            manifest_path = ManifestPathFor(options.manifest_for);
+            // Bodies can only be found again in a single dump on disk
+            if (action == "CaA" && options.split_bytes == 0) {
+                manifest.dumps[0] = std::filesystem::absolute(options.manifest_for).string();
             }
-        } else {
-            oss << "Failed to open " << file_path.string() << "\n";
+        } else if (contents && options.split_bytes > 0 && (action == "CaA" || !options.split_prefix.empty())) {
+            manifest_path = ManifestPathFor(options.split_prefix.empty() ? "repototxt" : options.split_prefix);
         }
+        if (!manifest_path.empty()) {
+            content_options.manifest = &manifest;
+        }
+
+        // When particular button is pressed
+        if (options.split_bytes > 0 && action != "CaT" && action != "CoT") {
+            // Content dumps are cut into parts; a tree on its own is never split
+            DumpSplitSelection(table, absolute_paths, common_root, action, content_options);
+        } else if (action == "CaA") {
+            // A delta leaves out the tree the earlier dump showed and ends with what changed
+            if (!options.since) {
+                Utils::PrintDirectoryTree(table, absolute_paths, common_root, std::cout, options);
+            }
+
+            // Print the contents of each selected file
+            Utils::DumpStats stats = Utils::PrintFileContents(table, absolute_paths, std::cout, content_options);
+            if (options.since) {
+                Utils::PrintChangeList(stats, std::cout, options);
+            }
+            Utils::PrintDumpReport(stats, options, std::cerr);
+        } else if (action == "CaT") {
+            // Print the directory tree
+            Utils::PrintDirectoryTree(table, absolute_paths, common_root, std::cout, options);
+        } else if (action == "CoA") {
+            // create a local string_stream
+            std::ostringstream string_stream;
+
+            // Print the directory tree to string_stream, unless this is a delta
+            if (!options.since) {
+                Utils::PrintDirectoryTree(table, absolute_paths, common_root, string_stream, options);
+            }
+
+            // Print the contents of each selected file to string_stream
+            Utils::DumpStats stats = Utils::PrintFileContents(table, absolute_paths, string_stream, content_options);
+            if (options.since) {
+                Utils::PrintChangeList(stats, string_stream, options);
+            }
+            Utils::PrintDumpReport(stats, options, std::cerr);
+
+            // copy string_stream to clipboard
+            Utils::CopyToClipboard(string_stream.str(), options.clipboard);
+        } else if (action == "CoT") {
+            // create a local string_stream
+            std::ostringstream string_stream;
+
+            // Print the directory tree to string_stream
+            Utils::PrintDirectoryTree(table, absolute_paths, common_root, string_stream, options);
+
+            // copy string_stream to clipboard
+            Utils::CopyToClipboard(string_stream.str(), options.clipboard);
+        } else if (action == "CaO") {
+            // Print the directory tree followed by the outline of each selected file
+            Utils::PrintDirectoryTree(table, absolute_paths, common_root, std::cout, options);
+            Utils::PrintFileOutlines(table, absolute_paths, std::cout, options);
+        } else if (action == "CoO") {
+            // create a local string_stream
+            std::ostringstream string_stream;
+
+            // Print the directory tree and the outlines to string_stream
+            Utils::PrintDirectoryTree(table, absolute_paths, common_root, string_stream, options);
+            Utils::PrintFileOutlines(table, absolute_paths, string_stream, options);
+
+            // copy string_stream to clipboard
+            Utils::CopyToClipboard(string_stream.str(), options.clipboard);
+        }
+
+        if (!manifest_path.empty() && !WriteDumpManifest(manifest_path, manifest)) {
+            std::cerr << "Failed to write " << manifest_path.string() << "\n";
+        }
+    } else {
+        std::cout << "No items were selected.\n";
     }
-    return oss.str();
 }
 
 bool IsParentPath(const std::filesystem::path& potential_parent, const std::filesystem::path& potential_child) {
@@ -214,89 +739,26 @@ bool IsChildPath(const std::filesystem::path& potential_parent, const std::files
     return IsParentPath(potential_parent, potential_child);
 }
 
-/**
- * @brief Copies the given text to the system clipboard.
- *
- * @param text The text to copy to the clipboard.
- * @return true If the operation was successful.
- * @return false Otherwise.
- */
-bool CopyToClipboard(const std::string& text) {
-#ifdef _WIN32
-    // Windows clipboard implementation
-    if (!OpenClipboard(nullptr)) {
-        return false;
-    }
-    EmptyClipboard();
-
-    HGLOBAL hGlob = GlobalAlloc(GMEM_FIXED, text.size() + 1);
-    if (!hGlob) {
-        CloseClipboard();
-        return false;
-    }
-    memcpy(hGlob, text.c_str(), text.size() + 1);
-    SetClipboardData(CF_TEXT, hGlob);
-    CloseClipboard();
-    GlobalFree(hGlob);
-    return true;
-
-#elif __APPLE__
-    // macOS implementation using pbcopy
-    FILE* pipe = popen("pbcopy", "w");
-    if (pipe == nullptr) {
-        return false;
-    }
-    fwrite(text.c_str(), sizeof(char), text.size(), pipe);
-    pclose(pipe);
-    return true;
-
-#elif __linux__
-    // Determine the display server
-    const char* wayland_display = getenv("WAYLAND_DISPLAY");
-    const char* x11_display = getenv("DISPLAY");
-
-    std::string command;
-
-    if (wayland_display != nullptr) {
-        // Wayland detected, use wl-copy
-        command = "wl-copy";
-    } else if (x11_display != nullptr) {
-        // X11 detected, use xclip
-        command = "xclip -selection clipboard";
-    } else {
-        // Neither Wayland nor X11 detected
-        fprintf(stderr, "Unsupported display server.\n");
-        return false;
-    }
-
-    // Open a pipe to the selected clipboard utility
-    FILE* pipe = popen(command.c_str(), "w");
-    if (pipe == nullptr) {
-        perror("popen");
-        return false;
+void SelectPath(std::set<std::filesystem::path>& selection, const std::filesystem::path& path, std::vector<std::filesystem::path>* removed) {
+    for (std::filesystem::path ancestor = path.parent_path(); !ancestor.empty(); ancestor = ancestor.parent_path()) {
+        auto it = selection.find(ancestor);
+        if (it != selection.end()) {
+            if (removed) removed->push_back(*it);
+            selection.erase(it);
+        }
+        // The parent of a root is the root itself
+        if (ancestor == ancestor.parent_path()) break;
     }
+    selection.insert(path);
+}
 
-    // Write the ASCII-only text to the clipboard
-    size_t bytes_written = fwrite(text.c_str(), sizeof(char), text.size(), pipe);
-    if (bytes_written != text.size()) {
-        perror("fwrite");
-        pclose(pipe);
-        return false;
+void DeselectPath(std::set<std::filesystem::path>& selection, const std::filesystem::path& path, std::vector<std::filesystem::path>* removed) {
+    selection.erase(path);
+    auto it = selection.upper_bound(path);
+    while (it != selection.end() && IsSubPath(path, *it)) {
+        if (removed) removed->push_back(*it);
+        it = selection.erase(it);
     }
-
-    // Close the pipe and check for errors
-    int return_code = pclose(pipe);
-    if (return_code != 0) {
-        fprintf(stderr, "Clipboard command failed with exit code %d.\n", return_code);
-        return false;
-    }
-
-    return true;
-#else
-    // Other platforms
-    fprintf(stderr, "Clipboard copy not implemented for this platform.\n");
-    return false;
-#endif
 }
 
 }
\ No newline at end of file
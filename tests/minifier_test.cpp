@@ -0,0 +1,66 @@
+/**
+ * Minifies small inputs whole and one byte at a time and compares them with the expected output.
+ */
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "utils/minifier.hpp"
+
+namespace {
+
+struct MinifierCase {
+    const char* path;
+    const char* input;
+    const char* expected;
+};
+
+const MinifierCase kCases[] = {
+    // Regular expression literals are copied verbatim, so their slashes start no comment
+    {"re.js",
+     "const re = /\\/*/g; // regex\nlet s = \"http://x\"; /* gone */ let t = 'a//b';\n",
+     "const re = /\\/*/g;\nlet s = \"http://x\";   let t = 'a//b';\n"},
+    {"re.ts", "if (/[/*]/.test(s)) return /a\\//; // x\n", "if (/[/*]/.test(s)) return /a\\//;\n"},
+    {"re.js", "x = [/\\d+/g, /[\\]/]/];\n", "x = [/\\d+/g, /[\\]/]/];\n"},
+    {"re.js", "}\n/=+/.exec(s) // y\n", "}\n/=+/.exec(s)\n"},
+    // After an operand a slash divides
+    {"div.js", "a = b / c / d; // half\nf(x) / 2 /* c */\n", "a = b / c / d;\nf(x) / 2\n"},
+    {"div.js", "n = i++ + arr[0] / 4; // q\n", "n = i++ + arr[0] / 4;\n"},
+    {"div.js", "y = returned / 2 // r\n", "y = returned / 2\n"},
+    // C-like files have no regular expressions
+    {"div.cpp", "a = (b) / c; // d\nx = /y; // z\n", "a = (b) / c;\nx = /y;\n"},
+};
+
+}  // namespace
+
+int main() {
+    size_t failures = 0;
+    for (const MinifierCase& test : kCases) {
+        Utils::SourceLanguage language = Utils::DetectSourceLanguage(test.path);
+        std::string whole;
+        Utils::Minifier minifier(language);
+        minifier.Feed(test.input, whole);
+        minifier.Finish(whole);
+
+        // Chunk boundaries must not change the result
+        std::string bytewise;
+        Utils::Minifier chunked(language);
+        for (const char* c = test.input; *c != '\0'; ++c) chunked.Feed(std::string(1, *c), bytewise);
+        chunked.Finish(bytewise);
+
+        for (const std::string* actual : {&whole, &bytewise}) {
+            if (*actual != test.expected) {
+                std::cout << "FAILED " << test.path << ": " << test.input << "  expected: " << test.expected
+                          << "  actual:   " << *actual;
+                ++failures;
+            }
+        }
+    }
+    if (failures > 0) {
+        std::cout << failures << (failures == 1 ? " check failed\n" : " checks failed\n");
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * Stores toggled selections in profiles with rules and checks that applying them again keeps the
+ * toggles while the rules still pick up files added afterwards, and that a profile applied to a
+ * walk of a subdirectory selects what it selects there in a walk of the whole root.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/parallel_walker.hpp"
+#include "utils/selection_profile.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+void Touch(const fs::path& path) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << "x\n";
+}
+
+std::string Describe(const std::set<fs::path>& selection, const fs::path& root) {
+    std::string text;
+    for (const auto& path : selection) text += " " + path.lexically_relative(root).generic_string();
+    return text;
+}
+
+}  // namespace
+
+int main() {
+    const fs::path root = fs::absolute(fs::temp_directory_path() / "repototxt-selection-profile-test");
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    Touch(root / "src" / "a.cpp");
+    Touch(root / "src" / "b.cpp");
+    Touch(root / "src" / "notes.txt");
+    Touch(root / "tools" / "gen.cpp");
+
+    Utils::SelectionProfile profile;
+    profile.paths = {"src"};
+    profile.include_rules = {"*.cpp"};
+    std::set<fs::path> applied = Utils::ApplySelectionProfile(profile, root, 1);
+
+    // Deselect a file the stored directory brought in, select one outside it
+    std::set<fs::path> selected = applied;
+    selected.erase(root / "src" / "b.cpp");
+    selected.insert(root / "tools" / "gen.cpp");
+    Utils::StoreSelection(selected, root, profile, &applied);
+
+    // A file added later under the stored directory is still picked up by the rules
+    Touch(root / "src" / "c.cpp");
+    std::set<fs::path> expected = {root / "src" / "a.cpp", root / "src" / "c.cpp", root / "tools" / "gen.cpp"};
+    std::set<fs::path> restored = Utils::ApplySelectionProfile(profile, root, 1);
+
+    size_t failures = 0;
+    if (restored != expected) {
+        std::cout << "FAILED toggles with rules: expected" << Describe(expected, root) << ", got" << Describe(restored, root) << "\n";
+        ++failures;
+    }
+
+    // Selecting the file again lifts its exclusion
+    applied = restored;
+    selected = restored;
+    selected.insert(root / "src" / "b.cpp");
+    Utils::StoreSelection(selected, root, profile, &applied);
+    expected.insert(root / "src" / "b.cpp");
+    restored = Utils::ApplySelectionProfile(profile, root, 1);
+    if (restored != expected) {
+        std::cout << "FAILED reselecting with rules: expected" << Describe(expected, root) << ", got" << Describe(restored, root) << "\n";
+        ++failures;
+    }
+
+    // Rules on ancestors of a walked subdirectory still apply to it
+    Touch(root / "src" / "gen" / "d.cpp");
+    Touch(root / "src" / "gen" / "e.cpp");
+    Utils::SelectionProfile rules;
+    rules.paths = {"."};
+    rules.include_rules = {"*.cpp"};
+    rules.exclude_rules = {"src/gen/e.cpp"};
+    for (const char* top : {"src", "src/gen", "tools"}) {
+        std::set<fs::path> whole = Utils::ApplySelectionProfile(rules, root, 1);
+        expected.clear();
+        for (const auto& path : whole) {
+            if (path.lexically_relative(root / top).generic_string().compare(0, 2, "..") != 0) expected.insert(path);
+        }
+        restored = Utils::ApplySelectionProfile(rules, root, Utils::ParallelWalk({root / top}, 1));
+        if (restored != expected) {
+            std::cout << "FAILED rules on a walk of " << top << ": expected" << Describe(expected, root) << ", got" << Describe(restored, root) << "\n";
+            ++failures;
+        }
+    }
+    fs::remove_all(root, ec);
+    if (failures > 0) {
+        std::cout << failures << (failures == 1 ? " check failed\n" : " checks failed\n");
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
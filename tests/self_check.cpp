@@ -0,0 +1,657 @@
+/**
+ * Checks the optimized traversal and dump code against straightforward reference implementations.
+ * Randomized trees are built in the temporary directory, with symlinks (to files, to directories,
+ * dangling and looping), unreadable entries, FIFOs, unicode and odd names and deep nesting; for
+ * each, random selections are printed as a tree and as contents in both name orders and compared
+ * byte for byte with the reference, and random menu toggles are replayed against a reference
+ * selection. Trees that fail a check are kept for inspection.
+ *
+ * With --timing, a larger tree instead times every optimized path against its reference, failing
+ * when one is no longer at least as fast as its limit requires. Timings depend on the machine and
+ * its load, so they run as their own test, registered only when REPOTOTXT_TIMING_TESTS is on.
+ *
+ * Usage: self_check [--timing] [--seed <n>]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "utils/dump_options.hpp"
+#include "utils/utils.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+using Utils::DumpOptions;
+using Utils::NameOrder;
+
+#ifdef _WIN32
+constexpr char kSeparator = '\\';
+#else
+constexpr char kSeparator = '/';
+#endif
+
+constexpr int kRounds = 24;                 // Random trees checked
+constexpr size_t kTreeEntries = 160;        // Entries per random tree
+constexpr size_t kToggles = 2000;           // Menu toggles replayed per tree
+constexpr size_t kTimingEntries = 10000;    // Entries of the tree the timings are taken on
+constexpr size_t kTimingSelection = 4000;   // Paths selected while timing the menu logic
+constexpr size_t kTimingToggles = 1000;     // Menu toggles timed
+constexpr int kTimingRuns = 3;              // Each timing is the best of this many runs
+
+/**
+ * @brief Most an optimized path may take, as a fraction of its reference's time. The margins are
+ *        wide enough for a loaded machine; falling past them means the optimization was lost.
+ */
+struct TimingLimit {
+    const char* name;
+    double ratio;
+};
+constexpr TimingLimit kTreeLimit = {"tree", 1.0};
+constexpr TimingLimit kContentsLimit = {"contents", 1.0};
+constexpr TimingLimit kSelectionLimit = {"selection", 0.25};
+
+// Names picked for entries: cases that sort differently in the two orders, unicode in several
+// normalization forms, and spellings that trip up naive path handling
+const char* const kNames[] = {
+    "a", "B", "main.cpp", "README", "file2", "file10", "file007", "file7", "file08", "v1.2.9", "v1.2.10",
+    "0", "00", "123456789012345678901234567890", "with space", ".hidden", "..dots", "-dash", "x.tar.gz",
+    "\xC3\xBCnic\xC3\xB6" "de", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", "emoji\xF0\x9F\x98\x80", "e\xCC\x81", "caf\xC3\xA9",
+#ifndef _WIN32
+    "\xFF\xFE", "new\nline", "back\\slash", "tab\there", "colon:name",
+#endif
+};
+
+/**
+ * @brief Turns a UTF-8 spelling into a path, as the walker's table does.
+ */
+fs::path PathOf(const std::string& spelling) {
+#ifdef _WIN32
+    return fs::u8path(spelling);
+#else
+    return fs::path(spelling);
+#endif
+}
+
+fs::path Child(const fs::path& directory, const std::string& name) {
+    return directory / PathOf(name);
+}
+
+/**
+ * @brief Spells a path the way the walker's table does.
+ */
+std::string Spelling(const fs::path& path) {
+#ifdef _WIN32
+    return path.u8string();
+#else
+    return path.string();
+#endif
+}
+
+std::string RandomContent(std::mt19937_64& rng, size_t max_bytes) {
+    size_t size = rng() % 4 == 0 ? rng() % (max_bytes + 1) : rng() % std::min<size_t>(max_bytes + 1, 512);
+    std::string content;
+    content.reserve(size);
+    switch (rng() % 4) {
+        case 0:  // Lines of text, some with CRLF endings
+            while (content.size() < size) {
+                content += rng() % 8 == 0 ? "line\r\n" : "int value = 42; // text\n";
+            }
+            content.resize(size);
+            break;
+        case 1:  // UTF-8
+            while (content.size() < size) content += "\xC3\xA9t\xC3\xA9 \xE6\x97\xA5\n";
+            content.resize(size);
+            break;
+        case 2:  // Binary, NULs included
+            for (size_t i = 0; i < size; ++i) content += static_cast<char>(rng());
+            break;
+        default:
+            break;
+    }
+    return content;
+}
+
+/**
+ * @brief Builds a random tree under root. Unreadable directories are made last so the tree can
+ *        still be filled when running without privileges.
+ */
+void BuildRandomTree(const fs::path& root, std::mt19937_64& rng, size_t budget, size_t max_file_bytes, bool deep) {
+    std::error_code ec;
+    fs::create_directories(root, ec);
+    std::vector<fs::path> directories = {root};
+    std::vector<fs::path> entries;
+    std::vector<fs::path> locked;
+
+    auto fresh_name = [&](const fs::path& directory) {
+        std::string name = kNames[rng() % (sizeof(kNames) / sizeof(kNames[0]))];
+        std::error_code status_ec;
+        for (int suffix = 1; fs::symlink_status(Child(directory, name), status_ec).type() != fs::file_type::not_found; ++suffix) {
+            name = std::string(kNames[rng() % (sizeof(kNames) / sizeof(kNames[0]))]) + "~" + std::to_string(suffix);
+        }
+        return Child(directory, name);
+    };
+    auto write_file = [&](const fs::path& path) {
+        std::ofstream file(path, std::ios::binary);
+        std::string content = RandomContent(rng, max_file_bytes);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        entries.push_back(path);
+    };
+
+    if (deep) {
+        // Nesting far deeper than a repository usually has
+        fs::path path = root;
+        for (int depth = 20 + static_cast<int>(rng() % 60); depth > 0; --depth) {
+            path = fresh_name(path);
+            fs::create_directory(path, ec);
+            directories.push_back(path);
+        }
+        write_file(fresh_name(path));
+    }
+
+    for (size_t count = 0; count < budget; ++count) {
+        const fs::path directory = directories[rng() % directories.size()];
+        const fs::path path = fresh_name(directory);
+        unsigned kind = static_cast<unsigned>(rng() % 100);
+        if (kind < 25) {
+            fs::create_directory(path, ec);
+            directories.push_back(path);
+            entries.push_back(path);
+#ifndef _WIN32
+        } else if (kind < 85) {
+            write_file(path);
+        } else if (kind < 91) {
+            // To a file or a directory, dangling, or looping back up
+            const char* relative[] = {".", "..", "missing/target", "loop-self"};
+            if (rng() % 2 == 0 && !entries.empty()) {
+                fs::create_symlink(entries[rng() % entries.size()], path, ec);
+            } else {
+                const char* target = relative[rng() % 4];
+                fs::create_symlink(std::string(target) == "loop-self" ? path.filename() : fs::path(target), path, ec);
+            }
+            entries.push_back(path);
+        } else if (kind < 94) {
+            write_file(path);
+            fs::permissions(path, fs::perms::none, ec);
+        } else if (kind < 96) {
+            fs::create_directory(path, ec);
+            write_file(fresh_name(path));
+            locked.push_back(path);
+        } else if (kind < 98) {
+            mkfifo(path.c_str(), 0600);
+            entries.push_back(path);
+#endif
+        } else {
+            write_file(path);
+        }
+    }
+
+    for (const fs::path& path : locked) {
+        fs::permissions(path, fs::perms::none, ec);
+    }
+}
+
+/**
+ * @brief Makes every directory of a random tree accessible again, then removes the tree.
+ */
+void RemoveRandomTree(const fs::path& root) {
+    std::error_code ec;
+    std::vector<fs::path> pending = {root};
+    while (!pending.empty()) {
+        fs::path directory = pending.back();
+        pending.pop_back();
+        fs::permissions(directory, fs::perms::owner_all, fs::perm_options::add, ec);
+        for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+            std::error_code type_ec;
+            if (it->is_directory(type_ec) && !it->is_symlink(type_ec)) pending.push_back(it->path());
+        }
+    }
+    fs::remove_all(root, ec);
+}
+
+/**
+ * @brief An entry of the reference listing, built with std::filesystem alone.
+ */
+struct ReferenceEntry {
+    std::string path;  // Spelled as the walker spells it
+    std::string name;
+    bool directory = false;  // Directory, or symlink to one
+    bool regular = false;    // Regular file, or symlink to one
+    bool symlink = false;
+    bool listed = false;
+    std::vector<ReferenceEntry> children;
+};
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * @brief Natural order, one token at a time: digit runs compare by value and sort before any
+ *        byte that is not a digit above '0', other bytes compare as unsigned values. Names that
+ *        only differ in leading zeros fall back to byte order.
+ */
+bool NaturalLess(std::string_view a, std::string_view b) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (IsDigit(a[i]) && IsDigit(b[j])) {
+            size_t a_end = i;
+            size_t b_end = j;
+            while (a_end < a.size() && IsDigit(a[a_end])) ++a_end;
+            while (b_end < b.size() && IsDigit(b[b_end])) ++b_end;
+            std::string_view a_number = a.substr(i, a_end - i);
+            std::string_view b_number = b.substr(j, b_end - j);
+            a_number.remove_prefix(std::min(a_number.find_first_not_of('0'), a_number.size()));
+            b_number.remove_prefix(std::min(b_number.find_first_not_of('0'), b_number.size()));
+            if (a_number.size() != b_number.size()) return a_number.size() < b_number.size();
+            if (a_number != b_number) return a_number < b_number;
+            i = a_end;
+            j = b_end;
+            continue;
+        }
+        unsigned char a_byte = IsDigit(a[i]) ? '0' : static_cast<unsigned char>(a[i]);
+        unsigned char b_byte = IsDigit(b[j]) ? '0' : static_cast<unsigned char>(b[j]);
+        if (a_byte != b_byte) return a_byte < b_byte;
+        ++i;
+        ++j;
+    }
+    if ((i == a.size()) != (j == b.size())) return i == a.size();
+    return a < b;
+}
+
+/**
+ * @brief Lists a directory and, below it, every directory that is not a symlink, sorting each
+ *        listing directories first and then by name.
+ */
+void ListReference(ReferenceEntry& entry, NameOrder order) {
+    entry.listed = true;
+    std::error_code ec;
+    for (fs::directory_iterator it(PathOf(entry.path), ec), end; !ec && it != end; it.increment(ec)) {
+        ReferenceEntry child;
+#ifdef _WIN32
+        child.name = it->path().filename().u8string();
+#else
+        child.name = it->path().filename().string();
+#endif
+        child.path = entry.path;
+        if (child.path.empty() || child.path.back() != kSeparator) child.path += kSeparator;
+        child.path += child.name;
+        std::error_code type_ec;
+        child.symlink = fs::is_symlink(fs::symlink_status(it->path(), type_ec));
+        fs::file_status status = fs::status(it->path(), type_ec);
+        child.directory = !type_ec && fs::is_directory(status);
+        child.regular = !type_ec && fs::is_regular_file(status);
+        if (child.directory && !child.symlink) ListReference(child, order);
+        entry.children.push_back(std::move(child));
+    }
+    std::sort(entry.children.begin(), entry.children.end(), [order](const ReferenceEntry& a, const ReferenceEntry& b) {
+        if (a.directory != b.directory) return a.directory;
+        return order == NameOrder::Natural ? NaturalLess(a.name, b.name) : a.name < b.name;
+    });
+}
+
+/**
+ * @brief Collects every entry below (and including) the given one in pre-order.
+ */
+void Flatten(ReferenceEntry& entry, std::vector<ReferenceEntry*>& out) {
+    out.push_back(&entry);
+    for (ReferenceEntry& child : entry.children) Flatten(child, out);
+}
+
+void PrintReferenceEntry(const ReferenceEntry& entry, const std::string& prefix, bool last, std::string& out) {
+#ifdef _WIN32
+    out += prefix + (last ? "+-- " : "|-- ") + entry.name + "\n";
+    std::string child_prefix = prefix + (last ? "    " : "|   ");
+#else
+    out += prefix + (last ? "└── " : "├── ") + entry.name + "\n";
+    std::string child_prefix = prefix + (last ? "    " : "│   ");
+#endif
+    for (size_t i = 0; i < entry.children.size(); ++i) {
+        PrintReferenceEntry(entry.children[i], child_prefix, i + 1 == entry.children.size(), out);
+    }
+}
+
+/**
+ * @brief Tells whether child is spelled as a path beneath parent.
+ */
+bool IsBelow(const std::string& parent, const std::string& child, char separator = kSeparator) {
+    return child.size() > parent.size() && child.compare(0, parent.size(), parent) == 0 &&
+           (child[parent.size()] == separator || parent.back() == separator);
+}
+
+/**
+ * @brief The tree and contents of a selection, produced without the walker, the path table or
+ *        the parallel readers. Symlinked directories are followed only where the walker follows
+ *        them: when selected themselves and not inside another selected directory.
+ */
+void ReferenceDump(const fs::path& root, const std::vector<fs::path>& selected, const DumpOptions& options, std::string& tree, std::string* contents) {
+    ReferenceEntry top;
+    top.path = Spelling(root);
+    top.directory = true;
+    ListReference(top, options.order);
+
+    std::vector<ReferenceEntry*> flat;
+    Flatten(top, flat);
+    std::vector<ReferenceEntry*> picked;
+    for (const fs::path& path : selected) {
+        std::string spelling = Spelling(path);
+        auto it = std::find_if(flat.begin(), flat.end(), [&](const ReferenceEntry* entry) {
+            return entry->path == spelling;
+        });
+        picked.push_back(it == flat.end() ? nullptr : *it);
+    }
+    for (ReferenceEntry* entry : picked) {
+        if (entry == nullptr || !entry->symlink || !entry->directory || entry->listed) continue;
+        bool covered = std::any_of(picked.begin(), picked.end(), [&](const ReferenceEntry* other) {
+            return other != nullptr && other->directory && IsBelow(other->path, entry->path);
+        });
+        if (!covered) ListReference(*entry, options.order);
+    }
+    flat.clear();
+    Flatten(top, flat);
+
+    // Selected entries print in pre-order, each with everything below it
+    std::vector<ReferenceEntry*> in_order;
+    std::set<const ReferenceEntry*> chosen(picked.begin(), picked.end());
+    for (ReferenceEntry* entry : flat) {
+        for (size_t n = std::count(picked.begin(), picked.end(), entry); n > 0; --n) in_order.push_back(entry);
+    }
+    std::string text = Spelling(root) + " (root)\n";
+    for (const ReferenceEntry* entry : in_order) {
+        PrintReferenceEntry(*entry, "", true, text);
+    }
+    tree.clear();
+    options.templates.tree.Emit({}, text, tree);
+
+    if (contents == nullptr) return;
+
+    // Files at or below a selected entry, each once, in pre-order
+    contents->clear();
+    const ReferenceEntry* outermost = nullptr;  // Outermost selected entry the walk is beneath
+    std::string body;
+    for (const ReferenceEntry* entry : flat) {
+        if (outermost != nullptr && !IsBelow(outermost->path, entry->path)) outermost = nullptr;
+        if (outermost == nullptr && chosen.count(entry) > 0) outermost = entry;
+        if (outermost == nullptr || !entry->regular) continue;
+
+        std::ifstream file(PathOf(entry->path), std::ios::binary);
+        if (file) {
+            body.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            options.templates.file.Emit(entry->path, body, *contents);
+        } else {
+            options.templates.error.Emit(entry->path, {}, *contents);
+        }
+    }
+}
+
+/**
+ * @brief Describes the first line on which two outputs differ.
+ */
+std::string FirstDifference(const std::string& expected, const std::string& actual) {
+    size_t line = 1;
+    size_t start = 0;
+    size_t i = 0;
+    while (i < expected.size() && i < actual.size() && expected[i] == actual[i]) {
+        if (expected[i] == '\n') {
+            ++line;
+            start = i + 1;
+        }
+        ++i;
+    }
+    auto line_at = [start](const std::string& text) {
+        size_t end = text.find('\n', start);
+        return text.substr(start, std::min<size_t>(end == std::string::npos ? text.size() - start : end - start, 160));
+    };
+    return "line " + std::to_string(line) + " differs\n      expected: " + line_at(expected) + "\n      actual:   " + line_at(actual) + "\n";
+}
+
+/**
+ * @brief The menu's selection rules as first written: every toggle scans the whole selection.
+ */
+void ReferenceToggle(std::set<fs::path>& selection, const fs::path& path, bool select, std::vector<fs::path>& removed) {
+    std::string spelling = path.generic_string();
+    std::vector<fs::path> dropped;
+    for (const fs::path& selected : selection) {
+        bool drop = select ? IsBelow(selected.generic_string(), spelling, '/') : IsBelow(spelling, selected.generic_string(), '/');
+        if (drop) dropped.push_back(selected);
+    }
+    for (const fs::path& dropped_path : dropped) selection.erase(dropped_path);
+    if (select) {
+        selection.insert(path);
+    } else {
+        selection.erase(path);
+    }
+    removed.insert(removed.end(), dropped.begin(), dropped.end());
+}
+
+template <typename Function>
+double BestTime(Function&& function) {
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run < kTimingRuns; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+/**
+ * @brief Reports one timing and returns whether it stays within its limit.
+ */
+bool CheckTiming(const TimingLimit& limit, double optimized, double reference, std::ostream& report) {
+    bool ok = optimized <= reference * limit.ratio;
+    char line[160];
+    std::snprintf(line, sizeof(line), "  timing %-10s %9.2f ms, reference %9.2f ms (%3.0f%%, limit %3.0f%%)  %s\n", limit.name,
+                  optimized, reference, 100.0 * optimized / reference, 100.0 * limit.ratio, ok ? "ok" : "FAILED");
+    report << line;
+    return ok;
+}
+
+/**
+ * @brief Dumps random selections of random trees and replays menu toggles on them, comparing the
+ *        outputs and selections with the reference.
+ *
+ * @return Number of failed checks.
+ */
+size_t CheckOutputs(uint64_t seed, const fs::path& base, std::ostream& report) {
+    std::mt19937_64 rng(seed);
+    size_t failures = 0;
+    size_t dumps = 0;
+    size_t toggles = 0;
+
+    for (int round = 0; round < kRounds; ++round) {
+        const fs::path root = base / std::to_string(round);
+        RemoveRandomTree(root);
+        BuildRandomTree(root, rng, kTreeEntries, 64 * 1024, rng() % 3 == 0);
+        bool failed = false;
+        auto fail = [&](const std::string& what, const std::string& detail) {
+            report << "  FAILED " << what << " on " << Spelling(root) << ": " << detail;
+            ++failures;
+            failed = true;
+        };
+
+        // Anything the reference lists below the root can be selected
+        ReferenceEntry listing;
+        listing.path = Spelling(root);
+        ListReference(listing, NameOrder::Bytewise);
+        std::vector<ReferenceEntry*> flat;
+        Flatten(listing, flat);
+
+        for (NameOrder order : {NameOrder::Bytewise, NameOrder::Natural}) {
+            const char* order_name = order == NameOrder::Natural ? "natural order" : "byte order";
+            DumpOptions options;
+            options.order = order;
+            options.normalize = false;
+            options.redact = false;
+            options.threads = 1 + static_cast<unsigned>(rng() % 8);
+            for (int selection = 0; selection < 4; ++selection) {
+                std::vector<fs::path> selected;
+                for (size_t n = 1 + rng() % 6; n > 0; --n) {
+                    selected.push_back(PathOf(flat[1 + rng() % (flat.size() - 1)]->path));
+                }
+                std::string expected_tree;
+                std::string expected_contents;
+                ReferenceDump(root, selected, options, expected_tree, &expected_contents);
+
+                std::ostringstream tree;
+                Utils::PrintDirectoryTree(selected, root, tree, options);
+                std::ostringstream contents;
+                Utils::PrintFileContents(selected, contents, options);
+                std::string listed = "      selected:";
+                for (const fs::path& path : selected) listed += " " + Spelling(path.lexically_relative(root));
+                listed += "\n";
+                if (tree.str() != expected_tree) {
+                    fail(std::string("tree, ") + order_name, FirstDifference(expected_tree, tree.str()) + listed);
+                }
+                if (contents.str() != expected_contents) {
+                    fail(std::string("contents, ") + order_name, FirstDifference(expected_contents, contents.str()) + listed);
+                }
+                ++dumps;
+            }
+        }
+
+        // Menu toggles on the tree's paths and their ancestors, as a user would click them
+        std::vector<fs::path> paths;
+        for (const ReferenceEntry* entry : flat) paths.push_back(PathOf(entry->path));
+        std::set<fs::path> fast;
+        std::set<fs::path> slow;
+        for (size_t toggle = 0; toggle < kToggles && !failed; ++toggle, ++toggles) {
+            const fs::path& path = paths[rng() % paths.size()];
+            bool select = fast.count(path) == 0;
+            std::vector<fs::path> fast_removed;
+            std::vector<fs::path> slow_removed;
+            if (select) {
+                Utils::SelectPath(fast, path, &fast_removed);
+            } else {
+                Utils::DeselectPath(fast, path, &fast_removed);
+            }
+            ReferenceToggle(slow, path, select, slow_removed);
+            std::sort(fast_removed.begin(), fast_removed.end());
+            std::sort(slow_removed.begin(), slow_removed.end());
+            if (fast != slow || fast_removed != slow_removed) {
+                fail("selection", std::string(select ? "selecting " : "deselecting ") + Spelling(path) + " after " +
+                                      std::to_string(toggle) + " toggles gives a different selection\n");
+            }
+        }
+
+        if (!failed) RemoveRandomTree(root);
+    }
+    report << "  " << kRounds << " random trees: " << dumps << " selections dumped in both orders, " << toggles
+           << " menu toggles replayed\n";
+    return failures;
+}
+
+/**
+ * @brief Times the optimized paths against their references on one larger tree, every path
+ *        warmed up by its first run.
+ *
+ * @return Number of timings over their limit.
+ */
+size_t CheckTimings(uint64_t seed, const fs::path& base, std::ostream& report) {
+    std::mt19937_64 rng(seed);
+    size_t failures = 0;
+
+    const fs::path root = base / "timing";
+    RemoveRandomTree(root);
+    BuildRandomTree(root, rng, kTimingEntries, 2048, false);
+    std::vector<fs::path> selected;
+    std::error_code ec;
+    for (fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        selected.push_back(it->path());
+    }
+    DumpOptions options;
+    options.normalize = false;
+    options.redact = false;
+    std::string tree;
+    std::string contents;
+    double optimized_tree = BestTime([&] {
+        std::ostringstream out;
+        Utils::PrintDirectoryTree(selected, root, out, options);
+    });
+    double reference_tree = BestTime([&] { ReferenceDump(root, selected, options, tree, nullptr); });
+    double optimized_contents = BestTime([&] {
+        std::ostringstream out;
+        Utils::PrintFileContents(selected, out, options);
+    });
+    double reference_contents = BestTime([&] { ReferenceDump(root, selected, options, tree, &contents); });
+    failures += !CheckTiming(kTreeLimit, optimized_tree, reference_tree, report);
+    failures += !CheckTiming(kContentsLimit, optimized_contents, reference_contents, report);
+
+    std::vector<fs::path> synthetic;
+    for (size_t i = 0; i < kTimingSelection; ++i) {
+        synthetic.push_back(fs::path("/repo") / std::to_string(i % 97) / std::to_string(i % 89) / std::to_string(i));
+    }
+    auto replay = [&](bool reference_rules) {
+        std::mt19937_64 toggle_rng(seed);
+        std::set<fs::path> selection(synthetic.begin(), synthetic.end());
+        std::vector<fs::path> removed;
+        for (size_t toggle = 0; toggle < kTimingToggles; ++toggle) {
+            const fs::path& leaf = synthetic[toggle_rng() % synthetic.size()];
+            fs::path path = toggle_rng() % 2 == 0 ? leaf : leaf.parent_path();
+            bool select = selection.count(path) == 0;
+            removed.clear();
+            if (reference_rules) {
+                ReferenceToggle(selection, path, select, removed);
+            } else if (select) {
+                Utils::SelectPath(selection, path, &removed);
+            } else {
+                Utils::DeselectPath(selection, path, &removed);
+            }
+        }
+    };
+    failures += !CheckTiming(kSelectionLimit, BestTime([&] { replay(false); }), BestTime([&] { replay(true); }), report);
+    RemoveRandomTree(root);
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    bool timing = false;
+    uint64_t seed = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--timing") {
+            timing = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: self_check [--timing] [--seed <n>]\n";
+            return 2;
+        }
+    }
+    if (seed == 0) seed = std::random_device()() | 1;
+
+    const fs::path base = fs::temp_directory_path() / ("repototxt-self-check-" + std::to_string(seed));
+    std::cout << (timing ? "Timing against reference implementations, seed " : "Checking against reference implementations, seed ")
+              << seed << "\n";
+    size_t failures = timing ? CheckTimings(seed, base, std::cout) : CheckOutputs(seed, base, std::cout);
+
+    std::error_code remove_ec;
+    fs::remove(base, remove_ec);
+    if (failures == 0) {
+        std::cout << "All checks passed\n";
+        return 0;
+    }
+    std::cout << failures << (failures == 1 ? " check failed" : " checks failed") << "; rerun with --seed " << seed << "\n";
+    return 1;
+}
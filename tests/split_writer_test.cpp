@@ -0,0 +1,72 @@
+/**
+ * Splits small dumps into parts and checks that every part starts with the header, stays within
+ * the limit and that the files, and the trailer after them, come out whole and in order.
+ */
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/output_template.hpp"
+#include "utils/split_writer.hpp"
+
+namespace {
+
+struct SplitCase {
+    const char* name;
+    size_t files;
+    uint64_t max_bytes;
+    bool split;           // Whether the files need more than one part
+    const char* trailer;  // Closes the last part, as the change list of a delta does
+};
+
+const SplitCase kCases[] = {
+    {"empty dump", 0, 1000, false, ""},
+    {"one part", 3, 1000, false, ""},
+    {"several parts", 12, 200, true, ""},
+    {"trailer", 3, 1000, false, "Changes since the earlier dump:\nD gone.txt\n"},
+    {"trailer after several parts", 12, 200, true, "Changes since the earlier dump:\nD gone.txt\n"},
+};
+
+}  // namespace
+
+int main() {
+    const Utils::OutputTemplates& templates = Utils::OutputTemplates::ForFormat(Utils::OutputFormat::Plain);
+    const std::string header = "tree\n";
+    size_t failures = 0;
+    for (const SplitCase& test : kCases) {
+        std::vector<std::string> parts;
+        Utils::SplitWriter writer(header, test.max_bytes, templates, [&parts](std::string_view part, size_t) {
+            parts.emplace_back(part);
+            return true;
+        });
+        std::string expected;
+        for (size_t i = 0; i < test.files; ++i) {
+            std::string path = "file" + std::to_string(i) + ".txt";
+            std::string body = "line of file " + std::to_string(i) + "\n";
+            templates.file.Emit(path, body, expected);
+            writer.AddFile(path, body, true);
+        }
+        expected += test.trailer;
+        writer.Finish(test.trailer);
+
+        std::string files;
+        bool well_formed = true;
+        for (const std::string& part : parts) {
+            well_formed = well_formed && part.compare(0, header.size(), header) == 0 && part.size() <= test.max_bytes;
+            files += part.substr(header.size());
+        }
+        if ((parts.size() > 1) != test.split || parts.empty() || !well_formed || files != expected) {
+            std::cout << "FAILED " << test.name << ": " << parts.size() << " parts\n";
+            ++failures;
+        }
+    }
+    if (failures > 0) {
+        std::cout << failures << (failures == 1 ? " check failed\n" : " checks failed\n");
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}